@@ -0,0 +1,30 @@
+"""
+Runs a ``CLandscape`` on its native background thread from asyncio, so that event loops (e.g. notebook dashboards and
+services) stay responsive during long runs.
+"""
+
+import asyncio
+
+
+async def iterate_async(landscape, steps, poll_interval=0.05):
+    """
+    Iterates the landscape in the background and waits for it without blocking the event loop.
+
+    Cancelling the awaiting task cancels the run, which stops cleanly at the end of the current iteration.
+
+    :param landscape: the CLandscape to iterate, which must already be set up
+    :param steps: the number of iterations to run
+    :param poll_interval: the number of seconds between checks for completion
+
+    :return: the number of iterations completed
+    :rtype: int
+    """
+    landscape.start(steps)
+    try:
+        while not landscape.wait(0):
+            await asyncio.sleep(poll_interval)
+    except asyncio.CancelledError:
+        landscape.cancel()
+        landscape.wait()
+        raise
+    return landscape.progress()[0]
@@ -0,0 +1,223 @@
+"""
+Thin client for ``rfsim_server``, a long-lived process which runs simulation jobs on a pool of workers and streams the
+results back over a Unix domain socket. Batch work can submit many jobs to one server rather than paying for Python
+start-up and a ``CLandscape`` per job.
+
+A server can be started with :meth:`SimulationServer.start`, or run directly as
+``rfsim_server <socket path> [workers]``.
+"""
+
+from __future__ import print_function, absolute_import, division  # Only Python 2.x
+
+import itertools
+import os
+import socket
+import subprocess
+import time
+
+import numpy as np
+
+mod_directory = os.path.dirname(os.path.abspath(__file__))
+
+
+class SimulationError(Exception):
+    """Raised when the server rejects or fails a job."""
+
+    pass
+
+
+class SimulationServer(object):
+    """Runs an ``rfsim_server`` process for the lifetime of the object."""
+
+    def __init__(self, socket_path, workers=None, executable=None):
+        """
+        Starts the server and waits for its socket to appear.
+
+        :param socket_path: the path of the Unix domain socket to listen on
+        :param workers: the number of jobs to run at once, defaulting to the number of hardware threads
+        :param executable: the path to rfsim_server, defaulting to the one installed alongside librfsim
+        """
+        if executable is None:
+            executable = os.path.join(mod_directory, "librfsim", "rfsim_server")
+        self.socket_path = socket_path
+        args = [executable, socket_path]
+        if workers is not None:
+            args.append(str(workers))
+        if os.path.exists(socket_path):
+            os.remove(socket_path)
+        self.process = subprocess.Popen(args, stdout=subprocess.DEVNULL)
+        while not os.path.exists(socket_path):
+            if self.process.poll() is not None:
+                raise SimulationError("rfsim_server exited with code {}".format(self.process.returncode))
+            time.sleep(0.01)
+
+    @classmethod
+    def start(cls, socket_path, workers=None, executable=None):
+        """
+        Starts a server.
+
+        :param socket_path: the path of the Unix domain socket to listen on
+        :param workers: the number of jobs to run at once
+        :param executable: the path to rfsim_server
+
+        :return: the running server
+        :rtype: SimulationServer
+        """
+        return cls(socket_path, workers, executable)
+
+    def stop(self):
+        """Stops the server, abandoning any unfinished jobs."""
+        if self.process.poll() is None:
+            self.process.terminate()
+            self.process.wait()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.stop()
+
+
+class SimulationClient(object):
+    """Submits jobs to an ``rfsim_server`` and collects their results."""
+
+    def __init__(self, socket_path):
+        """
+        Connects to the server.
+
+        :param socket_path: the path of the server's Unix domain socket
+        """
+        self.socket = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self.socket.connect(socket_path)
+        self.reader = self.socket.makefile("r")
+        self.job_ids = itertools.count()
+        self.pending = {}
+
+    def close(self):
+        """Closes the connection, abandoning any unfinished jobs."""
+        self.reader.close()
+        self.socket.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def submit(self, seed, x, y, steps, threads=1, totals=True, grids=True, **parameters):
+        """
+        Submits a job to the server without waiting for it to run.
+
+        :param seed: the random number seed
+        :param x: the x dimension of the landscape
+        :param y: the y dimension of the landscape
+        :param steps: the number of iterations to run
+        :param threads: the number of threads for the job's own landscape; 1 matches a CLandscape exactly
+        :param totals: if true, stream the total rabbits and foxes after every step
+        :param grids: if true, return the final rabbit and fox counts of each cell
+        :param parameters: model parameters, e.g. grass_growth or move_probability
+
+        :return: the id of the job
+        :rtype: str
+        """
+        job_id = str(next(self.job_ids))
+        outputs = [name for name, wanted in (("totals", totals), ("grids", grids)) if wanted]
+        fields = ["run", job_id, "x={}".format(x), "y={}".format(y), "seed={}".format(seed), "steps={}".format(steps),
+                  "threads={}".format(threads), "output={}".format(",".join(outputs))]
+        fields.extend("{}={!r}".format(key, float(value)) for key, value in sorted(parameters.items()))
+        self.socket.sendall((" ".join(fields) + "\n").encode("ascii"))
+        self.pending[job_id] = {"id": job_id, "rabbit_totals": [], "fox_totals": []}
+        return job_id
+
+    def events(self):
+        """
+        Reads the lines streamed by the server, until every submitted job has finished.
+
+        :return: generator of (kind, job id, fields) tuples, where kind is one of queued, totals, rabbits, foxes, done
+                 or error
+        """
+        while self.pending:
+            kind, job_id, rest = self._read_event()
+            yield kind, job_id, rest
+            if kind in ("done", "error"):
+                self.pending.pop(job_id, None)
+
+    def _read_event(self):
+        """
+        Reads a single line streamed by the server.
+
+        :return: the (kind, job id, fields) of the line
+        """
+        line = self.reader.readline()
+        if not line:
+            raise SimulationError("Connection to rfsim_server was closed")
+        return tuple((line.rstrip("\n").split(" ", 2) + [""])[:3])
+
+    def _collect(self, kind, job_id, rest):
+        """
+        Adds a line streamed by the server to the results of its job.
+
+        :return: the job's result once the line finishes it, otherwise None
+        """
+        if kind == "totals":
+            step, rabbits, foxes = (int(value) for value in rest.split())
+            self.pending[job_id]["rabbit_totals"].append(rabbits)
+            self.pending[job_id]["fox_totals"].append(foxes)
+        elif kind in ("rabbits", "foxes"):
+            values = np.array(rest.split(), dtype=np.int64)
+            self.pending[job_id][kind] = values[2:].reshape(values[0], values[1])
+        elif kind == "done":
+            result = self.pending[job_id]
+            result["rabbit_totals"] = np.array(result["rabbit_totals"], dtype=np.uint64)
+            result["fox_totals"] = np.array(result["fox_totals"], dtype=np.uint64)
+            return result
+        elif kind == "error":
+            self.pending.pop(job_id, None)
+            raise SimulationError("Job {} failed: {}".format(job_id, rest))
+        return None
+
+    def results(self):
+        """
+        Collects the results of the submitted jobs as they finish, in the order they finish.
+
+        :return: generator of result dictionaries, each with the job id, the rabbit and fox totals after each step and,
+                 if requested, the final rabbit and fox grids
+        """
+        for kind, job_id, rest in self.events():
+            result = self._collect(kind, job_id, rest)
+            if result is not None:
+                yield result
+
+    def run_batch(self, jobs, max_pending=256):
+        """
+        Submits every job, letting the server run them in parallel, and waits for all of them.
+
+        Results are collected while jobs are still being submitted, once max_pending jobs are unfinished, so that the
+        replies never back up behind the submissions however large the batch is.
+
+        :param jobs: iterable of dictionaries of the keyword arguments to :meth:`submit`
+        :param max_pending: the number of unfinished jobs beyond which no more are submitted until one finishes
+
+        :return: the results, in the order the jobs were given
+        :rtype: list
+        """
+        job_ids = []
+        finished = {}
+        for job in jobs:
+            job_ids.append(self.submit(**job))
+            while len(self.pending) >= max_pending:
+                kind, job_id, rest = self._read_event()
+                result = self._collect(kind, job_id, rest)
+                if result is not None:
+                    finished[job_id] = self.pending.pop(job_id)
+        finished.update((result["id"], result) for result in self.results())
+        return [finished[job_id] for job_id in job_ids]
+
+    def run(self, seed, x, y, steps, **kwargs):
+        """
+        Runs a single job and waits for its result.
+
+        :return: the result dictionary, as from :meth:`results`
+        :rtype: dict
+        """
+        return self.run_batch([dict(seed=seed, x=x, y=y, steps=steps, **kwargs)])[0]
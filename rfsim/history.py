@@ -0,0 +1,222 @@
+"""
+Reads the compressed histories written by ``CLandscape.start_history_file``, decoding single frames or slices of time
+while reading only the chunks which hold them.
+
+A history stores the rabbit and fox counts of every step in chunks, each starting with a keyframe of the counts followed
+by frames of the changes from one step to the next. See ``HistoryWriter.h`` for the layout of the file.
+"""
+
+import os
+import struct
+
+import numpy as np
+
+_HEADER = struct.Struct("<8sIIQQ")
+_CHUNK_HEADER = struct.Struct("<QII")
+_TRAILER = struct.Struct("<QQQ8s")
+
+
+def _decode_varints(data):
+    """
+    Decodes a sequence of LEB128 varints.
+
+    :param data: the encoded bytes, which must end with a complete varint
+    :return: the decoded values
+    :rtype: np.ndarray of uint64
+    """
+    raw = np.frombuffer(data, dtype=np.uint8)
+    if raw.size == 0:
+        return np.zeros(0, dtype=np.uint64)
+    ends = np.flatnonzero(raw < 0x80)
+    starts = np.concatenate(([0], ends[:-1] + 1))
+    owner = np.repeat(np.arange(len(ends)), ends - starts + 1)
+    shifts = ((np.arange(raw.size) - starts[owner]) * 7).astype(np.uint64)
+    # The seven-bit groups of a value never overlap, so adding them is the same as combining their bits.
+    return np.add.reduceat((raw & 0x7F).astype(np.uint64) << shifts, starts)
+
+
+def _decode_frame(data, previous, size):
+    """
+    Decodes one frame.
+
+    :param data: the encoded frame
+    :param previous: the frame before, as int32 counts, or None for a keyframe
+    :param size: the number of values in the frame
+    :return: the counts of the frame, rabbits then foxes, each in row-major order
+    :rtype: np.ndarray of int32
+    """
+    keyframe = data[0] == 0
+    tokens = _decode_varints(data[1:])
+    runs = int(tokens[0])
+    lengths = tokens[1:1 + 2 * runs].astype(np.int64)
+    values = np.zeros(size, dtype=np.uint64)
+    values[np.repeat(np.tile([False, True], runs), lengths)] = tokens[1 + 2 * runs:]
+    if keyframe:
+        return values.astype(np.uint32).view(np.int32)
+    if previous is None:
+        raise ValueError("Delta frame without a keyframe before it")
+    changes = (values >> np.uint64(1)).astype(np.int64) ^ -(values & np.uint64(1)).astype(np.int64)
+    return (previous + changes).astype(np.int32)
+
+
+class HistoryReader(object):
+    """
+    Reads frames from a history file. Frames are indexed from 0, the counts when the history was started, and each is
+    an int32 array of shape (2, rows, cols) holding the rabbits then the foxes.
+    """
+
+    def __init__(self, path):
+        """
+        Opens the file and reads its index, or walks its chunk headers if it was not closed cleanly.
+
+        :param path: the path of the history file
+        """
+        self.path = path
+        self._file = open(path, "rb")
+        try:
+            magic, version, self.keyframe_interval, rows, cols = _HEADER.unpack(self._file.read(_HEADER.size))
+            if magic != b"RFSIMHIS" or version != 1:
+                raise ValueError("{} is not an rfsim history file".format(path))
+            self.shape = (2, rows, cols)
+            self._chunks = self._read_index()
+        except Exception:
+            self._file.close()
+            raise
+        self._cached_chunk = None
+        self._cached_frame = None
+
+    def _read_chunk_header(self, offset):
+        """
+        Reads the header of the chunk at the given offset.
+
+        :return: the index of its first frame, and the offset and size of each of its frames
+        """
+        self._file.seek(offset)
+        first_frame, num_frames, _ = _CHUNK_HEADER.unpack(self._file.read(_CHUNK_HEADER.size))
+        sizes = np.frombuffer(self._file.read(8 * num_frames), dtype="<u8").astype(np.int64)
+        if len(sizes) != num_frames:
+            raise ValueError("Truncated chunk header")
+        frame_offsets = offset + _CHUNK_HEADER.size + 8 * num_frames + np.concatenate(([0], np.cumsum(sizes)[:-1]))
+        return first_frame, frame_offsets, sizes
+
+    def _read_index(self):
+        """
+        Finds the offset of every chunk, from the index at the end of the file if there is one.
+
+        :return: the offset of each chunk, and the number of frames
+        """
+        file_size = os.fstat(self._file.fileno()).st_size
+        if file_size >= _HEADER.size + _TRAILER.size:
+            self._file.seek(file_size - _TRAILER.size)
+            index_offset, num_chunks, num_frames, magic = _TRAILER.unpack(self._file.read(_TRAILER.size))
+            if magic == b"RFSIMEND":
+                self._file.seek(index_offset)
+                offsets = np.frombuffer(self._file.read(8 * num_chunks), dtype="<u8").astype(np.int64)
+                self._num_frames = num_frames
+                return list(offsets)
+        # Without an index, keep every chunk which was written in full.
+        offsets = []
+        self._num_frames = 0
+        offset = _HEADER.size
+        while offset + _CHUNK_HEADER.size <= file_size:
+            try:
+                first_frame, frame_offsets, sizes = self._read_chunk_header(offset)
+            except (ValueError, struct.error):
+                break
+            end = int(frame_offsets[-1] + sizes[-1]) if len(sizes) > 0 else offset + _CHUNK_HEADER.size
+            if end > file_size or first_frame != self._num_frames:
+                break
+            offsets.append(offset)
+            self._num_frames += len(sizes)
+            offset = end
+        return offsets
+
+    def close(self):
+        """Closes the file."""
+        self._file.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def __len__(self):
+        return self._num_frames
+
+    def _decode_chunk(self, chunk, last):
+        """
+        Decodes the frames of a chunk up to the given one, reading only the bytes they occupy.
+
+        :param chunk: the index of the chunk
+        :param last: the index within the chunk of the last frame needed
+        :return: the decoded frames, from the keyframe to the last needed
+        """
+        first_frame, frame_offsets, sizes = self._read_chunk_header(self._chunks[chunk])
+        start = int(frame_offsets[0])
+        self._file.seek(start)
+        data = self._file.read(int(frame_offsets[last] + sizes[last]) - start)
+        size = int(np.prod(self.shape))
+        frames = []
+        previous = None
+        for k in range(last + 1):
+            begin = int(frame_offsets[k]) - start
+            previous = _decode_frame(data[begin:begin + int(sizes[k])], previous, size)
+            frames.append(previous)
+        return frames
+
+    def _locate(self, index):
+        """Converts a frame index to the index of its chunk and its position within the chunk."""
+        if index < 0:
+            index += self._num_frames
+        if not 0 <= index < self._num_frames:
+            raise IndexError("Frame {} is out of range for {} frames".format(index, self._num_frames))
+        return index // self.keyframe_interval, index % self.keyframe_interval
+
+    def frame(self, index):
+        """
+        Decodes one frame, reading only the part of its chunk up to the frame.
+
+        :param index: the index of the frame, negative values counting back from the end
+        :return: the counts of the frame
+        :rtype: np.ndarray of int32 with shape (2, rows, cols)
+        """
+        chunk, position = self._locate(index)
+        # Reading forwards through a chunk carries on from the last frame decoded, rather than the keyframe.
+        if self._cached_chunk == chunk and self._cached_frame[0] == position - 1:
+            first_frame, frame_offsets, sizes = self._read_chunk_header(self._chunks[chunk])
+            self._file.seek(int(frame_offsets[position]))
+            values = _decode_frame(self._file.read(int(sizes[position])), self._cached_frame[1],
+                                   int(np.prod(self.shape)))
+        else:
+            values = self._decode_chunk(chunk, position)[-1]
+        self._cached_chunk = chunk
+        self._cached_frame = (position, values)
+        # The cached frame is decoded from again, so the caller gets a copy which it is free to change.
+        return values.reshape(self.shape).copy()
+
+    def frames(self, start=0, stop=None, step=1):
+        """
+        Decodes a slice of time, decoding each chunk it touches once.
+
+        :param start: the index of the first frame
+        :param stop: the index after the last frame, defaulting to the end of the history
+        :param step: the number of frames between those returned
+        :return: the counts of each frame
+        :rtype: np.ndarray of int32 with shape (frames, 2, rows, cols)
+        """
+        indices = range(*slice(start, stop, step).indices(self._num_frames))
+        result = np.empty((len(indices),) + self.shape, dtype=np.int32)
+        by_chunk = {}
+        for k, index in enumerate(indices):
+            by_chunk.setdefault(index // self.keyframe_interval, []).append((k, index % self.keyframe_interval))
+        for chunk, wanted in by_chunk.items():
+            decoded = self._decode_chunk(chunk, max(position for _, position in wanted))
+            for k, position in wanted:
+                result[k] = decoded[position].reshape(self.shape)
+        return result
+
+    def __getitem__(self, key):
+        if isinstance(key, slice):
+            return self.frames(key.start, key.stop, 1 if key.step is None else key.step)
+        return self.frame(key)
@@ -115,6 +115,10 @@ class Installer(build_ext):  # pragma: no cover
         try:
             subprocess.check_call(["cmake", src_dir] + cmake_args, cwd=tmp_dir, env=env)
             subprocess.check_call(["cmake", "--build", ".", "--target", "rfsim"] + build_args, cwd=tmp_dir, env=env)
+            if platform.system() != "Windows":
+                subprocess.check_call(
+                    ["cmake", "--build", ".", "--target", "rfsim_server"] + build_args, cwd=tmp_dir, env=env
+                )
         except subprocess.CalledProcessError as cpe:
             raise SystemError("Fatal error running cmake in directory: {}".format(cpe))
         if platform.system() == "Windows":
@@ -33,9 +33,9 @@ bool Animal::oldAge()
     return false;
 }
 
-void Animal::move(std::shared_ptr<RNGController> random)
+void Animal::move(std::shared_ptr<RNGController> random, const ModelParameters &parameters)
 {
-    if(random->d01() < 0.1)
+    if(random->d01() < parameters.move_probability)
     {
         location.x += random->i0(sigma) - int(sigma / 2);
         location.y += random->i0(sigma) - int(sigma / 2);
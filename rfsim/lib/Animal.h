@@ -6,9 +6,11 @@
 #ifndef LIB_RABBIT_H
 #define LIB_RABBIT_H
 
+#include <cmath>
 #include <memory>
 #include "Coordinates.h"
 #include "RNGController.h"
+#include "ModelParameters.h"
 
 /**
  * @brief Class containing the basic behaviours of an animal.
@@ -20,6 +22,49 @@ protected:
     double sigma;
     int age;
     Coordinates location;
+
+    /**
+     * @brief Checks that repeated subtraction of the model's costs from the value is exact, so that the closed-form
+     * population kernels match the sequential versions bit for bit.
+     * @param value the energy or grass amount
+     * @return true if all intermediate values are exactly representable
+     */
+    static bool isExact(double value)
+    {
+        // Below 2^52, subtracting the (integer) costs never needs to round.
+        return std::fabs(value) < 4503599627370496.0;
+    }
+
+    /**
+     * @brief Counts the number of times the cost can be subtracted from the value while it remains above the
+     * threshold, i.e. the number of iterations of while(value > threshold) value -= cost;
+     * @param value the starting value, for which isExact() must be true
+     * @param threshold the threshold which the value must exceed
+     * @param cost the amount subtracted each time
+     * @return the number of subtractions
+     */
+    static unsigned long countSubtractions(double value, double threshold, double cost)
+    {
+        if(!(value > threshold))
+        {
+            return 0;
+        }
+        if(!(value - cost > threshold))
+        {
+            return 1;
+        }
+        auto n = static_cast<unsigned long>(std::ceil((value - threshold) / cost));
+        // Correct for any rounding in the division.
+        while(value - cost * n > threshold)
+        {
+            n++;
+        }
+        while(n > 0 && !(value - cost * (n - 1) > threshold))
+        {
+            n--;
+        }
+        return n;
+    }
 public:
 
     Animal() : energy(0), sigma(0), age(0), location(0, 0)
@@ -75,8 +120,9 @@ public:
     /**
      * @brief Moves a random distance according to a normal distribution.
      * @param random the random number generator
+     * @param parameters the model parameters, giving the probability of moving
      */
-    void move(std::shared_ptr<RNGController> random);
+    void move(std::shared_ptr<RNGController> random, const ModelParameters &parameters);
 
     /**
      * @brief Checks the x, y location of the animal is within the boundaries of the landscape.
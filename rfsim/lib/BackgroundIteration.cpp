@@ -0,0 +1,92 @@
+/**
+ * @brief Contains the runner which iterates a landscape on a background thread.
+ */
+
+#include <chrono>
+#include "BackgroundIteration.h"
+
+BackgroundIteration::BackgroundIteration(Landscape &landscape, unsigned long steps)
+        : landscape(landscape), total(steps), completed(0), cancelled(false), mutex(), finished_condition(),
+          finished(false), error(), thread()
+{
+    thread = std::thread(&BackgroundIteration::run, this);
+}
+
+BackgroundIteration::~BackgroundIteration()
+{
+    cancel();
+    thread.join();
+}
+
+void BackgroundIteration::run()
+{
+    std::exception_ptr run_error;
+    try
+    {
+        for(unsigned long step = 0; step < total && !cancelled; step++)
+        {
+            landscape.iterate();
+            completed++;
+        }
+    }
+    catch(...)
+    {
+        run_error = std::current_exception();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        error = run_error;
+        finished = true;
+    }
+    finished_condition.notify_all();
+}
+
+unsigned long BackgroundIteration::getCompleted() const
+{
+    return completed;
+}
+
+unsigned long BackgroundIteration::getTotal() const
+{
+    return total;
+}
+
+bool BackgroundIteration::isFinished()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return finished;
+}
+
+bool BackgroundIteration::isCancelled() const
+{
+    return cancelled;
+}
+
+bool BackgroundIteration::wait(double timeout)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if(timeout < 0)
+    {
+        finished_condition.wait(lock, [this]{return finished;});
+        return true;
+    }
+    return finished_condition.wait_for(lock, std::chrono::duration<double>(timeout), [this]{return finished;});
+}
+
+void BackgroundIteration::cancel()
+{
+    cancelled = true;
+}
+
+void BackgroundIteration::rethrowError()
+{
+    std::exception_ptr run_error;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        run_error = error;
+    }
+    if(run_error)
+    {
+        std::rethrow_exception(run_error);
+    }
+}
@@ -0,0 +1,100 @@
+/**
+ * @brief Contains the runner which iterates a landscape on a background thread.
+ */
+
+#ifndef LIB_BACKGROUNDITERATION_H
+#define LIB_BACKGROUNDITERATION_H
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include "Landscape.h"
+
+/**
+ * @brief Iterates a landscape for a number of steps on its own thread, which can be monitored, waited for and
+ * cancelled from other threads.
+ *
+ * @details Cancellation is checked between iterations, so the landscape is always left at an iteration boundary. The
+ * landscape must not be used by any other thread until the run has finished.
+ */
+class BackgroundIteration
+{
+protected:
+    Landscape &landscape;
+    const unsigned long total;
+    std::atomic<unsigned long> completed;
+    std::atomic<bool> cancelled;
+    std::mutex mutex;
+    std::condition_variable finished_condition;
+    bool finished;
+    std::exception_ptr error;
+    std::thread thread;
+
+    /**
+     * @brief Runs the iterations, on the background thread.
+     */
+    void run();
+
+public:
+
+    /**
+     * @brief Starts iterating the landscape in the background.
+     * @param landscape the landscape to iterate, which must outlive this object
+     * @param steps the number of iterations to run
+     */
+    BackgroundIteration(Landscape &landscape, unsigned long steps);
+
+    /**
+     * @brief Cancels the run and waits for the current iteration to finish.
+     */
+    ~BackgroundIteration();
+
+    BackgroundIteration(const BackgroundIteration &) = delete;
+
+    BackgroundIteration &operator=(const BackgroundIteration &) = delete;
+
+    /**
+     * @brief Gets the number of iterations which have finished.
+     * @return the number of iterations completed
+     */
+    unsigned long getCompleted() const;
+
+    /**
+     * @brief Gets the number of iterations the run was started with.
+     * @return the total number of iterations
+     */
+    unsigned long getTotal() const;
+
+    /**
+     * @brief Checks whether the run has finished, because it completed, was cancelled or failed.
+     * @return true if the background thread has stopped iterating
+     */
+    bool isFinished();
+
+    /**
+     * @brief Checks whether the run was asked to stop early.
+     * @return true if cancel() has been called
+     */
+    bool isCancelled() const;
+
+    /**
+     * @brief Waits for the run to finish.
+     * @param timeout the maximum number of seconds to wait, or a negative number to wait indefinitely
+     * @return true if the run has finished
+     */
+    bool wait(double timeout);
+
+    /**
+     * @brief Asks the run to stop after the current iteration. Returns without waiting.
+     */
+    void cancel();
+
+    /**
+     * @brief Rethrows the exception which stopped the run, if there was one.
+     */
+    void rethrowError();
+};
+
+#endif //LIB_BACKGROUNDITERATION_H
@@ -35,80 +35,60 @@ void Cell::setup(shared_ptr<RNGController> random)
 
 }
 
-void Cell::growGrass(shared_ptr<RNGController> random)
+void Cell::growGrass(shared_ptr<RNGController> random, const ModelParameters &parameters)
 {
-    grass_amount += random->i0(500) + 1000;
+    grass_amount += random->i0(parameters.grass_variation) + parameters.grass_growth;
 }
 
-void Cell::iterate(shared_ptr<RNGController> random)
+void Cell::iterate(shared_ptr<RNGController> random, const ModelParameters &parameters, PopulationTotals &counted)
 {
-    for(auto &rabbit: rabbits)
-    {
-        if(grass_amount > 1.0)
-        {
-            rabbit.eatGrass(grass_amount);
-            grass_amount -= 30;
-        }
-        rabbit.exist();
-    }
+    grass_amount = Rabbit::grazePopulation(rabbits.begin(), rabbits.size(), grass_amount);
     if(!rabbits.empty())
     {
-        for(auto &fox: foxes)
-        {
-            fox.catchRabbit(rabbits, random);
-            fox.exist();
-        }
-
+        const unsigned long num_rabbits = rabbits.size();
+        Fox::huntPopulation(foxes, rabbits, random);
+        counted.predation += num_rabbits - rabbits.size();
     }
-    reproduce();
+    reproduce(parameters, counted);
+    const unsigned long num_animals = rabbits.size() + foxes.size();
     rabbits.erase(std::remove_if(rabbits.begin(), rabbits.end(),
-                                 [](Rabbit x){return !x.survives();}),
+                                 [](Rabbit &x){return !x.survives();}),
                   rabbits.end());
     foxes.erase(std::remove_if(foxes.begin(), foxes.end(),
-                               [](Fox x){return !x.survives();}),
+                               [](Fox &x){return !x.survives();}),
                 foxes.end());
-    if(foxes.size() > 10)
+    if(foxes.size() > max_foxes_per_cell)
     {
-        int number = static_cast<int>(foxes.size() - 10);
-        foxes.erase(foxes.begin(), foxes.begin() + number);
+        // Drop the excess foxes from the front of the buffer, which are the earliest added. Only the dropped foxes are
+        // destroyed and the survivors are not moved; the freed space at the front is reclaimed lazily, when the buffer
+        // next needs room at the back.
+        foxes.dropFront(foxes.size() - max_foxes_per_cell);
     }
-
+    counted.deaths += num_animals - rabbits.size() - foxes.size();
 }
 
-void Cell::reproduce()
+void Cell::reproduce(const ModelParameters &parameters, PopulationTotals &counted)
 {
-    unsigned long total = 0;
-    for(auto &rabbit: rabbits)
-    {
-        while(rabbit.canReproduce())
-        {
-            total ++;
-        }
-    }
+    unsigned long total = Rabbit::reproducePopulation(rabbits.begin(), rabbits.size(), parameters);
     for(unsigned long i = 0; i < total; i++)
     {
-        rabbits.emplace_back(Rabbit(location));
-    }
-    total = 0;
-    for(auto &fox: foxes)
-    {
-        while(fox.canReproduce())
-        {
-            total ++;
-        }
+        rabbits.emplace_back(location);
     }
+    counted.births += total;
+    total = Fox::reproducePopulation(foxes.begin(), foxes.size(), parameters);
     for(unsigned long i = 0; i < total; i++)
     {
-        foxes.emplace_back(Fox(location));
+        foxes.emplace_back(location);
     }
+    counted.births += total;
 }
 
-vector<Rabbit> Cell::moveRabbits(shared_ptr<RNGController> random, unsigned long x_max, unsigned long y_max)
+void Cell::moveRabbits(shared_ptr<RNGController> random, const ModelParameters &parameters, unsigned long x_max,
+                       unsigned long y_max, vector<Rabbit> &moved_rabbits)
 {
-    vector<Rabbit> moved_rabbits;
     for(auto &rabbit: rabbits)
     {
-        rabbit.move(random);
+        rabbit.move(random, parameters);
         rabbit.checkBoundaries(x_max, y_max);
         if(!rabbit.atLocation(location))
         {
@@ -116,17 +96,16 @@ vector<Rabbit> Cell::moveRabbits(shared_ptr<RNGController> random, unsigned long
         }
     }
     rabbits.erase(std::remove_if(rabbits.begin(), rabbits.end(),
-                                 [this](Rabbit x){return !x.atLocation(this->location);}),
+                                 [this](const Rabbit &x){return !x.atLocation(this->location);}),
                   rabbits.end());
-    return moved_rabbits;
 }
 
-vector<Fox> Cell::moveFoxes(shared_ptr<RNGController> random, const unsigned long &x_max, const unsigned long &y_max)
+void Cell::moveFoxes(shared_ptr<RNGController> random, const ModelParameters &parameters, const unsigned long &x_max,
+                     const unsigned long &y_max, vector<Fox> &moved_foxes)
 {
-    vector<Fox> moved_foxes;
     for(auto &fox: foxes)
     {
-        fox.move(random);
+        fox.move(random, parameters);
         fox.checkBoundaries(x_max, y_max);
         if(!fox.atLocation(location))
         {
@@ -134,9 +113,8 @@ vector<Fox> Cell::moveFoxes(shared_ptr<RNGController> random, const unsigned lon
         }
     }
     foxes.erase(std::remove_if(foxes.begin(), foxes.end(),
-                               [this](Fox x){return !x.atLocation(this->location);}),
+                               [this](const Fox &x){return !x.atLocation(this->location);}),
                 foxes.end());
-    return moved_foxes;
 }
 
 void Cell::addRabbit(Rabbit &rabbit)
@@ -155,12 +133,26 @@ void Cell::setLocation(const Coordinates &coordinates, shared_ptr<RNGController>
     setup(random);
 }
 
-unsigned long Cell::getNumFoxes()
+void Cell::advanceFrom(const Cell &previous)
+{
+    grass_amount = previous.grass_amount;
+    location = previous.location;
+    rabbits = previous.rabbits;
+    foxes = previous.foxes;
+}
+
+void Cell::setArena(PopulationArena* arena)
+{
+    rabbits.setArena(arena);
+    foxes.setArena(arena);
+}
+
+unsigned long Cell::getNumFoxes() const
 {
     return foxes.size();
 }
 
-unsigned long Cell::getNumRabbits()
+unsigned long Cell::getNumRabbits() const
 {
     return rabbits.size();
 }
@@ -6,16 +6,18 @@
 #define LIB_CELL_H
 
 #include <vector>
+#include <algorithm>
 #include "Rabbit.h"
 #include "Fox.h"
 #include "Coordinates.h"
+#include "PopulationTotals.h"
 
 class Cell
 {
 protected:
     double grass_amount;
-    std::vector<Rabbit> rabbits;
-    std::vector<Fox> foxes;
+    RabbitPopulation rabbits;
+    FoxPopulation foxes;
 
     Coordinates location;
 
@@ -36,38 +38,47 @@ public:
 
     /**
      * @brief Grows the grass in this cell
+     * @param random the random number generator
+     * @param parameters the model parameters
      */
-    void growGrass(shared_ptr<RNGController> random);
+    void growGrass(shared_ptr<RNGController> random, const ModelParameters &parameters);
 
     /**
      * @brief Iterate over the consumption stages (rabbits eating grass and foxes eating rabbits).
      * @param random the random number generator
+     * @param parameters the model parameters
+     * @param counted the totals to add the births, deaths and predation in the cell to
      */
-    void iterate(shared_ptr<RNGController> random);
+    void iterate(shared_ptr<RNGController> random, const ModelParameters &parameters, PopulationTotals &counted);
 
     /**
      * @brief Allow animals to reproduce
-     * @param random the random number generator
+     * @param parameters the model parameters
+     * @param counted the totals to add the births to
      */
-    void reproduce();
+    void reproduce(const ModelParameters &parameters, PopulationTotals &counted);
 
     /**
      * @brief Move rabbits according to a dispersal kernel.
      * @param random the random number generator
+     * @param parameters the model parameters
      * @param x_max the max x size of the landscape
      * @param y_max the max y size of the landscape
-     * @return vector containing the rabbits that have moved.
+     * @param moved_rabbits vector to append the rabbits that have moved to
      */
-    vector<Rabbit> moveRabbits(shared_ptr<RNGController> random, unsigned long x_max, unsigned long y_max);
+    void moveRabbits(shared_ptr<RNGController> random, const ModelParameters &parameters, unsigned long x_max,
+                     unsigned long y_max, vector<Rabbit> &moved_rabbits);
 
     /**
      * @brief Move foxes according to a dispersal kernel.
      * @param random the random number generator
+     * @param parameters the model parameters
      * @param x_max the max x size of the landscape
      * @param y_max the max y size of the landscape
-     * @return vector containing the foxes that have moved.
+     * @param moved_foxes vector to append the foxes that have moved to
      */
-    vector<Fox> moveFoxes(shared_ptr<RNGController> random, const unsigned long &x_max, const unsigned long &y_max);
+    void moveFoxes(shared_ptr<RNGController> random, const ModelParameters &parameters, const unsigned long &x_max,
+                   const unsigned long &y_max, vector<Fox> &moved_foxes);
 
     /**
      * @brief Adds a rabbit to the cell
@@ -87,18 +98,46 @@ public:
      */
     void setLocation(const Coordinates &coordinates, shared_ptr<RNGController> random);
 
+    /**
+     * @brief Copies the state of the same cell in the previous generation, replacing this cell's state.
+     * @details The previous cell is left unchanged. This cell's storage, left from two generations before, is reused
+     * for the copies, so they rarely need to allocate.
+     * @param previous the cell in the previous generation
+     */
+    void advanceFrom(const Cell &previous);
+
+    /**
+     * @brief Sets the arena which the cell's populations take their heap storage from.
+     * @details Any populations already on the heap are packed into the new arena, so this is also used to compact the
+     * landscape's population storage.
+     * @param arena the arena to use
+     */
+    void setArena(PopulationArena* arena);
+
     /**
      * @brief Get the number of foxes in the cell
      * @return the number of foxes
      */
-    unsigned long getNumFoxes();
+    unsigned long getNumFoxes() const;
 
     /**
      * @brief Get the number of rabbits in the cell
      * @return the number of rabbits
      */
-    unsigned long getNumRabbits();
+    unsigned long getNumRabbits() const;
+
+    /**
+     * @brief Get the amount of grass in the cell
+     * @return the amount of grass
+     */
+    double getGrass() const
+    {
+        return grass_amount;
+    }
 
 };
 
+// Every byte of a cell is paid for in each generation of every cell, so check the inline buffers have not grown it.
+static_assert(sizeof(Cell) <= 256, "Cells should fit in four cache lines; check the populations' inline capacities.");
+
 #endif //LIB_CELL_H
@@ -0,0 +1,245 @@
+/**
+ * @brief Contains the multi-resolution pyramid of the landscape's populations, for viewing large landscapes.
+ */
+
+#ifndef LIB_DENSITYPYRAMID_H
+#define LIB_DENSITYPYRAMID_H
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * @brief A mip-map pyramid of the rabbits, foxes and grass in the landscape, in which each element of a level is the
+ * sum over a 2x2 block of the level below.
+ *
+ * @details Level k covers blocks of 2^k by 2^k cells, so has ceil(rows / 2^k) rows and ceil(cols / 2^k) columns, with
+ * the blocks along the bottom and right edges covering fewer cells where the landscape does not divide evenly. Level 0
+ * would be the landscape itself and is not stored; level 1 is summed directly from the cells, and each level above
+ * from the one below it.
+ */
+class DensityPyramid
+{
+public:
+    // Called as parallel_for(n, function) to call function(k) for each k from 0 to n, in any order and on any thread
+    typedef std::function<void(unsigned long, const std::function<void(unsigned long)>&)> ParallelFor;
+
+protected:
+    unsigned long num_rows;
+    unsigned long num_cols;
+    // The sums at each level, starting from level 1, in row-major order
+    std::vector<std::vector<int64_t>> rabbits;
+    std::vector<std::vector<int64_t>> foxes;
+    std::vector<std::vector<double>> grass;
+
+    /**
+     * @brief Checks that the level has been built.
+     * @throws std::out_of_range if it has not
+     */
+    void checkLevel(unsigned long level) const
+    {
+        if(level == 0 || level > rabbits.size())
+        {
+            throw std::out_of_range("The pyramid level has not been built.");
+        }
+    }
+
+    /**
+     * @brief Sums 2x2 blocks of one level into the next.
+     * @details Rows are reduced in pairs, with the inner loop over contiguous elements so that it can be vectorised.
+     * @param below the level to sum, of rows by cols elements
+     * @param above the next level, of ceil(rows / 2) by ceil(cols / 2) elements
+     * @param parallel_for runs the bands of rows
+     * @param num_tasks the number of bands of rows to split the work into
+     */
+    template<class T>
+    static void reduce(const std::vector<T> &below, std::vector<T> &above, unsigned long rows, unsigned long cols,
+                       const ParallelFor &parallel_for, unsigned long num_tasks)
+    {
+        const unsigned long above_rows = (rows + 1) / 2;
+        const unsigned long above_cols = (cols + 1) / 2;
+        const unsigned long full_cols = cols / 2;
+        above.assign(above_rows * above_cols, T());
+        const unsigned long tasks = std::max(1ul, std::min(num_tasks, above_rows));
+        parallel_for(tasks, [&below, &above, rows, cols, above_rows, above_cols, full_cols, tasks](unsigned long task)
+        {
+            for(unsigned long r = task * above_rows / tasks; r < (task + 1) * above_rows / tasks; r++)
+            {
+                const T* __restrict top = below.data() + 2 * r * cols;
+                // The last row of an odd number of rows is summed with nothing below it.
+                const bool has_bottom = 2 * r + 1 < rows;
+                const T* __restrict bottom = has_bottom ? top + cols : top;
+                T* __restrict out = above.data() + r * above_cols;
+                if(has_bottom)
+                {
+                    for(unsigned long c = 0; c < full_cols; c++)
+                    {
+                        out[c] = top[2 * c] + top[2 * c + 1] + bottom[2 * c] + bottom[2 * c + 1];
+                    }
+                }
+                else
+                {
+                    for(unsigned long c = 0; c < full_cols; c++)
+                    {
+                        out[c] = top[2 * c] + top[2 * c + 1];
+                    }
+                }
+                if(full_cols < above_cols)
+                {
+                    out[full_cols] = top[cols - 1] + (has_bottom ? bottom[cols - 1] : T());
+                }
+            }
+        });
+    }
+
+public:
+
+    DensityPyramid() : num_rows(0), num_cols(0), rabbits(), foxes(), grass()
+    {
+
+    }
+
+    /**
+     * @brief Gets the size of a dimension of the landscape at the given level.
+     * @param size the number of rows or columns in the landscape
+     * @param level the level
+     * @return the number of rows or columns at the level
+     */
+    static unsigned long levelSize(unsigned long size, unsigned long level)
+    {
+        return level >= 64 ? std::min(size, 1ul) : (size + (1ul << level) - 1) >> level;
+    }
+
+    /**
+     * @brief Builds the levels of the pyramid from 1 up to the given level.
+     * @param rows the number of rows in the landscape
+     * @param cols the number of columns in the landscape
+     * @param top_level the highest level to build
+     * @param counts called as counts(row, column, rabbits, foxes, grass) to read each cell
+     * @param parallel_for runs the bands of rows
+     * @param num_tasks the number of bands of rows to split each level into
+     */
+    template<class Counts>
+    void build(unsigned long rows, unsigned long cols, unsigned long top_level, Counts counts,
+               const ParallelFor &parallel_for, unsigned long num_tasks)
+    {
+        num_rows = rows;
+        num_cols = cols;
+        rabbits.resize(top_level);
+        foxes.resize(top_level);
+        grass.resize(top_level);
+        if(top_level == 0)
+        {
+            return;
+        }
+        const unsigned long base_rows = levelSize(rows, 1);
+        const unsigned long base_cols = levelSize(cols, 1);
+        rabbits[0].assign(base_rows * base_cols, 0);
+        foxes[0].assign(base_rows * base_cols, 0);
+        grass[0].assign(base_rows * base_cols, 0.0);
+        const unsigned long tasks = std::max(1ul, std::min(num_tasks, base_rows));
+        parallel_for(tasks, [this, rows, cols, base_rows, base_cols, tasks, &counts](unsigned long task)
+        {
+            const unsigned long row_end = std::min(rows, 2 * ((task + 1) * base_rows / tasks));
+            for(unsigned long i = 2 * (task * base_rows / tasks); i < row_end; i++)
+            {
+                const unsigned long offset = (i / 2) * base_cols;
+                for(unsigned long j = 0; j < cols; j++)
+                {
+                    unsigned long cell_rabbits;
+                    unsigned long cell_foxes;
+                    double cell_grass;
+                    counts(i, j, cell_rabbits, cell_foxes, cell_grass);
+                    rabbits[0][offset + j / 2] += cell_rabbits;
+                    foxes[0][offset + j / 2] += cell_foxes;
+                    grass[0][offset + j / 2] += cell_grass;
+                }
+            }
+        });
+        for(unsigned long level = 2; level <= top_level; level++)
+        {
+            const unsigned long below_rows = levelSize(rows, level - 1);
+            const unsigned long below_cols = levelSize(cols, level - 1);
+            reduce(rabbits[level - 2], rabbits[level - 1], below_rows, below_cols, parallel_for, num_tasks);
+            reduce(foxes[level - 2], foxes[level - 1], below_rows, below_cols, parallel_for, num_tasks);
+            reduce(grass[level - 2], grass[level - 1], below_rows, below_cols, parallel_for, num_tasks);
+        }
+    }
+
+    /**
+     * @brief Gets the highest level which has been built.
+     */
+    unsigned long getLevels() const
+    {
+        return rabbits.size();
+    }
+
+    /**
+     * @brief Gets the number of rows at the given level.
+     */
+    unsigned long getRows(unsigned long level) const
+    {
+        return levelSize(num_rows, level);
+    }
+
+    /**
+     * @brief Gets the number of columns at the given level.
+     */
+    unsigned long getCols(unsigned long level) const
+    {
+        return levelSize(num_cols, level);
+    }
+
+    /**
+     * @brief Gets the number of landscape cells covered by an element of the given level.
+     * @param level the level
+     * @param row the row of the element at the level
+     * @param col the column of the element at the level
+     * @return the number of cells, which is less than 4^level only along the bottom and right edges
+     */
+    unsigned long getCellsCovered(unsigned long level, unsigned long row, unsigned long col) const
+    {
+        const unsigned long block = 1ul << level;
+        return std::min(block, num_rows - row * block) * std::min(block, num_cols - col * block);
+    }
+
+    /**
+     * @brief Gets the rabbit sums at the given level, which must have been built.
+     * @param level the level, from 1 to getLevels()
+     * @return the sums, in row-major order
+     * @throws std::out_of_range if the level has not been built
+     */
+    const std::vector<int64_t> &getRabbits(unsigned long level) const
+    {
+        checkLevel(level);
+        return rabbits[level - 1];
+    }
+
+    /**
+     * @brief Gets the fox sums at the given level, which must have been built.
+     * @param level the level, from 1 to getLevels()
+     * @return the sums, in row-major order
+     * @throws std::out_of_range if the level has not been built
+     */
+    const std::vector<int64_t> &getFoxes(unsigned long level) const
+    {
+        checkLevel(level);
+        return foxes[level - 1];
+    }
+
+    /**
+     * @brief Gets the grass sums at the given level, which must have been built.
+     * @param level the level, from 1 to getLevels()
+     * @return the sums, in row-major order
+     * @throws std::out_of_range if the level has not been built
+     */
+    const std::vector<double> &getGrass(unsigned long level) const
+    {
+        checkLevel(level);
+        return grass[level - 1];
+    }
+};
+
+#endif //LIB_DENSITYPYRAMID_H
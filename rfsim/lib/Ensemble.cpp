@@ -0,0 +1,91 @@
+/**
+ * @brief Contains the ensemble runner, which simulates many replicates of the same landscape in parallel.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include "Ensemble.h"
+
+void Ensemble::runReplicate(unsigned long replicate, unsigned long seed, const EnsembleOutput &output,
+                            unsigned long first_band) const
+{
+    Landscape landscape;
+    landscape.setSeed(seed);
+    landscape.setParameters(parameters);
+    if(cell_streams)
+    {
+        // Replicates are already run in parallel, so each runs on the calling thread alone.
+        landscape.setThreads(1, 4096);
+    }
+    landscape.setLandscapeSize(x_size, y_size);
+    const bool record_steps = output.step_rabbits != nullptr && output.step_foxes != nullptr;
+    std::vector<unsigned long> rabbit_totals;
+    std::vector<unsigned long> fox_totals;
+    for(unsigned long step = 0; step < steps; step++)
+    {
+        landscape.iterate();
+        if(record_steps || output.statistics != nullptr)
+        {
+            rabbit_totals.push_back(landscape.getTotals().rabbits);
+            fox_totals.push_back(landscape.getTotals().foxes);
+        }
+    }
+    if(record_steps)
+    {
+        std::copy(rabbit_totals.begin(), rabbit_totals.end(), output.step_rabbits + replicate * steps);
+        std::copy(fox_totals.begin(), fox_totals.end(), output.step_foxes + replicate * steps);
+    }
+    std::vector<unsigned long> rabbits;
+    std::vector<unsigned long> foxes;
+    for(unsigned long i = 0; i < y_size; i++)
+    {
+        for(unsigned long j = 0; j < x_size; j++)
+        {
+            rabbits.push_back(landscape.getNumRabbits(i, j));
+            foxes.push_back(landscape.getNumFoxes(i, j));
+        }
+    }
+    if(output.final_rabbits != nullptr && output.final_foxes != nullptr)
+    {
+        unsigned long offset = replicate * x_size * y_size;
+        for(unsigned long cell = 0; cell < rabbits.size(); cell++)
+        {
+            output.final_rabbits[offset + cell] = static_cast<int>(rabbits[cell]);
+            output.final_foxes[offset + cell] = static_cast<int>(foxes[cell]);
+        }
+    }
+    if(output.statistics != nullptr)
+    {
+        output.statistics->addReplicate(replicate, rabbits, foxes, rabbit_totals, fox_totals, first_band);
+    }
+}
+
+void Ensemble::run(const std::vector<unsigned long> &seeds, unsigned long threads, const EnsembleOutput &output) const
+{
+    WorkStealingScheduler scheduler(threads);
+    unsigned long num_bands = output.statistics == nullptr ? 1 : output.statistics->getNumBands();
+    // Replicates are started in order, rather than each thread taking a contiguous range, so that those finishing
+    // early wait only briefly in the statistics' reorder buffer for the ones before them.
+    std::atomic<unsigned long> next_replicate(0);
+    scheduler.run(threads, [this, &seeds, &output, &next_replicate, num_bands, threads](unsigned long,
+                                                                                      unsigned long worker)
+    {
+        for(unsigned long replicate = next_replicate++; replicate < seeds.size(); replicate = next_replicate++)
+        {
+            const unsigned long first_band = worker * num_bands / threads;
+            try
+            {
+                runReplicate(replicate, seeds[replicate], output, first_band);
+            }
+            catch(...)
+            {
+                // Otherwise every later replicate would wait in the statistics' reorder buffer for this one.
+                if(output.statistics != nullptr)
+                {
+                    output.statistics->skipReplicate(replicate, first_band);
+                }
+                throw;
+            }
+        }
+    }, false);
+}
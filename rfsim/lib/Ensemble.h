@@ -0,0 +1,93 @@
+/**
+ * @brief Contains the ensemble runner, which simulates many replicates of the same landscape in parallel.
+ */
+
+#ifndef LIB_ENSEMBLE_H
+#define LIB_ENSEMBLE_H
+
+#include <vector>
+#include "Landscape.h"
+#include "EnsembleStatistics.h"
+
+/**
+ * @brief The buffers the results of an ensemble are written to, each holding one entry per replicate.
+ */
+struct EnsembleOutput
+{
+    // Optionally, the final number of rabbits and foxes in each cell, of shape (replicates, y_size, x_size)
+    int* final_rabbits = nullptr;
+    int* final_foxes = nullptr;
+    // Optionally, the total number of rabbits and foxes after each step, of shape (replicates, steps)
+    unsigned long* step_rabbits = nullptr;
+    unsigned long* step_foxes = nullptr;
+    // Optionally, the reducer to add each replicate's results to as it finishes, instead of keeping every replicate
+    EnsembleStatistics* statistics = nullptr;
+};
+
+/**
+ * @brief Runs replicates of the same landscape configuration with different seeds on a pool of threads, each thread
+ * taking the next replicate in order as it finishes the last.
+ *
+ * @details Each replicate runs single-threaded, exactly as a CLandscape set up with the same seed, size and parameters
+ * would, so the results do not depend on the number of threads.
+ */
+class Ensemble
+{
+protected:
+    unsigned long x_size;
+    unsigned long y_size;
+    unsigned long steps;
+    ModelParameters parameters;
+    bool cell_streams;
+
+public:
+
+    /**
+     * @brief Creates the ensemble.
+     * @param x_size the x dimension of each landscape
+     * @param y_size the y dimension of each landscape
+     * @param steps the number of iterations to run each replicate for
+     * @param parameters the model parameters of every replicate
+     */
+    Ensemble(unsigned long x_size, unsigned long y_size, unsigned long steps,
+             const ModelParameters &parameters = ModelParameters()) : x_size(x_size), y_size(y_size), steps(steps),
+                                                                      parameters(parameters), cell_streams(false)
+    {
+    }
+
+    virtual ~Ensemble() = default;
+
+    /**
+     * @brief Sets whether each replicate draws from one random number stream per cell and step, as a CLandscape does
+     * once set_threads() has been called, rather than from a single stream shared by the whole landscape.
+     * @details Per-cell streams keep two runs with the same seed drawing the same numbers in each cell even once their
+     * populations differ, which is needed for common random numbers to be effective.
+     * @param enabled true to use per-cell streams
+     */
+    void setCellStreams(bool enabled)
+    {
+        cell_streams = enabled;
+    }
+
+    /**
+     * @brief Runs a single replicate and writes its results to the output buffers.
+     * @param replicate the index of the replicate
+     * @param seed the random number seed
+     * @param output the output buffers
+     * @param first_band the band of the statistics to update first
+     */
+    virtual void runReplicate(unsigned long replicate, unsigned long seed, const EnsembleOutput &output,
+                              unsigned long first_band) const;
+
+    /**
+     * @brief Runs one replicate for each seed.
+     * @details Any exception thrown by a replicate is rethrown once the others have finished. A replicate which throws
+     * is skipped in the statistics, which hold the replicates which finished.
+     * @param seeds the seed of each replicate
+     * @param threads the number of threads to run the replicates on
+     * @param output the buffers to write the results to, which must be large enough for every replicate
+     */
+    void run(const std::vector<unsigned long> &seeds, unsigned long threads, const EnsembleOutput &output) const;
+};
+
+#endif //LIB_ENSEMBLE_H
@@ -0,0 +1,311 @@
+/**
+ * @brief Contains the streaming reducers which summarise the results of an ensemble without storing each replicate.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include "EnsembleStatistics.h"
+
+SummaryStatistics::SummaryStatistics(unsigned long num_variables, const std::vector<double> &quantiles)
+        : num_variables(num_variables), quantiles(quantiles), counts(num_variables, 0), means(num_variables, 0.0),
+          squared_deviations(num_variables, 0.0), zeros(num_variables, 0),
+          marker_heights(num_variables * quantiles.size() * 5, 0.0),
+          marker_positions(num_variables * quantiles.size() * 5, 0)
+{
+    for(const auto &p : quantiles)
+    {
+        if(!(p >= 0.0 && p <= 1.0))
+        {
+            throw std::invalid_argument("Quantiles must be between 0 and 1.");
+        }
+    }
+}
+
+void SummaryStatistics::addToSketch(double* heights, uint32_t* positions, unsigned long count, double p, double x)
+{
+    if(count < 5)
+    {
+        // Until the markers are initialised, keep the observations sorted in the marker heights.
+        unsigned long i = count;
+        while(i > 0 && heights[i - 1] > x)
+        {
+            heights[i] = heights[i - 1];
+            i--;
+        }
+        heights[i] = x;
+        if(count == 4)
+        {
+            for(uint32_t marker = 0; marker < 5; marker++)
+            {
+                positions[marker] = marker + 1;
+            }
+        }
+        return;
+    }
+    // Find the cell the observation falls in, extending the extreme markers if required.
+    unsigned long k;
+    if(x < heights[0])
+    {
+        heights[0] = x;
+        k = 0;
+    }
+    else if(x >= heights[4])
+    {
+        heights[4] = x;
+        k = 3;
+    }
+    else
+    {
+        k = 0;
+        while(x >= heights[k + 1])
+        {
+            k++;
+        }
+    }
+    for(unsigned long marker = k + 1; marker < 5; marker++)
+    {
+        positions[marker]++;
+    }
+    const double increments[5] = {0.0, p / 2.0, p, (1.0 + p) / 2.0, 1.0};
+    const double total = static_cast<double>(count);
+    for(unsigned long i = 1; i < 4; i++)
+    {
+        double desired = 1.0 + total * increments[i];
+        double difference = desired - positions[i];
+        long above = static_cast<long>(positions[i + 1]) - static_cast<long>(positions[i]);
+        long below = static_cast<long>(positions[i - 1]) - static_cast<long>(positions[i]);
+        if((difference >= 1.0 && above > 1) || (difference <= -1.0 && below < -1))
+        {
+            long step = difference >= 0.0 ? 1 : -1;
+            double n_below = positions[i - 1];
+            double n = positions[i];
+            double n_above = positions[i + 1];
+            double parabolic = heights[i] + step / (n_above - n_below)
+                                            * ((n - n_below + step) * (heights[i + 1] - heights[i]) / (n_above - n)
+                                               + (n_above - n - step) * (heights[i] - heights[i - 1]) / (n - n_below));
+            if(heights[i - 1] < parabolic && parabolic < heights[i + 1])
+            {
+                heights[i] = parabolic;
+            }
+            else
+            {
+                unsigned long neighbour = static_cast<unsigned long>(static_cast<long>(i) + step);
+                heights[i] += step * (heights[neighbour] - heights[i])
+                              / (static_cast<double>(positions[neighbour]) - n);
+            }
+            positions[i] = static_cast<uint32_t>(static_cast<long>(positions[i]) + step);
+        }
+    }
+}
+
+void SummaryStatistics::add(unsigned long first, unsigned long last, const unsigned long* values)
+{
+    const unsigned long num_quantiles = quantiles.size();
+    for(unsigned long variable = first; variable < last; variable++)
+    {
+        double x = static_cast<double>(values[variable - first]);
+        unsigned long count = counts[variable];
+        // Welford's update of the mean and sum of squared deviations
+        double delta = x - means[variable];
+        means[variable] += delta / static_cast<double>(count + 1);
+        squared_deviations[variable] += delta * (x - means[variable]);
+        if(values[variable - first] == 0)
+        {
+            zeros[variable]++;
+        }
+        for(unsigned long q = 0; q < num_quantiles; q++)
+        {
+            unsigned long offset = (variable * num_quantiles + q) * 5;
+            addToSketch(&marker_heights[offset], &marker_positions[offset], count, quantiles[q], x);
+        }
+        counts[variable] = count + 1;
+    }
+}
+
+unsigned long SummaryStatistics::getCount(unsigned long variable) const
+{
+    return counts[variable];
+}
+
+double SummaryStatistics::getMean(unsigned long variable) const
+{
+    return counts[variable] == 0 ? std::numeric_limits<double>::quiet_NaN() : means[variable];
+}
+
+double SummaryStatistics::getVariance(unsigned long variable) const
+{
+    if(counts[variable] < 2)
+    {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    return squared_deviations[variable] / static_cast<double>(counts[variable] - 1);
+}
+
+double SummaryStatistics::getQuantile(unsigned long variable, unsigned long quantile) const
+{
+    unsigned long count = counts[variable];
+    const double* heights = &marker_heights[(variable * quantiles.size() + quantile) * 5];
+    if(count == 0)
+    {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    if(count <= 5)
+    {
+        // The markers are still the sorted observations themselves.
+        return heights[static_cast<unsigned long>(std::lround(quantiles[quantile] * (count - 1)))];
+    }
+    return heights[2];
+}
+
+double SummaryStatistics::getZeroFraction(unsigned long variable) const
+{
+    if(counts[variable] == 0)
+    {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    return static_cast<double>(zeros[variable]) / static_cast<double>(counts[variable]);
+}
+
+unsigned long SummaryStatistics::getNumVariables() const
+{
+    return num_variables;
+}
+
+const std::vector<double> &SummaryStatistics::getQuantiles() const
+{
+    return quantiles;
+}
+
+EnsembleStatistics::EnsembleStatistics(unsigned long num_cells, unsigned long steps,
+                                       const std::vector<double> &quantiles, unsigned long num_bands)
+        : num_cells(num_cells), steps(steps), band_size(0), cell_rabbits(num_cells, quantiles),
+          cell_foxes(num_cells, quantiles), step_rabbits(steps, quantiles), step_foxes(steps, quantiles),
+          band_mutexes(), step_mutex(), next_replicates(), pending(), pending_mutex()
+{
+    num_bands = std::max(1ul, std::min(num_bands, num_cells));
+    band_size = num_cells == 0 ? 1 : (num_cells + num_bands - 1) / num_bands;
+    for(unsigned long band = 0; band < num_bands; band++)
+    {
+        band_mutexes.push_back(std::unique_ptr<std::mutex>(new std::mutex()));
+    }
+    next_replicates.assign(num_bands + 1, 0);
+}
+
+void EnsembleStatistics::addInOrder(unsigned long part)
+{
+    const unsigned long num_bands = band_mutexes.size();
+    std::lock_guard<std::mutex> part_lock(part == num_bands ? step_mutex : *band_mutexes[part]);
+    while(true)
+    {
+        const unsigned long replicate = next_replicates[part];
+        std::shared_ptr<PendingReplicate> results;
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex);
+            auto found = pending.find(replicate);
+            if(found == pending.end())
+            {
+                return;
+            }
+            results = found->second;
+        }
+        if(results->skipped)
+        {
+            // Nothing to add, but the replicates after it no longer wait.
+        }
+        else if(part == num_bands)
+        {
+            step_rabbits.add(0, steps, results->rabbit_totals.data());
+            step_foxes.add(0, steps, results->fox_totals.data());
+        }
+        else
+        {
+            const unsigned long first = part * band_size;
+            const unsigned long last = std::min(first + band_size, num_cells);
+            if(first < last)
+            {
+                cell_rabbits.add(first, last, &results->rabbits[first]);
+                cell_foxes.add(first, last, &results->foxes[first]);
+            }
+        }
+        next_replicates[part]++;
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        if(--results->remaining == 0)
+        {
+            pending.erase(replicate);
+        }
+    }
+}
+
+void EnsembleStatistics::addReplicate(unsigned long replicate, const std::vector<unsigned long> &rabbits,
+                                      const std::vector<unsigned long> &foxes,
+                                      const std::vector<unsigned long> &rabbit_totals,
+                                      const std::vector<unsigned long> &fox_totals, unsigned long first_band)
+{
+    if(rabbits.size() != num_cells || foxes.size() != num_cells || rabbit_totals.size() != steps
+       || fox_totals.size() != steps)
+    {
+        throw std::invalid_argument("Replicate does not match the size of the ensemble statistics.");
+    }
+    const unsigned long num_bands = band_mutexes.size();
+    enqueue(replicate, std::shared_ptr<PendingReplicate>(
+            new PendingReplicate{rabbits, foxes, rabbit_totals, fox_totals, num_bands + 1, false}), first_band);
+}
+
+void EnsembleStatistics::skipReplicate(unsigned long replicate, unsigned long first_band)
+{
+    const unsigned long num_bands = band_mutexes.size();
+    enqueue(replicate, std::shared_ptr<PendingReplicate>(new PendingReplicate{{}, {}, {}, {}, num_bands + 1, true}),
+            first_band);
+}
+
+void EnsembleStatistics::enqueue(unsigned long replicate, const std::shared_ptr<PendingReplicate> &results,
+                                 unsigned long first_band)
+{
+    const unsigned long num_bands = band_mutexes.size();
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        if(!pending.emplace(replicate, results).second)
+        {
+            throw std::invalid_argument("Replicate has already been added to the ensemble statistics.");
+        }
+    }
+    // Whichever thread adds the replicate which is next in order also adds any later replicates already waiting.
+    addInOrder(num_bands);
+    for(unsigned long offset = 0; offset < num_bands; offset++)
+    {
+        addInOrder((first_band + offset) % num_bands);
+    }
+}
+
+unsigned long EnsembleStatistics::getNumPending()
+{
+    std::lock_guard<std::mutex> lock(pending_mutex);
+    return pending.size();
+}
+
+unsigned long EnsembleStatistics::getNumBands() const
+{
+    return band_mutexes.size();
+}
+
+const SummaryStatistics &EnsembleStatistics::getCellRabbits() const
+{
+    return cell_rabbits;
+}
+
+const SummaryStatistics &EnsembleStatistics::getCellFoxes() const
+{
+    return cell_foxes;
+}
+
+const SummaryStatistics &EnsembleStatistics::getStepRabbits() const
+{
+    return step_rabbits;
+}
+
+const SummaryStatistics &EnsembleStatistics::getStepFoxes() const
+{
+    return step_foxes;
+}
@@ -0,0 +1,230 @@
+/**
+ * @brief Contains the streaming reducers which summarise the results of an ensemble without storing each replicate.
+ */
+
+#ifndef LIB_ENSEMBLESTATISTICS_H
+#define LIB_ENSEMBLESTATISTICS_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Running summaries of many variables, each observed once per replicate: the mean and variance (by Welford's
+ * algorithm), a P² sketch for each quantile, and the number of replicates in which the variable was zero.
+ *
+ * @details Memory is constant in the number of replicates. The P² algorithm (Jain & Chlamtac, 1985) tracks five
+ * markers per quantile, adjusting their heights by piecewise-parabolic interpolation as observations arrive. Not
+ * thread-safe: callers must not add to the same variable from two threads at once.
+ */
+class SummaryStatistics
+{
+protected:
+    unsigned long num_variables;
+    std::vector<double> quantiles;
+    std::vector<unsigned long> counts;
+    std::vector<double> means;
+    std::vector<double> squared_deviations;
+    std::vector<unsigned long> zeros;
+    // The five marker heights and positions of each variable's sketch for each quantile
+    std::vector<double> marker_heights;
+    std::vector<uint32_t> marker_positions;
+
+    /**
+     * @brief Adds an observation to a single P² sketch.
+     * @param heights the marker heights
+     * @param positions the marker positions
+     * @param count the number of observations before this one
+     * @param p the quantile the sketch estimates
+     * @param x the observation
+     */
+    static void addToSketch(double* heights, uint32_t* positions, unsigned long count, double p, double x);
+
+public:
+
+    /**
+     * @brief Creates the summaries.
+     * @param num_variables the number of variables to summarise
+     * @param quantiles the quantiles to estimate, each between 0 and 1
+     */
+    SummaryStatistics(unsigned long num_variables, const std::vector<double> &quantiles);
+
+    /**
+     * @brief Adds one observation of each of a contiguous range of variables.
+     * @param first the first variable
+     * @param last one past the last variable
+     * @param values the observations, indexed from the first variable
+     */
+    void add(unsigned long first, unsigned long last, const unsigned long* values);
+
+    /**
+     * @brief Gets the number of observations of the variable.
+     * @param variable the variable
+     * @return the number of observations
+     */
+    unsigned long getCount(unsigned long variable) const;
+
+    /**
+     * @brief Gets the mean of the variable.
+     * @param variable the variable
+     * @return the mean, or NaN if there have been no observations
+     */
+    double getMean(unsigned long variable) const;
+
+    /**
+     * @brief Gets the sample variance of the variable.
+     * @param variable the variable
+     * @return the variance, or NaN if there have been fewer than two observations
+     */
+    double getVariance(unsigned long variable) const;
+
+    /**
+     * @brief Gets the estimate of a quantile of the variable.
+     * @details Exact (by nearest rank) for up to five observations.
+     * @param variable the variable
+     * @param quantile the index of the quantile, in the order given on construction
+     * @return the estimate, or NaN if there have been no observations
+     */
+    double getQuantile(unsigned long variable, unsigned long quantile) const;
+
+    /**
+     * @brief Gets the fraction of observations of the variable which were zero.
+     * @param variable the variable
+     * @return the fraction, or NaN if there have been no observations
+     */
+    double getZeroFraction(unsigned long variable) const;
+
+    /**
+     * @brief Gets the number of variables summarised.
+     * @return the number of variables
+     */
+    unsigned long getNumVariables() const;
+
+    /**
+     * @brief Gets the quantiles which are estimated.
+     * @return the quantiles
+     */
+    const std::vector<double> &getQuantiles() const;
+};
+
+/**
+ * @brief Reduces the replicates of an ensemble, as they are produced, to summaries of the final count in each cell
+ * and of the landscape's total counts after each step.
+ *
+ * @details Replicates may be added from any number of threads at once. The cells are split into bands of rows, each
+ * with its own lock, and each thread starts at a different band, so threads finishing replicates together update
+ * different parts of the summaries rather than waiting on one another. The P² sketches cannot be merged after the
+ * fact, which is why the threads combine their results into one shared set of summaries as they go.
+ *
+ * The P² estimates and the floating-point means depend on the order of the observations, so each band adds the
+ * replicates in the order of their indices, whatever order they finish in. A replicate which finishes before an
+ * earlier one is held in a reorder buffer until the earlier one has been added, so the summaries do not depend on the
+ * number of threads. The buffer stays small as long as replicates are started in order of their indices. A replicate
+ * which failed must be skipped with skipReplicate(), or every later replicate would wait in the buffer for it forever.
+ */
+class EnsembleStatistics
+{
+protected:
+    /**
+     * @brief The results of a replicate which have not yet been added to every part of the summaries.
+     */
+    struct PendingReplicate
+    {
+        std::vector<unsigned long> rabbits;
+        std::vector<unsigned long> foxes;
+        std::vector<unsigned long> rabbit_totals;
+        std::vector<unsigned long> fox_totals;
+        // The number of parts (bands and the step totals) the replicate has still to be added to
+        unsigned long remaining;
+        // True if the replicate failed, so is passed over rather than added
+        bool skipped;
+    };
+
+    unsigned long num_cells;
+    unsigned long steps;
+    unsigned long band_size;
+    SummaryStatistics cell_rabbits;
+    SummaryStatistics cell_foxes;
+    SummaryStatistics step_rabbits;
+    SummaryStatistics step_foxes;
+    std::vector<std::unique_ptr<std::mutex>> band_mutexes;
+    std::mutex step_mutex;
+    // The index of the next replicate to add to each band, then to the step totals, each guarded by the part's lock
+    std::vector<unsigned long> next_replicates;
+    // The reorder buffer of replicates not yet added to every part
+    std::map<unsigned long, std::shared_ptr<PendingReplicate>> pending;
+    std::mutex pending_mutex;
+
+    /**
+     * @brief Adds every replicate which is next in order to one part of the summaries.
+     * @param part the band, or the number of bands for the step totals
+     */
+    void addInOrder(unsigned long part);
+
+    /**
+     * @brief Puts a replicate in the reorder buffer, then adds every replicate which is next in order.
+     * @param replicate the index of the replicate
+     * @param results the results of the replicate
+     * @param first_band the band to update first
+     * @throws std::invalid_argument if the replicate has already been added or skipped
+     */
+    void enqueue(unsigned long replicate, const std::shared_ptr<PendingReplicate> &results, unsigned long first_band);
+
+public:
+
+    /**
+     * @brief Creates the reducer.
+     * @param num_cells the number of cells in each landscape
+     * @param steps the number of steps in each replicate
+     * @param quantiles the quantiles to estimate
+     * @param num_bands the number of separately-locked bands to split the cells into
+     */
+    EnsembleStatistics(unsigned long num_cells, unsigned long steps, const std::vector<double> &quantiles,
+                       unsigned long num_bands);
+
+    /**
+     * @brief Adds the results of one replicate. Safe to call from several threads at once.
+     * @details The replicate is only added to the summaries once every replicate with a lower index has been added.
+     * @param replicate the index of the replicate, each from 0 added exactly once
+     * @param rabbits the final number of rabbits in each cell
+     * @param foxes the final number of foxes in each cell
+     * @param rabbit_totals the total number of rabbits after each step
+     * @param fox_totals the total number of foxes after each step
+     * @param first_band the band to update first, to spread threads across the bands
+     */
+    void addReplicate(unsigned long replicate, const std::vector<unsigned long> &rabbits, const std::vector<unsigned long> &foxes,
+                      const std::vector<unsigned long> &rabbit_totals, const std::vector<unsigned long> &fox_totals,
+                      unsigned long first_band);
+
+    /**
+     * @brief Records that a replicate failed, so that the replicates after it are added without it. Safe to call from
+     * several threads at once.
+     * @param replicate the index of the replicate, which must not also be added
+     * @param first_band the band to update first, to spread threads across the bands
+     */
+    void skipReplicate(unsigned long replicate, unsigned long first_band);
+
+    /**
+     * @brief Gets the number of replicates waiting in the reorder buffer for an earlier replicate.
+     * @return the number of replicates waiting
+     */
+    unsigned long getNumPending();
+
+    /**
+     * @brief Gets the number of separately-locked bands.
+     * @return the number of bands
+     */
+    unsigned long getNumBands() const;
+
+    const SummaryStatistics &getCellRabbits() const;
+
+    const SummaryStatistics &getCellFoxes() const;
+
+    const SummaryStatistics &getStepRabbits() const;
+
+    const SummaryStatistics &getStepFoxes() const;
+};
+
+#endif //LIB_ENSEMBLESTATISTICS_H
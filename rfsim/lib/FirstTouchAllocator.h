@@ -0,0 +1,139 @@
+/**
+ * @brief Contains an allocator which leaves elements to be constructed by the thread which will use them.
+ */
+
+#ifndef LIB_FIRSTTOUCHALLOCATOR_H
+#define LIB_FIRSTTOUCHALLOCATOR_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+/**
+ * @brief Gets the number of FirstTouchAllocator::Deferral scopes open on the calling thread.
+ */
+inline unsigned long &firstTouchDeferrals()
+{
+    thread_local unsigned long depth = 0;
+    return depth;
+}
+
+/**
+ * @brief An allocator which takes fresh pages from the operating system, so that their elements can be constructed by
+ * the threads which will use them.
+ *
+ * @details The operating system places each page on the NUMA node of the thread which first writes to it. Storage
+ * is mapped directly, so no page has been touched when it is handed out. Elements are constructed and destroyed as
+ * normal, except within a Deferral scope, which Matrix::setSizeConstructedBy() uses to size its storage without
+ * touching it before constructing every element itself.
+ * @tparam T the type of the elements
+ */
+template<class T>
+class FirstTouchAllocator
+{
+public:
+    typedef T value_type;
+
+    /**
+     * @brief While an instance exists, default construction and destruction of elements by any FirstTouchAllocator on
+     * the calling thread are skipped.
+     * @details Only for containers which construct every element themselves straight afterwards, or which are
+     * releasing storage whose elements may not all have been constructed.
+     */
+    class Deferral
+    {
+    public:
+        Deferral()
+        {
+            firstTouchDeferrals()++;
+        }
+
+        ~Deferral()
+        {
+            firstTouchDeferrals()--;
+        }
+
+        Deferral(const Deferral &) = delete;
+
+        Deferral &operator=(const Deferral &) = delete;
+    };
+
+    FirstTouchAllocator() = default;
+
+    template<class U>
+    FirstTouchAllocator(const FirstTouchAllocator<U> &)
+    {
+    }
+
+    T* allocate(std::size_t n)
+    {
+#ifdef _WIN32
+        // Without mmap(), the pages still come untouched from the heap for large allocations.
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+#else
+        void* ptr = mmap(nullptr, n * sizeof(T), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(ptr == MAP_FAILED)
+        {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(ptr);
+#endif
+    }
+
+    void deallocate(T* ptr, std::size_t n)
+    {
+#ifdef _WIN32
+        ::operator delete(ptr);
+#else
+        munmap(ptr, n * sizeof(T));
+#endif
+    }
+
+    /**
+     * @brief Default-constructs an element, unless within a Deferral scope.
+     */
+    template<class U>
+    void construct(U* ptr)
+    {
+        if(firstTouchDeferrals() == 0)
+        {
+            new(ptr) U();
+        }
+    }
+
+    template<class U, class... Args>
+    void construct(U* ptr, Args &&... args)
+    {
+        new(ptr) U(std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief Destroys an element, unless within a Deferral scope.
+     */
+    template<class U>
+    void destroy(U* ptr)
+    {
+        if(firstTouchDeferrals() == 0)
+        {
+            ptr->~U();
+        }
+    }
+
+    template<class U>
+    bool operator==(const FirstTouchAllocator<U> &) const
+    {
+        return true;
+    }
+
+    template<class U>
+    bool operator!=(const FirstTouchAllocator<U> &) const
+    {
+        return false;
+    }
+};
+
+#endif //LIB_FIRSTTOUCHALLOCATOR_H
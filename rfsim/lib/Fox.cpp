@@ -4,19 +4,31 @@
 
 #include "Fox.h"
 
-void Fox::catchRabbit(vector<Rabbit> &rabbits, shared_ptr<RNGController> random)
+void Fox::catchRabbit(RabbitPopulation &rabbits, unsigned long &num_alive, shared_ptr<RNGController> random)
 {
-    if(!rabbits.empty())
+    if(num_alive > 0)
     {
-        unsigned long index = random->i0(rabbits.size() - 1);
+        unsigned long index = random->i0(num_alive - 1);
         energy += rabbits[index].getEnergy()*0.5;
-        rabbits[index].kill();
+        num_alive--;
+        std::swap(rabbits[index], rabbits[num_alive]);
     }
 }
 
-bool Fox::canReproduce()
+void Fox::huntPopulation(FoxPopulation &foxes, RabbitPopulation &rabbits, shared_ptr<RNGController> random)
 {
-    if(energy > 50)
+    unsigned long num_alive = rabbits.size();
+    for(auto &fox: foxes)
+    {
+        fox.catchRabbit(rabbits, num_alive, random);
+        fox.exist();
+    }
+    rabbits.erase(rabbits.begin() + num_alive, rabbits.end());
+}
+
+bool Fox::canReproduce(const ModelParameters &parameters)
+{
+    if(energy > parameters.fox_reproduction_threshold)
     {
         energy -= 50;
         return true;
@@ -30,6 +42,27 @@ void Fox::exist()
     age += 1;
 }
 
+unsigned long Fox::reproducePopulation(Fox* foxes, unsigned long num_foxes, const ModelParameters &parameters)
+{
+    unsigned long total = 0;
+    for(unsigned long i = 0; i < num_foxes; i++)
+    {
+        Fox &fox = foxes[i];
+        if(!isExact(fox.energy) || !isExact(parameters.fox_reproduction_threshold))
+        {
+            while(fox.canReproduce(parameters))
+            {
+                total++;
+            }
+            continue;
+        }
+        unsigned long offspring = countSubtractions(fox.energy, parameters.fox_reproduction_threshold, 50.0);
+        fox.energy -= 50.0 * offspring;
+        total += offspring;
+    }
+    return total;
+}
+
 bool Fox::oldAge()
 {
     return age > 30;
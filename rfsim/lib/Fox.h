@@ -8,6 +8,19 @@
 #include "Animal.h"
 #include "Rabbit.h"
 
+class Fox;
+
+/**
+ * @brief The maximum number of foxes which can survive within a single cell.
+ */
+const unsigned long max_foxes_per_cell = 10;
+
+/**
+ * @brief The foxes within a single cell. Cells start with a single fox, and sparse cells rarely hold more than two, so
+ * those are stored inline; busier cells spill to the heap.
+ */
+typedef SmallVector<Fox, 2> FoxPopulation;
+
 /**
  * Contains the behaviours of a Fox
  */
@@ -23,23 +36,48 @@ public:
     { }
 
     /**
-     * @brief Catches a rabbit from the list of rabbits
-     * @param rabbits the rabbits list to pick from
+     * @brief Catches a rabbit uniformly from the live rabbits.
+     * @details The live rabbits are kept at the front of the population. The caught rabbit is swapped to the end of the
+     * live range, so that repeated calls sample the rabbits without replacement and the caught rabbits can be removed
+     * by truncating the population.
+     * @param rabbits the rabbits to pick from
+     * @param num_alive the number of live rabbits at the front of the population, decremented if a rabbit is caught
      * @param random the random number generator
      */
-    void catchRabbit(vector<Rabbit> &rabbits, shared_ptr<RNGController> random);
+    void catchRabbit(RabbitPopulation &rabbits, unsigned long &num_alive, shared_ptr<RNGController> random);
+
+    /**
+     * @brief Each fox in turn catches a different rabbit and then pays the cost of existence, as a single draw without
+     * replacement from the live rabbits.
+     * @param foxes the foxes which are hunting
+     * @param rabbits the rabbits to pick from; caught rabbits are removed
+     * @param random the random number generator
+     */
+    static void huntPopulation(FoxPopulation &foxes, RabbitPopulation &rabbits, shared_ptr<RNGController> random);
 
     /**
      * @brief Checks if this fox can reproduce
+     * @param parameters the model parameters, giving the energy needed to reproduce
      * @return true if the fox has enough energy to reproduce
      */
-    bool canReproduce();
+    bool canReproduce(const ModelParameters &parameters);
 
     /**
      * @brief The painful process of existence costs energy.
      */
     void exist();
 
+    /**
+     * @brief Deducts the reproduction cost from each fox for every offspring it can produce.
+     * @details Gives bitwise-identical results to calling canReproduce() on each fox until it returns false, but
+     * computes the number of offspring per fox in closed form.
+     * @param foxes pointer to the first fox
+     * @param num_foxes the number of foxes
+     * @param parameters the model parameters, giving the energy needed to reproduce
+     * @return the total number of offspring produced
+     */
+    static unsigned long reproducePopulation(Fox* foxes, unsigned long num_foxes, const ModelParameters &parameters);
+
     /**
      * @brief Check if the fox is getting old
      * @return true if the fox dies of old age
@@ -0,0 +1,284 @@
+/**
+ * @brief Contains the writer of compressed, seekable histories of the landscape's counts over long runs.
+ */
+
+#include <cstring>
+#include <stdexcept>
+#include "HistoryWriter.h"
+
+namespace
+{
+    const uint32_t version = 1;
+
+    /**
+     * @brief Appends an unsigned integer as a LEB128 varint, seven bits per byte with the high bit marking that more
+     * bytes follow.
+     */
+    inline void appendVarint(std::vector<uint8_t> &bytes, uint64_t value)
+    {
+        while(value >= 0x80)
+        {
+            bytes.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        bytes.push_back(static_cast<uint8_t>(value));
+    }
+
+    /**
+     * @brief Appends an integer in little-endian order.
+     */
+    template<class T>
+    void appendInteger(std::vector<uint8_t> &bytes, T value)
+    {
+        uint8_t data[sizeof(T)];
+        memcpy(data, &value, sizeof(T));
+        bytes.insert(bytes.end(), data, data + sizeof(T));
+    }
+
+    /**
+     * @brief Splits the values into alternating runs of zeros and of non-zero literals.
+     * @param n the number of values
+     * @param value called as value(i) to get the i-th value
+     * @param run_lengths set to the number of zeros and then of literals in each run
+     * @param literals set to the varints of every literal, in order
+     */
+    template<class Value>
+    void encodeRuns(unsigned long n, Value value, std::vector<uint64_t> &run_lengths, std::vector<uint8_t> &literals)
+    {
+        run_lengths.clear();
+        literals.clear();
+        unsigned long i = 0;
+        while(i < n)
+        {
+            const unsigned long zeros_start = i;
+            while(i < n && value(i) == 0)
+            {
+                i++;
+            }
+            const unsigned long literals_start = i;
+            uint64_t current;
+            while(i < n && (current = value(i)) != 0)
+            {
+                appendVarint(literals, current);
+                i++;
+            }
+            run_lengths.push_back(literals_start - zeros_start);
+            run_lengths.push_back(i - literals_start);
+        }
+    }
+}
+
+HistoryWriter::HistoryWriter(const std::string &file_path, unsigned long num_rows, unsigned long num_cols,
+                             unsigned long interval, unsigned long queue_depth)
+        : path(file_path), file(), rows(num_rows), cols(num_cols), keyframe_interval(interval), buffers(), pending(),
+          available(), filling(0), stopping(false), error(), mutex(), condition(), encoder(), previous(), chunk(),
+          frame_sizes(), chunk_offsets(), run_lengths(), literals(), frames_written(0), file_offset(0)
+{
+    if(keyframe_interval == 0 || keyframe_interval > UINT32_MAX)
+    {
+        throw std::invalid_argument("The keyframe interval must be between 1 and 2^32 - 1.");
+    }
+    if(queue_depth == 0)
+    {
+        throw std::invalid_argument("The history queue must hold at least one frame.");
+    }
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if(!file)
+    {
+        throw std::runtime_error("Could not create history file: " + path);
+    }
+    std::vector<uint8_t> header;
+    header.insert(header.end(), "RFSIMHIS", "RFSIMHIS" + 8);
+    appendInteger<uint32_t>(header, version);
+    appendInteger<uint32_t>(header, static_cast<uint32_t>(keyframe_interval));
+    appendInteger<uint64_t>(header, rows);
+    appendInteger<uint64_t>(header, cols);
+    write(header.data(), header.size());
+    buffers.assign(queue_depth, std::vector<int32_t>(2 * rows * cols));
+    for(unsigned long index = 0; index < queue_depth; index++)
+    {
+        available.push_back(index);
+    }
+    encoder = std::thread(&HistoryWriter::encode, this);
+}
+
+HistoryWriter::~HistoryWriter()
+{
+    try
+    {
+        close();
+    }
+    catch(std::exception &)
+    {
+    }
+}
+
+void HistoryWriter::write(const void* data, unsigned long size)
+{
+    file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    if(!file)
+    {
+        throw std::runtime_error("Could not write history file: " + path);
+    }
+    file_offset += size;
+}
+
+void HistoryWriter::encode()
+{
+    try
+    {
+        while(true)
+        {
+            unsigned long index;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [this]{return stopping || !pending.empty();});
+                if(pending.empty())
+                {
+                    break;
+                }
+                index = pending.front();
+                pending.pop_front();
+            }
+            encodeFrame(buffers[index]);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                available.push_back(index);
+            }
+            condition.notify_all();
+        }
+        writeChunk();
+        std::vector<uint8_t> index;
+        for(uint64_t offset : chunk_offsets)
+        {
+            appendInteger<uint64_t>(index, offset);
+        }
+        appendInteger<uint64_t>(index, file_offset);
+        appendInteger<uint64_t>(index, chunk_offsets.size());
+        appendInteger<uint64_t>(index, frames_written);
+        index.insert(index.end(), "RFSIMEND", "RFSIMEND" + 8);
+        write(index.data(), index.size());
+        file.flush();
+        if(!file)
+        {
+            throw std::runtime_error("Could not write history file: " + path);
+        }
+    }
+    catch(...)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        error = std::current_exception();
+        // Frames queued after the failure are dropped, so that beginFrame() wakes to report it.
+        available.insert(available.end(), pending.begin(), pending.end());
+        pending.clear();
+    }
+    condition.notify_all();
+}
+
+void HistoryWriter::encodeFrame(const std::vector<int32_t> &values)
+{
+    if(frame_sizes.size() == keyframe_interval)
+    {
+        writeChunk();
+    }
+    const unsigned long n = values.size();
+    const bool keyframe = frame_sizes.empty();
+    if(keyframe)
+    {
+        // Counts are never negative, so are stored as they are.
+        encodeRuns(n, [&values](unsigned long i)
+        {
+            return static_cast<uint64_t>(static_cast<uint32_t>(values[i]));
+        }, run_lengths, literals);
+    }
+    else
+    {
+        // Changes are zigzag-encoded, so that small changes either way take few bits.
+        const int32_t* before = previous.data();
+        encodeRuns(n, [&values, before](unsigned long i)
+        {
+            const int64_t change = static_cast<int64_t>(values[i]) - before[i];
+            return (static_cast<uint64_t>(change) << 1) ^ static_cast<uint64_t>(change >> 63);
+        }, run_lengths, literals);
+    }
+    const unsigned long start = chunk.size();
+    chunk.push_back(keyframe ? 0 : 1);
+    appendVarint(chunk, run_lengths.size() / 2);
+    for(uint64_t length : run_lengths)
+    {
+        appendVarint(chunk, length);
+    }
+    chunk.insert(chunk.end(), literals.begin(), literals.end());
+    frame_sizes.push_back(chunk.size() - start);
+    previous = values;
+}
+
+void HistoryWriter::writeChunk()
+{
+    if(frame_sizes.empty())
+    {
+        return;
+    }
+    std::vector<uint8_t> header;
+    appendInteger<uint64_t>(header, frames_written);
+    appendInteger<uint32_t>(header, static_cast<uint32_t>(frame_sizes.size()));
+    appendInteger<uint32_t>(header, 0);
+    for(uint64_t size : frame_sizes)
+    {
+        appendInteger<uint64_t>(header, size);
+    }
+    chunk_offsets.push_back(file_offset);
+    write(header.data(), header.size());
+    write(chunk.data(), chunk.size());
+    // Complete chunks reach the file straight away, so that they can be read before the history is closed.
+    file.flush();
+    frames_written += frame_sizes.size();
+    frame_sizes.clear();
+    chunk.clear();
+}
+
+void HistoryWriter::beginFrame(int32_t* &rabbits, int32_t* &foxes)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if(stopping)
+    {
+        throw std::runtime_error("The history file has been closed: " + path);
+    }
+    condition.wait(lock, [this]{return error != nullptr || !available.empty();});
+    if(error != nullptr)
+    {
+        std::rethrow_exception(error);
+    }
+    filling = available.front();
+    available.pop_front();
+    rabbits = buffers[filling].data();
+    foxes = rabbits + rows * cols;
+}
+
+void HistoryWriter::commitFrame()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back(filling);
+    }
+    condition.notify_all();
+}
+
+void HistoryWriter::close()
+{
+    if(!encoder.joinable())
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    encoder.join();
+    file.close();
+    if(error != nullptr)
+    {
+        std::rethrow_exception(error);
+    }
+}
@@ -0,0 +1,143 @@
+/**
+ * @brief Contains the writer of compressed, seekable histories of the landscape's counts over long runs.
+ */
+
+#ifndef LIB_HISTORYWRITER_H
+#define LIB_HISTORYWRITER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Writes the rabbit and fox counts of every step to a compressed history file, encoding on a background thread.
+ *
+ * @details Steps are stored as frames, grouped into chunks of keyframe_interval frames. The first frame of each chunk
+ * is a keyframe holding the counts themselves, and the rest hold the change in each count from the frame before, so
+ * any frame can be decoded by reading only its own chunk. The values of a frame (the rabbits then the foxes, each in
+ * row-major order) are stored as runs of zeros and non-zero literals, with every number a LEB128 varint and the
+ * changes zigzag-encoded, so the many cells which do not change between steps cost a few bits each.
+ *
+ * All integers outside the frames are little-endian. The file holds:
+ *   - a 32-byte header: the magic "RFSIMHIS", a uint32 version (1), the uint32 keyframe interval and the uint64 rows
+ *     and columns
+ *   - the chunks, each a uint64 index of its first frame, a uint32 number of frames, four zero bytes, a uint64 size for
+ *     each frame and then the frames
+ *   - once closed, an index of the uint64 offset of each chunk, followed by a 32-byte trailer of the uint64 offset of
+ *     the index, the uint64 numbers of chunks and frames, and the magic "RFSIMEND"
+ *
+ * A frame is a type byte (0 for a keyframe, 1 for a delta) followed by varints: the number of runs, the number of
+ * zeros and of literals in each run, and then every literal. Chunks are written as they fill, so a file which was not
+ * closed can still be read by walking the chunk headers.
+ */
+class HistoryWriter
+{
+protected:
+    std::string path;
+    std::ofstream file;
+    unsigned long rows;
+    unsigned long cols;
+    unsigned long keyframe_interval;
+    // Frames waiting to be encoded, and the buffers free to be filled
+    std::vector<std::vector<int32_t>> buffers;
+    std::deque<unsigned long> pending;
+    std::deque<unsigned long> available;
+    // The buffer being filled between beginFrame() and commitFrame()
+    unsigned long filling;
+    bool stopping;
+    std::exception_ptr error;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::thread encoder;
+    // The state of the encoder thread
+    std::vector<int32_t> previous;
+    std::vector<uint8_t> chunk;
+    std::vector<uint64_t> frame_sizes;
+    std::vector<uint64_t> chunk_offsets;
+    // Scratch space for the frame being encoded
+    std::vector<uint64_t> run_lengths;
+    std::vector<uint8_t> literals;
+    unsigned long frames_written;
+    uint64_t file_offset;
+
+    /**
+     * @brief Encodes each frame as it is committed, on the background thread, then writes the index.
+     */
+    void encode();
+
+    /**
+     * @brief Appends one frame to the current chunk, writing the chunk first if it is full.
+     * @param values the counts of the frame
+     */
+    void encodeFrame(const std::vector<int32_t> &values);
+
+    /**
+     * @brief Writes the current chunk to the file, if it holds any frames.
+     */
+    void writeChunk();
+
+    /**
+     * @brief Writes bytes to the file.
+     * @throws std::runtime_error if the file cannot be written
+     */
+    void write(const void* data, unsigned long size);
+
+public:
+    /**
+     * @brief Creates the file, replacing any existing file, and starts the encoder thread.
+     * @param file_path the path of the history file
+     * @param num_rows the number of rows in each grid
+     * @param num_cols the number of columns in each grid
+     * @param interval the number of frames in each chunk, starting with a keyframe
+     * @param queue_depth the number of frames which can wait to be encoded before beginFrame() blocks
+     * @throws std::invalid_argument if the interval or queue depth is zero
+     * @throws std::runtime_error if the file cannot be created
+     */
+    HistoryWriter(const std::string &file_path, unsigned long num_rows, unsigned long num_cols,
+                  unsigned long interval, unsigned long queue_depth = 4);
+
+    HistoryWriter(const HistoryWriter&) = delete;
+
+    HistoryWriter &operator=(const HistoryWriter&) = delete;
+
+    /**
+     * @brief Closes the file, if it has not already been closed.
+     */
+    ~HistoryWriter();
+
+    /**
+     * @brief Gets the storage for the next frame, to be filled before commitFrame(), waiting if the encoder has fallen
+     * behind.
+     * @param rabbits set to the rows * cols rabbit counts of the frame, in row-major order
+     * @param foxes set to the rows * cols fox counts of the frame, in row-major order
+     * @throws std::runtime_error if the file has been closed, or rethrows the error which stopped the encoder
+     */
+    void beginFrame(int32_t* &rabbits, int32_t* &foxes);
+
+    /**
+     * @brief Queues the frame filled since beginFrame() to be encoded.
+     */
+    void commitFrame();
+
+    /**
+     * @brief Waits for every queued frame to be encoded, writes the index and closes the file.
+     * @throws std::runtime_error if the file could not be written
+     */
+    void close();
+
+    /**
+     * @brief Gets the path of the file.
+     */
+    const std::string &getPath() const
+    {
+        return path;
+    }
+};
+
+#endif //LIB_HISTORYWRITER_H
@@ -2,62 +2,1116 @@
  * @brief Contains the main Landscape class which controls the simulation.
  */
 
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <queue>
 #include "Landscape.h"
 
+namespace
+{
+    /**
+     * @brief Adds the animals from every task to the landscape in order of their source cells.
+     * @tparam T the type of animal
+     * @param animals the migrating animals of each task, each already in order of source cell
+     * @param sources the source cell of each animal
+     * @param settle function adding a single animal to the landscape
+     */
+    template<class T, class F>
+    void mergeBySource(const vector<vector<T>*> &animals, const vector<vector<unsigned long>*> &sources,
+                       F settle)
+    {
+        // Min-heap of the next source cell of each task
+        typedef pair<unsigned long, unsigned long> Entry;
+        priority_queue<Entry, vector<Entry>, greater<Entry>> heap;
+        vector<unsigned long> positions(animals.size(), 0);
+        for(unsigned long task = 0; task < animals.size(); task++)
+        {
+            if(!sources[task]->empty())
+            {
+                heap.emplace((*sources[task])[0], task);
+            }
+        }
+        while(!heap.empty())
+        {
+            unsigned long source = heap.top().first;
+            unsigned long task = heap.top().second;
+            heap.pop();
+            // Each source cell belongs to exactly one task, so all of its migrants are settled together.
+            unsigned long &position = positions[task];
+            const vector<unsigned long> &task_sources = *sources[task];
+            while(position < task_sources.size() && task_sources[position] == source)
+            {
+                settle((*animals[task])[position]);
+                position++;
+            }
+            if(position < task_sources.size())
+            {
+                heap.emplace(task_sources[position], task);
+            }
+        }
+    }
+}
+
+Landscape::~Landscape()
+{
+    // Skip returning each cell's storage to the arena, as all the arena's blocks are about to be freed together.
+    arena->beginRelease();
+    for(auto &tile_arena : tile_arenas)
+    {
+        tile_arena->beginRelease();
+    }
+}
+
 void Landscape::setSeed(unsigned long i)
 {
     random->setSeed(i);
+    seed = i;
 }
 
 void Landscape::iterate()
 {
-    vector<Rabbit> moved_rabbits;
-    vector<Fox> moved_foxes;
+    auto start = std::chrono::steady_clock::now();
+    change_epoch++;
+    if(scheduler == nullptr)
+    {
+        iterateSerial();
+    }
+    else
+    {
+        iterateScheduled();
+    }
+    profile.iteration_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    history.push_back(totals);
+    iteration++;
+    if(compaction_interval > 0 && iteration % compaction_interval == 0)
+    {
+        compactPopulations();
+    }
+    summed_area_tables_current = false;
+    pyramid_current = false;
+    if(time_series != nullptr)
+    {
+        recordTimeSeries();
+    }
+    if(history_file != nullptr)
+    {
+        recordHistoryFile();
+    }
+    if(eager_summed_area_tables)
+    {
+        buildSummedAreaTables();
+    }
+}
+
+void Landscape::updateCell(Cell &cell, shared_ptr<RNGController> cell_random, Migrants &migrants,
+                           PopulationTotals &counted, unsigned long position)
+{
+    const unsigned long first_rabbit = migrants.rabbits.size();
+    const unsigned long first_fox = migrants.foxes.size();
+    const unsigned long old_rabbits = cell.getNumRabbits();
+    const unsigned long old_foxes = cell.getNumFoxes();
+    const double old_grass = cell.getGrass();
+    cell.growGrass(cell_random, parameters);
+    cell.iterate(cell_random, parameters, counted);
+    cell.moveRabbits(cell_random, parameters, landscape.getCols(), landscape.getRows(), migrants.rabbits);
+    cell.moveFoxes(cell_random, parameters, landscape.getCols(), landscape.getRows(), migrants.foxes);
+    // Migrants are counted here, rather than when settled, so the totals are the same however they are settled.
+    counted.rabbits += cell.getNumRabbits();
+    counted.foxes += cell.getNumFoxes();
+    counted.grass += cell.getGrass();
+    if(cell.getNumRabbits() != old_rabbits || cell.getNumFoxes() != old_foxes)
+    {
+        change_epochs[position] = change_epoch;
+    }
+    if(cell.getGrass() != old_grass)
+    {
+        grass_epochs[position] = change_epoch;
+    }
+    unsigned long survivors = 0;
+    for(unsigned long k = first_rabbit; k < migrants.rabbits.size(); k++)
+    {
+        survivors += migrants.rabbits[k].survives();
+    }
+    counted.rabbits += survivors;
+    counted.migrations += survivors;
+    counted.deaths += migrants.rabbits.size() - first_rabbit - survivors;
+    survivors = 0;
+    for(unsigned long k = first_fox; k < migrants.foxes.size(); k++)
+    {
+        survivors += migrants.foxes[k].survives();
+    }
+    counted.foxes += survivors;
+    counted.migrations += survivors;
+    counted.deaths += migrants.foxes.size() - first_fox - survivors;
+}
+
+void Landscape::settleMigrants(Migrants &migrants)
+{
+    for(auto &rabbit: migrants.rabbits)
+    {
+        if(rabbit.survives())
+        {
+            Coordinates new_location = rabbit.getLocation();
+            landscape.get(new_location.y, new_location.x).addRabbit(rabbit);
+            change_epochs[landscape.index(new_location.y, new_location.x)] = change_epoch;
+        }
+    }
+    for(auto &fox: migrants.foxes)
+    {
+        if(fox.survives())
+        {
+            Coordinates new_location = fox.getLocation();
+            landscape.get(new_location.y, new_location.x).addFox(fox);
+            change_epochs[landscape.index(new_location.y, new_location.x)] = change_epoch;
+        }
+    }
+}
+
+void Landscape::iterateSerial()
+{
+    Migrants migrants;
+    totals = PopulationTotals();
     for(unsigned long i = 0; i < landscape.getRows(); i++)
     {
         for(unsigned long j = 0; j < landscape.getCols(); j++)
         {
-            Cell &cell = landscape.get(i, j);
-            cell.growGrass(random);
-            cell.iterate(random);
-            auto tmp_rabbits = cell.moveRabbits(random, landscape.getCols(), landscape.getRows());
-            auto tmp_foxes = cell.moveFoxes(random, landscape.getCols(), landscape.getRows());
-            //                moved_rabbits.reserve(moved_rabbits.size() + distance(tmp_rabbits.begin(), tmp_rabbits.end()));
-            //                moved_foxes.reserve(moved_foxes.size() + distance(tmp_foxes.begin(), tmp_foxes.end()));
-            moved_rabbits.insert(moved_rabbits.end(), tmp_rabbits.begin(), tmp_rabbits.end());
-            moved_foxes.insert(moved_foxes.end(), tmp_foxes.begin(), tmp_foxes.end());
+            updateCell(landscape.get(i, j), random, migrants, totals, landscape.index(i, j));
         }
     }
     // Now move all the moved rabbits and foxes
-    for(auto &rabbit: moved_rabbits)
+    settleMigrants(migrants);
+}
+
+template<class F>
+void Landscape::forEachCellInTask(unsigned long task, F function)
+{
+    if(rebalance_interval > 0)
+    {
+        const Block &block = blocks[task];
+        landscape.forEachInRegion(block.row_start, block.row_end, block.col_start, block.col_end, function);
+    }
+    else
     {
+        for(unsigned long position = task_starts[task]; position < task_starts[task + 1]; position++)
+        {
+            unsigned long i;
+            unsigned long j;
+            landscape.coordinates(position, i, j);
+            function(position, i, j);
+        }
+    }
+}
+
+unsigned long Landscape::prepareTasks()
+{
+    unsigned long num_tasks;
+    if(rebalance_interval > 0)
+    {
+        if(blocks.empty() || iteration - last_rebalance >= rebalance_interval)
+        {
+            rebalance();
+        }
+        num_tasks = blocks.size();
+    }
+    else
+    {
+        buildTasks();
+        num_tasks = task_starts.size() - 1;
+    }
+    if(task_migrants.size() < num_tasks)
+    {
+        task_migrants.resize(num_tasks);
+    }
+    task_times.resize(num_tasks);
+    task_totals.assign(num_tasks, PopulationTotals());
+    return num_tasks;
+}
+
+void Landscape::iterateScheduled()
+{
+    unsigned long num_tasks = prepareTasks();
+    const unsigned long num_cells = landscape.getRows() * landscape.getCols();
+    // Each band of rows in the next generation is settled by a single thread.
+    const unsigned long num_bands = min(scheduler->getNumThreads(), max(landscape.getRows(), 1ul));
+    if(double_buffered)
+    {
+        prepareNextGeneration();
+        if(band_migrants.size() < num_tasks * num_bands)
+        {
+            band_migrants.resize(num_tasks * num_bands);
+        }
+    }
+    scheduler->run(num_tasks, [this, num_cells, num_bands](unsigned long task, unsigned long worker)
+    {
+        auto start = std::chrono::steady_clock::now();
+        shared_ptr<RNGController> &cell_random = worker_randoms[worker];
+        Migrants &migrants = task_migrants[task];
+        migrants.clear();
+        if(rebalance_interval > 0)
+        {
+            task_overflow[task].clear();
+        }
+        forEachCellInTask(task, [&](unsigned long position, unsigned long i, unsigned long j)
+        {
+            // Streams are numbered by row-major index, so they do not depend on how the cells are stored.
+            cell_random->setStream(seed, iteration * num_cells + i * landscape.getCols() + j);
+            Cell* cell = &landscape.get(i, j);
+            if(double_buffered)
+            {
+                // The current generation is only read from: the cell is copied to the next generation, and updated
+                // there.
+                Cell &next_cell = next_landscape.get(i, j);
+                next_cell.advanceFrom(*cell);
+                cell = &next_cell;
+            }
+            unsigned long first_rabbit = migrants.rabbits.size();
+            unsigned long first_fox = migrants.foxes.size();
+            updateCell(*cell, cell_random, migrants, task_totals[task], position);
+            if(rebalance_interval > 0)
+            {
+                routeMigrants(task, position, first_rabbit, first_fox);
+            }
+            migrants.rabbit_sources.resize(migrants.rabbits.size(), position);
+            migrants.fox_sources.resize(migrants.foxes.size(), position);
+        });
+        if(double_buffered && rebalance_interval == 0)
+        {
+            splitMigrantsByBand(task, num_bands);
+        }
+        task_times[task] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }, rebalance_interval == 0);
+    recordTaskTimes(num_tasks);
+    totals = PopulationTotals();
+    for(unsigned long task = 0; task < num_tasks; task++)
+    {
+        totals += task_totals[task];
+    }
+    if(rebalance_interval > 0)
+    {
+        // Each tile's owner settles the animals moving within the tile together with those which crossed into it,
+        // so every cell is only written by the thread owning it.
+        CellMatrix &target = double_buffered ? next_landscape : landscape;
+        scheduler->run(num_tasks, [this, &target](unsigned long task, unsigned long)
+        {
+            settleMigrantsInOrder({&task_migrants[task], &gatherArrivals(task)}, target);
+        }, false);
+        if(double_buffered)
+        {
+            landscape.swap(next_landscape);
+        }
+    }
+    else if(double_buffered)
+    {
+        scheduler->run(num_bands, [this, num_tasks, num_bands](unsigned long band, unsigned long)
+        {
+            vector<Migrants*> migrants;
+            for(unsigned long task = 0; task < num_tasks; task++)
+            {
+                migrants.push_back(&band_migrants[task * num_bands + band]);
+            }
+            settleMigrantsInOrder(migrants, next_landscape);
+        });
+        landscape.swap(next_landscape);
+    }
+    else
+    {
+        // Tasks cover contiguous ranges of cells in order, so settling each task's migrants in turn adds them to their
+        // new cells in the same order regardless of which thread ran which task.
+        for(unsigned long task = 0; task < num_tasks; task++)
+        {
+            settleMigrants(task_migrants[task]);
+        }
+    }
+}
+
+void Landscape::routeMigrants(unsigned long task, unsigned long position, unsigned long first_rabbit,
+                              unsigned long first_fox)
+{
+    Migrants &migrants = task_migrants[task];
+    unsigned long kept = first_rabbit;
+    for(unsigned long k = first_rabbit; k < migrants.rabbits.size(); k++)
+    {
+        Rabbit &rabbit = migrants.rabbits[k];
+        if(!rabbit.survives())
+        {
+            continue;
+        }
+        Coordinates new_location = rabbit.getLocation();
+        unsigned long owner = tile_owners.get(new_location.y, new_location.x);
+        if(owner == task)
+        {
+            migrants.rabbits[kept++] = rabbit;
+            continue;
+        }
+        if(!tile_queues[owner]->rabbits.push(Arrival<Rabbit>{rabbit, position}))
+        {
+            task_overflow[task].rabbits.push_back(rabbit);
+            task_overflow[task].rabbit_sources.push_back(position);
+        }
+    }
+    migrants.rabbits.erase(migrants.rabbits.begin() + kept, migrants.rabbits.end());
+    kept = first_fox;
+    for(unsigned long k = first_fox; k < migrants.foxes.size(); k++)
+    {
+        Fox &fox = migrants.foxes[k];
+        if(!fox.survives())
+        {
+            continue;
+        }
+        Coordinates new_location = fox.getLocation();
+        unsigned long owner = tile_owners.get(new_location.y, new_location.x);
+        if(owner == task)
+        {
+            migrants.foxes[kept++] = fox;
+            continue;
+        }
+        if(!tile_queues[owner]->foxes.push(Arrival<Fox>{fox, position}))
+        {
+            task_overflow[task].foxes.push_back(fox);
+            task_overflow[task].fox_sources.push_back(position);
+        }
+    }
+    migrants.foxes.erase(migrants.foxes.begin() + kept, migrants.foxes.end());
+}
+
+Migrants &Landscape::gatherArrivals(unsigned long task)
+{
+    TileQueues &queues = *tile_queues[task];
+    vector<Arrival<Rabbit>> rabbits;
+    vector<Arrival<Fox>> foxes;
+    Arrival<Rabbit> rabbit;
+    while(queues.rabbits.pop(rabbit))
+    {
+        rabbits.push_back(rabbit);
+    }
+    Arrival<Fox> fox;
+    while(queues.foxes.pop(fox))
+    {
+        foxes.push_back(fox);
+    }
+    // Animals which did not fit in the queues are collected from every tile's overflow. A cell's migrants only spill
+    // over once the queue has filled, so they still follow any of the same cell's migrants in the queue.
+    bool rabbits_overflowed = false;
+    bool foxes_overflowed = false;
+    for(unsigned long other = 0; other < blocks.size(); other++)
+    {
+        Migrants &overflow = task_overflow[other];
+        for(unsigned long k = 0; k < overflow.rabbits.size(); k++)
+        {
+            Coordinates location = overflow.rabbits[k].getLocation();
+            if(tile_owners.get(location.y, location.x) == task)
+            {
+                rabbits.push_back(Arrival<Rabbit>{overflow.rabbits[k], overflow.rabbit_sources[k]});
+                rabbits_overflowed = true;
+            }
+        }
+        for(unsigned long k = 0; k < overflow.foxes.size(); k++)
+        {
+            Coordinates location = overflow.foxes[k].getLocation();
+            if(tile_owners.get(location.y, location.x) == task)
+            {
+                foxes.push_back(Arrival<Fox>{overflow.foxes[k], overflow.fox_sources[k]});
+                foxes_overflowed = true;
+            }
+        }
+    }
+    // Grow a queue which overflowed so that the same traffic fits next time. Queues are never shrunk, so that a
+    // quiet step does not undo the growth.
+    if(rabbits_overflowed)
+    {
+        queues.rabbits.reset(max(queues.rabbits.getCapacity(), rabbits.size() * 2));
+    }
+    if(foxes_overflowed)
+    {
+        queues.foxes.reset(max(queues.foxes.getCapacity(), foxes.size() * 2));
+    }
+    // Each producer's own pushes come out of the queue in order, so a stable sort gives the order of the source cells.
+    stable_sort(rabbits.begin(), rabbits.end(), [](const Arrival<Rabbit> &a, const Arrival<Rabbit> &b)
+    { return a.source < b.source; });
+    stable_sort(foxes.begin(), foxes.end(), [](const Arrival<Fox> &a, const Arrival<Fox> &b)
+    { return a.source < b.source; });
+    Migrants &arrivals = tile_arrivals[task];
+    arrivals.clear();
+    for(auto &arrival : rabbits)
+    {
+        arrivals.rabbits.push_back(arrival.animal);
+        arrivals.rabbit_sources.push_back(arrival.source);
+    }
+    for(auto &arrival : foxes)
+    {
+        arrivals.foxes.push_back(arrival.animal);
+        arrivals.fox_sources.push_back(arrival.source);
+    }
+    return arrivals;
+}
+
+void Landscape::splitMigrantsByBand(unsigned long task, unsigned long num_bands)
+{
+    const unsigned long rows = landscape.getRows();
+    for(unsigned long band = 0; band < num_bands; band++)
+    {
+        band_migrants[task * num_bands + band].clear();
+    }
+    Migrants &migrants = task_migrants[task];
+    for(unsigned long k = 0; k < migrants.rabbits.size(); k++)
+    {
+        Rabbit &rabbit = migrants.rabbits[k];
         if(rabbit.survives())
         {
-            Coordinates new_location = rabbit.getLocation();
-            landscape.get(new_location.y, new_location.x).addRabbit(rabbit);
+            Migrants &band = band_migrants[task * num_bands + rabbit.getLocation().y * num_bands / rows];
+            band.rabbits.push_back(rabbit);
+            band.rabbit_sources.push_back(migrants.rabbit_sources[k]);
         }
     }
-    for(auto &fox: moved_foxes)
+    for(unsigned long k = 0; k < migrants.foxes.size(); k++)
+    {
+        Fox &fox = migrants.foxes[k];
+        if(fox.survives())
+        {
+            Migrants &band = band_migrants[task * num_bands + fox.getLocation().y * num_bands / rows];
+            band.foxes.push_back(fox);
+            band.fox_sources.push_back(migrants.fox_sources[k]);
+        }
+    }
+}
+
+void Landscape::prepareNextGeneration()
+{
+    if(next_landscape.getRows() == landscape.getRows() && next_landscape.getCols() == landscape.getCols())
+    {
+        return;
+    }
+    auto construct = [this](unsigned long, unsigned long i, unsigned long j)
+    {
+        Cell* cell = new(&next_landscape.get(i, j)) Cell(0.0, 0, 0, Coordinates(j, i));
+        cell->setArena(getCellArena(i, j));
+    };
+    next_landscape.setSizeConstructedBy(landscape.getRows(), landscape.getCols(), [this, &construct]
+    {
+        if(numa_placement && rebalance_interval > 0 && !blocks.empty())
+        {
+            scheduler->run(blocks.size(), [this, &construct](unsigned long task, unsigned long)
+            {
+                forEachCellInTask(task, construct);
+            }, false);
+            return;
+        }
+        for(unsigned long i = 0; i < landscape.getRows(); i++)
+        {
+            for(unsigned long j = 0; j < landscape.getCols(); j++)
+            {
+                construct(i * landscape.getCols() + j, i, j);
+            }
+        }
+    });
+}
+
+void Landscape::settleMigrantsInOrder(const vector<Migrants*> &migrants, CellMatrix &target)
+{
+    vector<vector<Rabbit>*> rabbits;
+    vector<vector<Fox>*> foxes;
+    vector<vector<unsigned long>*> rabbit_sources;
+    vector<vector<unsigned long>*> fox_sources;
+    for(auto &set : migrants)
+    {
+        rabbits.push_back(&set->rabbits);
+        foxes.push_back(&set->foxes);
+        rabbit_sources.push_back(&set->rabbit_sources);
+        fox_sources.push_back(&set->fox_sources);
+    }
+    mergeBySource(rabbits, rabbit_sources, [this, &target](Rabbit &rabbit)
+    {
+        if(rabbit.survives())
+        {
+            Coordinates new_location = rabbit.getLocation();
+            target.get(new_location.y, new_location.x).addRabbit(rabbit);
+            change_epochs[target.index(new_location.y, new_location.x)] = change_epoch;
+        }
+    });
+    mergeBySource(foxes, fox_sources, [this, &target](Fox &fox)
     {
         if(fox.survives())
         {
             Coordinates new_location = fox.getLocation();
-            landscape.get(new_location.y, new_location.x).addFox(fox);
+            target.get(new_location.y, new_location.x).addFox(fox);
+            change_epochs[target.index(new_location.y, new_location.x)] = change_epoch;
+        }
+    });
+}
+
+void Landscape::rebalance()
+{
+    auto start = std::chrono::steady_clock::now();
+    Matrix<unsigned long> weights(landscape.getRows(), landscape.getCols());
+    for(unsigned long i = 0; i < landscape.getRows(); i++)
+    {
+        for(unsigned long j = 0; j < landscape.getCols(); j++)
+        {
+            Cell &cell = landscape.get(i, j);
+            weights.get(i, j) = 1 + cell.getNumRabbits() + cell.getNumFoxes();
+        }
+    }
+    assignTiles(weights);
+    profile.partition_imbalance = Partitioner::imbalance(blocks);
+    profile.rebalance_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    profile.total_rebalance_time += profile.rebalance_time;
+    profile.rebalances++;
+}
+
+void Landscape::assignTiles(Matrix<unsigned long> &weights)
+{
+    blocks = partitioner.partition(weights, scheduler->getNumThreads());
+    tile_owners.setSize(landscape.getRows(), landscape.getCols());
+    for(unsigned long task = 0; task < blocks.size(); task++)
+    {
+        const Block &block = blocks[task];
+        for(unsigned long i = block.row_start; i < block.row_end; i++)
+        {
+            for(unsigned long j = block.col_start; j < block.col_end; j++)
+            {
+                tile_owners.get(i, j) = task;
+            }
+        }
+    }
+    while(tile_queues.size() < blocks.size())
+    {
+        tile_queues.push_back(make_unique<TileQueues>());
+        tile_queues.back()->rabbits.reset(1024);
+        tile_queues.back()->foxes.reset(1024);
+    }
+    task_overflow.resize(max(task_overflow.size(), blocks.size()));
+    tile_arrivals.resize(max(tile_arrivals.size(), blocks.size()));
+    last_rebalance = iteration;
+}
+
+void Landscape::placeTiles()
+{
+    // Cells start with equal populations, so every cell is given the same weight.
+    Matrix<unsigned long> weights(landscape.getRows(), landscape.getCols());
+    for(unsigned long i = 0; i < landscape.getRows(); i++)
+    {
+        for(unsigned long j = 0; j < landscape.getCols(); j++)
+        {
+            weights.get(i, j) = 1;
+        }
+    }
+    assignTiles(weights);
+    tile_arenas.clear();
+    tile_arenas.resize(blocks.size());
+    scheduler->run(blocks.size(), [this](unsigned long task, unsigned long)
+    {
+        tile_arenas[task] = make_unique<PopulationArena>();
+        PopulationArena* tile_arena = tile_arenas[task].get();
+        forEachCellInTask(task, [this, tile_arena](unsigned long, unsigned long i, unsigned long j)
+        {
+            Cell* cell = new(&landscape.get(i, j)) Cell();
+            cell->setArena(tile_arena);
+        });
+    }, false);
+}
+
+PopulationArena* Landscape::getCellArena(unsigned long i, unsigned long j)
+{
+    if(numa_placement && !tile_arenas.empty() && tile_owners.getRows() == landscape.getRows()
+       && tile_owners.getCols() == landscape.getCols())
+    {
+        unsigned long owner = tile_owners.get(i, j);
+        if(owner < tile_arenas.size())
+        {
+            return tile_arenas[owner].get();
+        }
+    }
+    return arena.get();
+}
+
+void Landscape::recordTaskTimes(unsigned long num_tasks)
+{
+    double total = 0.0;
+    double slowest = 0.0;
+    for(unsigned long task = 0; task < num_tasks; task++)
+    {
+        total += task_times[task];
+        slowest = max(slowest, task_times[task]);
+    }
+    profile.task_imbalance = total > 0.0 ? slowest * num_tasks / total : 1.0;
+}
+
+void Landscape::buildTasks()
+{
+    task_starts.clear();
+    task_starts.push_back(0);
+    unsigned long work = 0;
+    const unsigned long num_cells = landscape.getRows() * landscape.getCols();
+    // Tasks follow the storage order of the cells, so that each task covers a compact patch of the landscape.
+    for(unsigned long position = 0; position < num_cells; position++)
+    {
+        Cell &cell = landscape.getAtPosition(position);
+        work += 1 + cell.getNumRabbits() + cell.getNumFoxes();
+        if(work >= grain_size)
+        {
+            task_starts.push_back(position + 1);
+            work = 0;
         }
     }
+    if(task_starts.back() != num_cells)
+    {
+        task_starts.push_back(num_cells);
+    }
+}
+
+void Landscape::setThreads(unsigned long threads, unsigned long grain)
+{
+    if(threads == 0)
+    {
+        throw invalid_argument("Number of threads must be at least 1.");
+    }
+    scheduler = make_unique<WorkStealingScheduler>(threads);
+    if(numa_placement)
+    {
+        scheduler->pinThreads();
+    }
+    grain_size = max(grain, 1ul);
+    worker_randoms.clear();
+    for(unsigned long i = 0; i < threads; i++)
+    {
+        worker_randoms.push_back(make_shared<RNGController>());
+    }
+}
+
+void Landscape::setPartitioning(unsigned long interval)
+{
+    rebalance_interval = interval;
+    blocks.clear();
+}
+
+void Landscape::setDoubleBuffered(bool enabled)
+{
+    if(enabled && scheduler == nullptr)
+    {
+        setThreads(1, grain_size);
+    }
+    double_buffered = enabled;
+    if(!enabled)
+    {
+        next_landscape.setSize(0, 0);
+    }
+}
+
+void Landscape::setNumaPlacement(bool enabled)
+{
+    if(enabled)
+    {
+        if(scheduler == nullptr)
+        {
+            setThreads(1, grain_size);
+        }
+        if(rebalance_interval == 0)
+        {
+            setPartitioning(numeric_limits<unsigned long>::max());
+        }
+        scheduler->pinThreads();
+    }
+    numa_placement = enabled;
+}
+
+const LandscapeProfile &Landscape::getProfile() const
+{
+    return profile;
+}
+
+const PopulationTotals &Landscape::getTotals() const
+{
+    return totals;
+}
+
+const vector<PopulationTotals> &Landscape::getHistory() const
+{
+    return history;
+}
+
+void Landscape::parallelFor(unsigned long n, const std::function<void(unsigned long)> &function)
+{
+    if(scheduler == nullptr)
+    {
+        for(unsigned long k = 0; k < n; k++)
+        {
+            function(k);
+        }
+        return;
+    }
+    scheduler->run(n, [&function](unsigned long k, unsigned long)
+    {
+        function(k);
+    });
+}
+
+void Landscape::buildSummedAreaTables()
+{
+    const unsigned long num_tasks = scheduler == nullptr ? 1 : 4 * scheduler->getNumThreads();
+    summed_area_tables.build(landscape.getRows(), landscape.getCols(),
+                             [this](unsigned long i, unsigned long j, unsigned long &rabbits, unsigned long &foxes,
+                                    double &grass)
+                             {
+                                 Cell &cell = landscape.get(i, j);
+                                 rabbits = cell.getNumRabbits();
+                                 foxes = cell.getNumFoxes();
+                                 grass = cell.getGrass();
+                             },
+                             [this](unsigned long n, const std::function<void(unsigned long)> &function)
+                             {
+                                 parallelFor(n, function);
+                             }, num_tasks);
+    summed_area_tables_current = true;
+}
+
+void Landscape::setSummedAreaTables(bool enabled)
+{
+    eager_summed_area_tables = enabled;
+}
+
+const SummedAreaTables &Landscape::getSummedAreaTables()
+{
+    if(!summed_area_tables_current)
+    {
+        buildSummedAreaTables();
+    }
+    return summed_area_tables;
+}
+
+const DensityPyramid &Landscape::getPyramid(unsigned long level)
+{
+    if(!pyramid_current || pyramid.getLevels() < level)
+    {
+        const unsigned long num_tasks = scheduler == nullptr ? 1 : 4 * scheduler->getNumThreads();
+        pyramid.build(landscape.getRows(), landscape.getCols(), level,
+                      [this](unsigned long i, unsigned long j, unsigned long &rabbits, unsigned long &foxes,
+                             double &grass)
+                      {
+                          Cell &cell = landscape.get(i, j);
+                          rabbits = cell.getNumRabbits();
+                          foxes = cell.getNumFoxes();
+                          grass = cell.getGrass();
+                      },
+                      [this](unsigned long n, const std::function<void(unsigned long)> &function)
+                      {
+                          parallelFor(n, function);
+                      }, num_tasks);
+        pyramid_current = true;
+    }
+    return pyramid;
+}
+
+vector<double> Landscape::copyQuantity(const string &quantity)
+{
+    const unsigned long num_cells = landscape.getRows() * landscape.getCols();
+    vector<double> values(num_cells);
+    if(quantity == "grass")
+    {
+        copyGrass(values.data());
+        return values;
+    }
+    if(quantity != "rabbits" && quantity != "foxes")
+    {
+        throw invalid_argument("Unknown grid: " + quantity);
+    }
+    vector<int32_t> rabbits(num_cells);
+    vector<int32_t> foxes(num_cells);
+    copyCounts(rabbits.data(), foxes.data());
+    const vector<int32_t> &counts = quantity == "rabbits" ? rabbits : foxes;
+    copy(counts.begin(), counts.end(), values.begin());
+    return values;
+}
+
+DistanceStatistics Landscape::getDistanceStatistics(const string &quantity, const vector<double> &edges)
+{
+    vector<double> values = copyQuantity(quantity);
+    const unsigned long num_tasks = scheduler == nullptr ? 1 : 4 * scheduler->getNumThreads();
+    return SpatialStatistics::compute(values.data(), landscape.getRows(), landscape.getCols(), edges,
+                                      [this](unsigned long n, const std::function<void(unsigned long)> &function)
+                                      {
+                                          parallelFor(n, function);
+                                      }, num_tasks);
+}
+
+double Landscape::getMoransI(const string &quantity, double max_distance)
+{
+    vector<double> values = copyQuantity(quantity);
+    const unsigned long num_tasks = scheduler == nullptr ? 1 : 4 * scheduler->getNumThreads();
+    return SpatialStatistics::moransI(values.data(), landscape.getRows(), landscape.getCols(), max_distance,
+                                      [this](unsigned long n, const std::function<void(unsigned long)> &function)
+                                      {
+                                          parallelFor(n, function);
+                                      }, num_tasks);
+}
+
+unsigned long Landscape::runUntil(unsigned long max_steps, vector<StoppingCondition> &conditions, long &met)
+{
+    met = -1;
+    for(auto &condition : conditions)
+    {
+        condition.reset();
+    }
+    for(unsigned long step = 0; ; step++)
+    {
+        for(unsigned long k = 0; k < conditions.size(); k++)
+        {
+            if(conditions[k].update(totals))
+            {
+                met = static_cast<long>(k);
+                return step;
+            }
+        }
+        if(step == max_steps)
+        {
+            return step;
+        }
+        iterate();
+    }
+}
+
+void Landscape::compactPopulations()
+{
+    std::size_t live_bytes = arena->getLiveBytes();
+    std::size_t reserved_bytes = arena->getReservedBytes();
+    for(auto &tile_arena : tile_arenas)
+    {
+        live_bytes += tile_arena->getLiveBytes();
+        reserved_bytes += tile_arena->getReservedBytes();
+    }
+    // Only rebuild once more than half of the arenas is sitting unused.
+    if(live_bytes * 2 >= reserved_bytes)
+    {
+        return;
+    }
+    const bool has_next = next_landscape.getRows() == landscape.getRows()
+                          && next_landscape.getCols() == landscape.getCols();
+    if(numa_placement && rebalance_interval > 0 && !blocks.empty())
+    {
+        // Each tile's owner rebuilds its populations into a fresh arena of its own, which also brings any cells that
+        // have changed tile since they were placed onto their current owner's node.
+        vector<unique_ptr<PopulationArena>> new_arenas(blocks.size());
+        scheduler->run(blocks.size(), [this, &new_arenas, has_next](unsigned long task, unsigned long)
+        {
+            new_arenas[task] = make_unique<PopulationArena>();
+            PopulationArena* tile_arena = new_arenas[task].get();
+            forEachCellInTask(task, [this, tile_arena, has_next](unsigned long, unsigned long i, unsigned long j)
+            {
+                landscape.get(i, j).setArena(tile_arena);
+                if(has_next)
+                {
+                    next_landscape.get(i, j).setArena(tile_arena);
+                }
+            });
+        }, false);
+        for(auto &tile_arena : tile_arenas)
+        {
+            tile_arena->beginRelease();
+        }
+        tile_arenas = std::move(new_arenas);
+        return;
+    }
+    auto new_arena = make_unique<PopulationArena>();
+    for(unsigned long i = 0; i < landscape.getRows(); i++)
+    {
+        for(unsigned long j = 0; j < landscape.getCols(); j++)
+        {
+            landscape.get(i, j).setArena(new_arena.get());
+            // The next generation's cells still hold the generation before, in storage from the old arena.
+            if(has_next)
+            {
+                next_landscape.get(i, j).setArena(new_arena.get());
+            }
+        }
+    }
+    arena->beginRelease();
+    arena = std::move(new_arena);
+    for(auto &tile_arena : tile_arenas)
+    {
+        tile_arena->beginRelease();
+    }
+    tile_arenas.clear();
+}
+
+void Landscape::setCompactionInterval(unsigned long interval)
+{
+    compaction_interval = interval;
+}
+
+void Landscape::setParameters(const ModelParameters &model_parameters)
+{
+    model_parameters.validate();
+    parameters = model_parameters;
+}
+
+const ModelParameters &Landscape::getParameters() const
+{
+    return parameters;
 }
 
 void Landscape::setLandscapeSize(unsigned long x_size, unsigned long y_size)
 {
-    landscape.setSize(y_size, x_size);
+    // A time series or history has a fixed grid size, so ends here.
+    stopTimeSeries();
+    stopHistoryFile();
+    // The old cells are discarded along with their arenas, rather than releasing each population individually.
+    arena->beginRelease();
+    for(auto &tile_arena : tile_arenas)
+    {
+        tile_arena->beginRelease();
+    }
+    // The old cells must be destroyed while their arenas still exist.
+    next_landscape.setSize(0, 0);
+    landscape.setSize(0, 0);
+    arena = make_unique<PopulationArena>();
+    iteration = 0;
+    blocks.clear();
+    // Start from untouched storage, so that each page is placed by the thread which constructs its cells.
+    landscape.setSizeConstructedBy(y_size, x_size, [this, x_size, y_size]
+    {
+        if(numa_placement)
+        {
+            placeTiles();
+            return;
+        }
+        tile_arenas.clear();
+        for(unsigned long i = 0; i < y_size; i++)
+        {
+            for(unsigned long j = 0; j < x_size; j++)
+            {
+                Cell* cell = new(&landscape.get(i, j)) Cell();
+                cell->setArena(arena.get());
+            }
+        }
+    });
+    // The initial ages are drawn in order from the landscape's generator, whichever thread constructed each cell.
+    totals = PopulationTotals();
     for(unsigned long i = 0; i < y_size; i++)
     {
         for(unsigned long j = 0; j < x_size; j++)
         {
             Coordinates tmp_coordinate = Coordinates(j, i);
             landscape.get(i, j).setLocation(tmp_coordinate, random);
+            totals.rabbits += landscape.get(i, j).getNumRabbits();
+            totals.foxes += landscape.get(i, j).getNumFoxes();
+            totals.grass += landscape.get(i, j).getGrass();
         }
     }
+    history.assign(1, totals);
+    // Every cell is new, so counts as changed since any earlier token
+    change_epoch++;
+    change_epochs.assign(x_size * y_size, change_epoch);
+    grass_epochs.assign(x_size * y_size, change_epoch);
+    summed_area_tables_current = false;
+    pyramid_current = false;
+}
+
+void Landscape::copyCounts(int32_t* rabbits, int32_t* foxes)
+{
+    const unsigned long num_cells = landscape.getRows() * landscape.getCols();
+    for(unsigned long position = 0; position < num_cells; position++)
+    {
+        unsigned long row, col;
+        landscape.coordinates(position, row, col);
+        Cell &cell = landscape.getAtPosition(position);
+        rabbits[row * landscape.getCols() + col] = static_cast<int32_t>(cell.getNumRabbits());
+        foxes[row * landscape.getCols() + col] = static_cast<int32_t>(cell.getNumFoxes());
+    }
+}
+
+unsigned long Landscape::getChangeToken() const
+{
+    return change_epoch;
+}
+
+unsigned long Landscape::getChanges(unsigned long since, bool include_grass, vector<unsigned long> &indices,
+                                    vector<int32_t> &rabbits, vector<int32_t> &foxes, vector<double> &grass)
+{
+    vector<pair<unsigned long, unsigned long>> changed;
+    for(unsigned long position = 0; position < change_epochs.size(); position++)
+    {
+        if(change_epochs[position] > since || (include_grass && grass_epochs[position] > since))
+        {
+            unsigned long row, col;
+            landscape.coordinates(position, row, col);
+            changed.emplace_back(row * landscape.getCols() + col, position);
+        }
+    }
+    sort(changed.begin(), changed.end());
+    indices.clear();
+    rabbits.clear();
+    foxes.clear();
+    grass.clear();
+    for(auto &entry : changed)
+    {
+        Cell &cell = landscape.getAtPosition(entry.second);
+        indices.push_back(entry.first);
+        rabbits.push_back(static_cast<int32_t>(cell.getNumRabbits()));
+        foxes.push_back(static_cast<int32_t>(cell.getNumFoxes()));
+        grass.push_back(cell.getGrass());
+    }
+    return change_epoch;
+}
+
+void Landscape::recordTimeSeries()
+{
+    int32_t* rabbits;
+    int32_t* foxes;
+    time_series->beginStep(rabbits, foxes);
+    copyCounts(rabbits, foxes);
+    time_series->commitStep();
+}
+
+void Landscape::startTimeSeries(const string &path)
+{
+    stopTimeSeries();
+    time_series = make_unique<NpyTimeSeries>(path, landscape.getRows(), landscape.getCols());
+    recordTimeSeries();
+}
+
+void Landscape::stopTimeSeries()
+{
+    if(time_series != nullptr)
+    {
+        unique_ptr<NpyTimeSeries> finished = move(time_series);
+        finished->close();
+    }
+}
+
+void Landscape::recordHistoryFile()
+{
+    int32_t* rabbits;
+    int32_t* foxes;
+    history_file->beginFrame(rabbits, foxes);
+    copyCounts(rabbits, foxes);
+    history_file->commitFrame();
+}
+
+void Landscape::startHistoryFile(const string &path, unsigned long keyframe_interval)
+{
+    stopHistoryFile();
+    history_file = make_unique<HistoryWriter>(path, landscape.getRows(), landscape.getCols(), keyframe_interval);
+    recordHistoryFile();
+}
+
+void Landscape::stopHistoryFile()
+{
+    if(history_file != nullptr)
+    {
+        unique_ptr<HistoryWriter> finished = move(history_file);
+        finished->close();
+    }
+}
+
+void Landscape::copyGrass(double* grass)
+{
+    const unsigned long num_cells = landscape.getRows() * landscape.getCols();
+    for(unsigned long position = 0; position < num_cells; position++)
+    {
+        unsigned long row, col;
+        landscape.coordinates(position, row, col);
+        grass[row * landscape.getCols() + col] = landscape.getAtPosition(position).getGrass();
+    }
 }
 
 void Landscape::print()
@@ -4,11 +4,84 @@
 
 #ifndef LIB_LANDSCAPE_H
 #define LIB_LANDSCAPE_H
-#define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
 
-#include "Python.h"
+#include <cstdint>
 #include "Cell.h"
 #include "Matrix.h"
+#include "WorkStealingScheduler.h"
+#include "Partitioner.h"
+#include "MigrationQueue.h"
+#include "FirstTouchAllocator.h"
+#include "StoppingCondition.h"
+#include "SummedAreaTables.h"
+#include "DensityPyramid.h"
+#include "SpatialStatistics.h"
+#include "NpyTimeSeries.h"
+#include "HistoryWriter.h"
+
+// The cells are stored in 8x8 Morton-ordered tiles, so that the neighbours animals move to are usually nearby in
+// memory. They are sized with setSizeConstructedBy(), so that each is constructed by the thread which will own it.
+typedef Matrix<Cell, MortonTiledLayout<3>, FirstTouchAllocator<Cell>> CellMatrix;
+
+/**
+ * @brief The animals which have left their cells during an iteration, waiting to be added to their new cells.
+ */
+struct Migrants
+{
+    vector<Rabbit> rabbits;
+    vector<Fox> foxes;
+    // The storage position of the cell each migrant came from
+    vector<unsigned long> rabbit_sources;
+    vector<unsigned long> fox_sources;
+
+    /**
+     * @brief Removes all the migrants, keeping the allocated storage for the next iteration.
+     */
+    void clear()
+    {
+        rabbits.clear();
+        foxes.clear();
+        rabbit_sources.clear();
+        fox_sources.clear();
+    }
+};
+
+/**
+ * @brief An animal arriving in a tile from another tile, tagged with the storage position of the cell it came from.
+ * @tparam T the type of animal
+ */
+template<class T>
+struct Arrival
+{
+    T animal;
+    unsigned long source;
+};
+
+/**
+ * @brief The queues of animals arriving in a single tile from the other tiles.
+ */
+struct TileQueues
+{
+    MigrationQueue<Arrival<Rabbit>> rabbits;
+    MigrationQueue<Arrival<Fox>> foxes;
+};
+
+/**
+ * @brief Timings and load-balance statistics for the parallel execution of the landscape.
+ */
+struct LandscapeProfile
+{
+    // Wall-clock time of the most recent iteration, in seconds
+    double iteration_time = 0.0;
+    // Ratio of the slowest task's time to the mean task time in the most recent scheduled iteration
+    double task_imbalance = 1.0;
+    // Ratio of the heaviest block's estimated work to the mean, when the landscape was last partitioned
+    double partition_imbalance = 1.0;
+    // Time taken by the most recent rebalance, and by all rebalances, in seconds
+    double rebalance_time = 0.0;
+    double total_rebalance_time = 0.0;
+    unsigned long rebalances = 0;
+};
 
 /**
  * @brief Holds the landscape of foxes and rabbits and controls their behaviours.
@@ -16,15 +89,239 @@
 class Landscape
 {
 protected:
-    Matrix<Cell> landscape;
+    // The arena must outlive the cells which take storage from it, so is declared first.
+    unique_ptr<PopulationArena> arena;
+    // With NUMA-aware placement, each tile's populations are instead stored in the tile's own arena
+    vector<unique_ptr<PopulationArena>> tile_arenas;
+    bool numa_placement;
+    CellMatrix landscape;
+    // The next generation of the landscape, written to during each double-buffered iteration
+    CellMatrix next_landscape;
+    bool double_buffered;
     shared_ptr<RNGController> random;
+    unsigned long seed;
+    unsigned long iteration;
+    unsigned long compaction_interval;
+    ModelParameters parameters;
+    // Parallel execution, used once setThreads() has been called
+    unique_ptr<WorkStealingScheduler> scheduler;
+    unsigned long grain_size;
+    vector<shared_ptr<RNGController>> worker_randoms;
+    // The storage position of the first cell of each task, followed by the total number of cells
+    vector<unsigned long> task_starts;
+    vector<Migrants> task_migrants;
+    // The migrants of each task, split by the band of rows they are moving into, for double-buffered settling
+    vector<Migrants> band_migrants;
+    vector<double> task_times;
+    // Static partitioning, used instead of work stealing if rebalance_interval is non-zero
+    unsigned long rebalance_interval;
+    unsigned long last_rebalance;
+    Partitioner partitioner;
+    vector<Block> blocks;
+    // The tile (block) owning each cell, and the queues of animals moving into each tile from the others
+    Matrix<unsigned long> tile_owners;
+    vector<unique_ptr<TileQueues>> tile_queues;
+    // The migrants from each tile which did not fit in their destination's queue
+    vector<Migrants> task_overflow;
+    // The animals arriving in each tile from the others, gathered from the queues
+    vector<Migrants> tile_arrivals;
+    LandscapeProfile profile;
+    // The populations after the most recent iteration, and the part of them counted by each task
+    PopulationTotals totals;
+    vector<PopulationTotals> task_totals;
+    // The totals at the start and after every iteration since the landscape was set up
+    vector<PopulationTotals> history;
+    // Summed-area tables of the landscape, rebuilt after every iteration if requested, or otherwise when next queried
+    SummedAreaTables summed_area_tables;
+    bool eager_summed_area_tables;
+    bool summed_area_tables_current;
+    // The density pyramid, rebuilt when next queried after an iteration
+    DensityPyramid pyramid;
+    bool pyramid_current;
+    // Incremented at every iteration and setup; each cell's entries, indexed by storage position, are the epochs in
+    // which its populations and its grass last changed. Grass grows in most cells at every step, so is tracked apart
+    // from the populations, which change in far fewer.
+    unsigned long change_epoch;
+    vector<unsigned long> change_epochs;
+    vector<unsigned long> grass_epochs;
+    // The file the counts are appended to after every iteration, if any
+    unique_ptr<NpyTimeSeries> time_series;
+    // The compressed history being written, if any
+    unique_ptr<HistoryWriter> history_file;
+
+    /**
+     * @brief Rebuilds the population storage into a fresh arena if the current arena has become fragmented.
+     */
+    void compactPopulations();
+
+    /**
+     * @brief Runs the per-cell stages of an iteration for a single cell: growing grass, feeding, reproducing and
+     * moving.
+     * @param cell the cell to update
+     * @param cell_random the random number generator to use for the cell
+     * @param migrants the migrants to append the animals leaving the cell to
+     * @param counted the totals to add the cell's remaining animals and surviving migrants to
+     * @param position the storage position of the cell, whose change epoch is updated if the cell changes
+     */
+    void updateCell(Cell &cell, shared_ptr<RNGController> cell_random, Migrants &migrants, PopulationTotals &counted,
+                    unsigned long position);
+
+    /**
+     * @brief Adds the surviving migrants to their new cells.
+     * @param migrants the migrants to add
+     */
+    void settleMigrants(Migrants &migrants);
+
+    /**
+     * @brief Runs the per-cell stages on a single thread, drawing every random number from the landscape's generator.
+     */
+    void iterateSerial();
+
+    /**
+     * @brief Adds the surviving migrants from each set of migrants to their new cells, in order of the cells they
+     * came from.
+     * @details Each set of migrants must already be in order of their source cells.
+     * @param migrants the sets of migrants to merge
+     * @param target the landscape to add the migrants to
+     */
+    void settleMigrantsInOrder(const vector<Migrants*> &migrants, CellMatrix &target);
+
+    /**
+     * @brief Runs the per-cell stages on the scheduler, with each cell drawing from its own random number stream.
+     * @details Tasks are either contiguous ranges of cells, shared out by work stealing, or the rectangular blocks of
+     * the static partition.
+     */
+    void iterateScheduled();
+
+    /**
+     * @brief Prepares the tasks for the next scheduled iteration, rebalancing the partition if required.
+     * @return the number of tasks
+     */
+    unsigned long prepareTasks();
+
+    /**
+     * @brief Calls the function for each cell in the task, in the order the cells are stored.
+     * @param task the task
+     * @param function called as function(position, row, column) for each cell
+     */
+    template<class F>
+    void forEachCellInTask(unsigned long task, F function);
+
+    /**
+     * @brief Splits the migrants from the task by the band of rows they are moving into.
+     * @param task the task whose migrants to split
+     * @param num_bands the number of bands
+     */
+    void splitMigrantsByBand(unsigned long task, unsigned long num_bands);
+
+    /**
+     * @brief Keeps the cell's migrants which stay within the tile as local migrants, and hands those crossing into
+     * another tile to that tile's queues.
+     * @param task the tile the migrants are leaving from
+     * @param position the storage position of the cell the migrants are leaving from
+     * @param first_rabbit the position in the task's migrants of the first rabbit from the cell
+     * @param first_fox the position in the task's migrants of the first fox from the cell
+     */
+    void routeMigrants(unsigned long task, unsigned long position, unsigned long first_rabbit,
+                       unsigned long first_fox);
+
+    /**
+     * @brief Gathers the animals which have arrived in the tile from other tiles, in order of the cells they came
+     * from.
+     * @param task the tile to gather the arrivals of
+     * @return the arrivals, in order of their source cells
+     */
+    Migrants &gatherArrivals(unsigned long task);
+
+    /**
+     * @brief Makes sure the next-generation buffer matches the landscape, with empty cells at the same locations.
+     */
+    void prepareNextGeneration();
+
+    /**
+     * @brief Repartitions the landscape into one block per thread, weighted by the current populations.
+     */
+    void rebalance();
+
+    /**
+     * @brief Partitions the landscape into one tile (block) per thread and sets up each tile's migration queues.
+     * @param weights the estimated work of each cell
+     */
+    void assignTiles(Matrix<unsigned long> &weights);
+
+    /**
+     * @brief Constructs each tile's cells on the thread which owns the tile, so that their memory is placed on that
+     * thread's NUMA node.
+     */
+    void placeTiles();
+
+    /**
+     * @brief Gets the arena a cell's populations should be stored in.
+     * @param i the row of the cell
+     * @param j the column of the cell
+     * @return the owning tile's arena with NUMA-aware placement, otherwise the landscape's arena
+     */
+    PopulationArena* getCellArena(unsigned long i, unsigned long j);
+
+    /**
+     * @brief Records the imbalance between the times taken by the tasks of the last iteration.
+     * @param num_tasks the number of tasks run
+     */
+    void recordTaskTimes(unsigned long num_tasks);
+
+    /**
+     * @brief Splits the cells into contiguous tasks of roughly grain_size units of estimated work, where each cell's
+     * work is estimated from the number of animals it contains.
+     */
+    void buildTasks();
+
+    /**
+     * @brief Calls the function for each index from 0 to n, on the scheduler if there is one.
+     * @param n the number of indices
+     * @param function called as function(k) for each index
+     */
+    void parallelFor(unsigned long n, const std::function<void(unsigned long)> &function);
+
+    /**
+     * @brief Rebuilds the summed-area tables from the current landscape.
+     */
+    void buildSummedAreaTables();
+
+    /**
+     * @brief Copies one of the grids of the landscape.
+     * @param quantity the grid to copy: rabbits, foxes or grass
+     * @return the values of every cell, in row-major order
+     * @throws std::invalid_argument if the quantity is not recognised
+     */
+    vector<double> copyQuantity(const string &quantity);
+
+    /**
+     * @brief Appends the current counts to the time series file.
+     */
+    void recordTimeSeries();
+
+    /**
+     * @brief Queues the current counts to be appended to the history file.
+     */
+    void recordHistoryFile();
+
 public:
 
-    Landscape() : landscape(), random(make_shared<RNGController>())
+    Landscape() : arena(make_unique<PopulationArena>()), tile_arenas(), numa_placement(false), landscape(), next_landscape(), double_buffered(false),
+                  random(make_shared<RNGController>()), seed(0), iteration(0), compaction_interval(50),
+                  parameters(),
+                  scheduler(nullptr), grain_size(4096), worker_randoms(), task_starts(), task_migrants(),
+                  band_migrants(), task_times(), rebalance_interval(0), last_rebalance(0),
+                  partitioner(), blocks(), tile_owners(), tile_queues(), task_overflow(), tile_arrivals(), profile(),
+                  totals(), task_totals(), history(), summed_area_tables(), eager_summed_area_tables(false),
+                  summed_area_tables_current(false), pyramid(), pyramid_current(false), change_epoch(0),
+                  change_epochs(), grass_epochs(), time_series(), history_file()
     {
 
     }
 
+    ~Landscape();
+
     /**
      * @brief Sets the random number seed for the simulation.
      * @param i the random number seed
@@ -44,6 +341,137 @@ public:
      */
     void setLandscapeSize(unsigned long x_size, unsigned long y_size);
 
+    /**
+     * @brief Sets how often the population storage is checked for fragmentation and rebuilt.
+     * @param interval the number of iterations between checks, or 0 to never compact
+     */
+    void setCompactionInterval(unsigned long interval);
+
+    /**
+     * @brief Sets the parameters of the model.
+     * @param model_parameters the parameters, which are checked with ModelParameters::validate()
+     */
+    void setParameters(const ModelParameters &model_parameters);
+
+    /**
+     * @brief Gets the parameters of the model.
+     * @return the parameters
+     */
+    const ModelParameters &getParameters() const;
+
+    /**
+     * @brief Runs the per-cell stages of each iteration on the given number of threads, using work stealing to balance
+     * cells of differing population densities.
+     * @details Once set, each cell draws from its own random number stream (derived from the seed, iteration and cell),
+     * so the results are identical for any number of threads or grain size, but differ from the single-threaded
+     * default in which all cells share one random number sequence. Cells are visited in the order they are stored,
+     * along the Morton curve of each tile, and migrants are added to their new cells in the same order.
+     * @param threads the number of threads to use
+     * @param grain the estimated work (one per cell, plus one per animal) in each scheduled task
+     */
+    void setThreads(unsigned long threads, unsigned long grain);
+
+    /**
+     * @brief Switches the parallel execution from work stealing to a static partition of the landscape into one
+     * rectangular block per thread, with each block holding a similar number of animals.
+     * @details The partition is recomputed every rebalance_interval iterations as populations move. Animals moving
+     * within a block are settled by the block's own thread, while those crossing into another block are handed over
+     * through that block's lock-free queue, so only cross-block moves need any synchronisation. Results are identical
+     * to work stealing.
+     * @param interval the number of iterations between rebalances, or 0 to return to work stealing
+     */
+    void setPartitioning(unsigned long interval);
+
+    /**
+     * @brief Sets whether each parallel iteration reads from the current generation of the landscape and writes to a
+     * separate next generation, which are swapped at the end of the iteration.
+     * @details Each cell is copied from the current generation and updated in the next, leaving the current generation
+     * untouched until the swap. Migrants are then added to their destinations in the next generation by bands of rows
+     * in parallel, so no cell is ever written by two threads and no locks are needed. Results are identical to the
+     * in-place update, for any number of threads. Uses a single thread if setThreads() has not been called.
+     * @param enabled true to double-buffer the landscape
+     */
+    void setDoubleBuffered(bool enabled);
+
+    /**
+     * @brief Sets whether each tile's cells and population storage are allocated and initialised by the thread which
+     * owns the tile, with every thread pinned to its own CPU.
+     * @details Pages of memory are placed on the NUMA node of the thread which first writes to them, so this keeps
+     * each tile's memory local to the thread updating it. Placement requires a fixed assignment of cells to threads,
+     * so a static partition is used (never rebalanced, unless setPartitioning() has set an interval). Takes effect
+     * from the next call to setLandscapeSize(). Results are unchanged.
+     * @param enabled true to place each tile's memory on its owning thread's node
+     */
+    void setNumaPlacement(bool enabled);
+
+    /**
+     * @brief Gets the timings and load-balance statistics of the parallel execution.
+     * @return the profile
+     */
+    const LandscapeProfile &getProfile() const;
+
+    /**
+     * @brief Gets the total populations of the landscape, which are kept up to date as each iteration runs.
+     * @return the totals
+     */
+    const PopulationTotals &getTotals() const;
+
+    /**
+     * @brief Gets the totals at the start and after every iteration since the landscape was set up.
+     * @return the totals, with one more element than the number of iterations run
+     */
+    const vector<PopulationTotals> &getHistory() const;
+
+    /**
+     * @brief Iterates until one of the conditions holds, or the maximum number of iterations has been run.
+     * @details The conditions are checked against the starting totals and then after every iteration, each in constant
+     * time. They are reset at the start of the run.
+     * @param max_steps the maximum number of iterations
+     * @param conditions the conditions to check, in order
+     * @param met set to the index of the first condition which held, or -1 if none did
+     * @return the number of iterations run
+     */
+    unsigned long runUntil(unsigned long max_steps, vector<StoppingCondition> &conditions, long &met);
+
+    /**
+     * @brief Sets whether the summed-area tables are rebuilt, in parallel, at the end of every iteration.
+     * @details Otherwise they are rebuilt when first queried after an iteration.
+     * @param enabled true to rebuild the tables after every iteration
+     */
+    void setSummedAreaTables(bool enabled);
+
+    /**
+     * @brief Gets the summed-area tables of the rabbits, foxes and grass in the current landscape, building them first
+     * if they are out of date.
+     * @return the tables
+     */
+    const SummedAreaTables &getSummedAreaTables();
+
+    /**
+     * @brief Gets the density pyramid of the current landscape, building it first, in parallel, if it is out of date
+     * or does not reach the given level.
+     * @param level the highest level needed
+     * @return the pyramid
+     */
+    const DensityPyramid &getPyramid(unsigned long level);
+
+    /**
+     * @brief Computes the semivariance, pair correlation and Moran's I of one of the grids, binned by the distance
+     * between cells, in parallel if setThreads() has been called.
+     * @param quantity the grid: rabbits, foxes or grass
+     * @param edges the edges of the distance bins
+     * @return the statistics of each bin
+     */
+    DistanceStatistics getDistanceStatistics(const string &quantity, const vector<double> &edges);
+
+    /**
+     * @brief Computes Moran's I of one of the grids, with every pair of cells within the distance as neighbours.
+     * @param quantity the grid: rabbits, foxes or grass
+     * @param max_distance the greatest distance between neighbours, where 1 gives the rook's case
+     * @return Moran's I
+     */
+    double getMoransI(const string &quantity, double max_distance);
+
     /**
      * @brief Print the landscape to the terminal.
      */
@@ -68,16 +496,101 @@ public:
     }
 
     /**
-     * @brief Gets the cell at the specified location
+     * @brief Gets the cell at the specified location, without copying it.
      * @param i the row
      * @param j the column
-     * @return
+     * @return the cell, which is valid until the landscape is next iterated or resized
      */
-    Cell get(const unsigned long &i, const unsigned long &j)
+    const Cell &get(const unsigned long &i, const unsigned long &j)
     {
         return landscape.get(i, j);
     }
 
+    /**
+     * @brief Gets the number of rabbits in the cell at the specified location, without copying the cell.
+     * @param i the row
+     * @param j the column
+     * @return the number of rabbits
+     */
+    unsigned long getNumRabbits(unsigned long i, unsigned long j)
+    {
+        return landscape.get(i, j).getNumRabbits();
+    }
+
+    /**
+     * @brief Gets the number of foxes in the cell at the specified location, without copying the cell.
+     * @param i the row
+     * @param j the column
+     * @return the number of foxes
+     */
+    unsigned long getNumFoxes(unsigned long i, unsigned long j)
+    {
+        return landscape.get(i, j).getNumFoxes();
+    }
+
+    /**
+     * @brief Gets the token identifying the current state of the landscape, to pass to getChanges() later.
+     * @return the token, which increases with every iteration and setup
+     */
+    unsigned long getChangeToken() const;
+
+    /**
+     * @brief Gets the cells whose populations (and, optionally, grass) have changed since the token was taken, which
+     * were all of them if the landscape has been set up since.
+     * @param since a token from getChangeToken(), or 0 for every cell
+     * @param include_grass whether cells whose grass alone has changed are included
+     * @param indices set to the row-major index of each changed cell, in increasing order
+     * @param rabbits set to the number of rabbits in each changed cell
+     * @param foxes set to the number of foxes in each changed cell
+     * @param grass set to the amount of grass in each changed cell
+     * @return the token for the current state
+     */
+    unsigned long getChanges(unsigned long since, bool include_grass, vector<unsigned long> &indices,
+                             vector<int32_t> &rabbits, vector<int32_t> &foxes, vector<double> &grass);
+
+    /**
+     * @brief Writes the number of rabbits and foxes in every cell, visiting the cells in the order they are stored.
+     * @param rabbits the buffer for the rabbit counts, of rows * cols elements in row-major order
+     * @param foxes the buffer for the fox counts, of rows * cols elements in row-major order
+     */
+    void copyCounts(int32_t* rabbits, int32_t* foxes);
+
+    /**
+     * @brief Writes the amount of grass in every cell, visiting the cells in the order they are stored.
+     * @param grass the buffer for the grass, of rows * cols elements in row-major order
+     */
+    void copyGrass(double* grass);
+
+    /**
+     * @brief Starts writing the counts to a memory-mapped .npy file, of shape (steps, 2, rows, cols), which other
+     * processes can read with np.load(path, mmap_mode='r') while the simulation runs.
+     * @details The current counts are written as the first step, then the counts after every iteration. Any earlier
+     * time series file is closed first.
+     * @param path the path of the file, which is replaced if it exists
+     */
+    void startTimeSeries(const string &path);
+
+    /**
+     * @brief Stops writing the time series, truncating the file to the steps written and closing it.
+     */
+    void stopTimeSeries();
+
+    /**
+     * @brief Starts writing the counts to a compressed history file, with every frame seekable, for runs too long to
+     * keep every step uncompressed.
+     * @details The current counts are written as the first frame, then the counts after every iteration. Each
+     * iteration only copies the counts; they are encoded on the writer's own thread. Any earlier history file is
+     * closed first. See HistoryWriter for the format.
+     * @param path the path of the file, which is replaced if it exists
+     * @param keyframe_interval the number of frames from one keyframe to the next
+     */
+    void startHistoryFile(const string &path, unsigned long keyframe_interval);
+
+    /**
+     * @brief Waits for the queued frames to be encoded, then writes the index and closes the history file.
+     */
+    void stopHistoryFile();
+
 };
 
 #endif //LIB_LANDSCAPE_H
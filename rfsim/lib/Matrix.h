@@ -27,9 +27,11 @@
 #include <cstring>
 #include <stdexcept>
 #include <vector>
+#include <memory>
 
 
 #include <cstdint>
+#include "MatrixLayout.h"
 
 using namespace std;
 
@@ -38,8 +40,10 @@ using namespace std;
  * @brief A class containing the Matrix object, set up as an array of Row objects.
  * Includes basic operations, as well as the importCsv() function for more advanced reading from file.
  * @tparam T the type of the values in the matrix
+ * @tparam Layout the mapping of rows and columns to positions in the storage (e.g. RowMajorLayout)
+ * @tparam Allocator the allocator for the values
  */
-template<class T>
+template<class T, class Layout = RowMajorLayout, class Allocator = std::allocator<T>>
 class Matrix
 {
 
@@ -49,7 +53,7 @@ protected:
     unsigned long num_cols{};
     unsigned long num_rows{};
     // a matrix is an array of rows
-    vector<T> matrix;
+    vector<T, Allocator> matrix;
 public:
 
     /**
@@ -57,7 +61,8 @@ public:
      * @param rows optionally provide the number of rows.
      * @param cols optionally provide the number of columns.
      */
-    explicit Matrix(unsigned long rows = 0, unsigned long cols = 0) : matrix(rows * cols, T())
+    explicit Matrix(unsigned long rows = 0, unsigned long cols = 0) : num_cols(cols), num_rows(rows),
+                                                                      matrix(rows * cols, T())
     {
     }
 
@@ -93,6 +98,44 @@ public:
         num_rows = rows;
     }
 
+    /**
+     * @brief Replaces the matrix with fresh storage of the given size, whose elements are constructed by the given
+     * function instead of by default.
+     * @details Requires an allocator with a Deferral scope, such as FirstTouchAllocator. The old elements are destroyed
+     * and their storage released first. The new storage is untouched until construct() writes to it, so it may
+     * construct the elements on the threads which will use them, but must construct every element with placement new
+     * before returning. If it throws, the matrix is left empty, and its storage is released without destroying the
+     * elements, so the resources of any which were constructed are leaked.
+     * @param rows the number of rows
+     * @param cols the number of columns
+     * @param construct called as construct(), once the matrix has its new size, to construct every element
+     */
+    template<class F>
+    void setSizeConstructedBy(unsigned long rows, unsigned long cols, F construct)
+    {
+        vector<T, Allocator>().swap(matrix);
+        num_cols = 0;
+        num_rows = 0;
+        {
+            typename Allocator::Deferral deferral;
+            vector<T, Allocator>(rows * cols).swap(matrix);
+        }
+        num_cols = cols;
+        num_rows = rows;
+        try
+        {
+            construct();
+        }
+        catch(...)
+        {
+            typename Allocator::Deferral deferral;
+            vector<T, Allocator>().swap(matrix);
+            num_cols = 0;
+            num_rows = 0;
+            throw;
+        }
+    }
+
     /**
      * @brief Getter for the number of columns.
      * @return the number of columns.
@@ -124,15 +167,48 @@ public:
         {
             throw out_of_range("Matrix has 0 rows and columns for indexing from.");
         }
-        if(col + num_cols * row > matrix.size())
+        if(Layout::index(row, col, num_rows, num_cols) > matrix.size())
         {
             stringstream ss;
-            ss << "Index of " << col + num_cols * row << ", (" << row << ", " << col << ")";
+            ss << "Index of " << Layout::index(row, col, num_rows, num_cols) << ", (" << row << ", " << col << ")";
             ss << " is out of range of matrix vector with size " << matrix.size() << endl;
             throw out_of_range(ss.str());
         }
 #endif // DEBUG
-        return col + num_cols * row;
+        return Layout::index(row, col, num_rows, num_cols);
+    }
+
+    /**
+     * @brief Gets the row and column of the value at a particular position in the storage.
+     * @param position the storage position
+     * @param row set to the row number
+     * @param col set to the column number
+     */
+    void coordinates(unsigned long position, unsigned long &row, unsigned long &col) const
+    {
+        Layout::coordinates(position, num_rows, num_cols, row, col);
+    }
+
+    /**
+     * @brief Gets the value at a particular position in the storage.
+     * @param position the storage position, from 0 to rows * cols - 1
+     * @return the value at the position
+     */
+    T &getAtPosition(unsigned long position)
+    {
+        return matrix[position];
+    }
+
+    /**
+     * @brief Calls the function for each value within the rectangle of rows [row_start, row_end) and columns
+     * [col_start, col_end), in the order the values are stored.
+     * @param function called as function(position, row, col) for each value
+     */
+    template<class F>
+    void forEachInRegion(unsigned long row_start, unsigned long row_end, unsigned long col_start,
+                         unsigned long col_end, F function) const
+    {
+        Layout::forEachInRegion(num_rows, num_cols, row_start, row_end, col_start, col_end, function);
     }
 
     /**
@@ -175,6 +251,17 @@ public:
         return matrix[index(row, col)];
     }
 
+    /**
+     * @brief Swaps the contents of the two matrices without copying any elements.
+     * @param m the matrix to swap with.
+     */
+    void swap(Matrix &m)
+    {
+        std::swap(num_cols, m.num_cols);
+        std::swap(num_rows, m.num_rows);
+        matrix.swap(m.matrix);
+    }
+
     /**
      * @brief Overloading the = operator.
      * @param m the matrix to copy from.
@@ -0,0 +1,185 @@
+/**
+ * @brief Contains the layouts which map the rows and columns of a Matrix to positions in its storage.
+ */
+
+#ifndef LIB_MATRIXLAYOUT_H
+#define LIB_MATRIXLAYOUT_H
+
+#include <algorithm>
+
+/**
+ * @brief Stores each row of the matrix contiguously, one after another.
+ */
+struct RowMajorLayout
+{
+    /**
+     * @brief Gets the storage position of the element at the given row and column.
+     * @return the position
+     */
+    static unsigned long index(unsigned long row, unsigned long col, unsigned long, unsigned long num_cols)
+    {
+        return col + num_cols * row;
+    }
+
+    /**
+     * @brief Gets the row and column of the element at the given storage position.
+     * @param position the storage position
+     * @param row set to the row
+     * @param col set to the column
+     */
+    static void coordinates(unsigned long position, unsigned long, unsigned long num_cols, unsigned long &row,
+                            unsigned long &col)
+    {
+        row = position / num_cols;
+        col = position % num_cols;
+    }
+
+    /**
+     * @brief Calls the function for each element within the rectangle, in increasing order of storage position.
+     * @param function called as function(position, row, column)
+     */
+    template<class F>
+    static void forEachInRegion(unsigned long, unsigned long num_cols, unsigned long row_start, unsigned long row_end,
+                                unsigned long col_start, unsigned long col_end, F function)
+    {
+        for(unsigned long row = row_start; row < row_end; row++)
+        {
+            for(unsigned long col = col_start; col < col_end; col++)
+            {
+                function(col + num_cols * row, row, col);
+            }
+        }
+    }
+};
+
+/**
+ * @brief Stores the matrix as square tiles of 2^TileBits by 2^TileBits elements, each laid out along a Morton
+ * (Z-order) curve, so that the elements above and below one another are usually close in memory.
+ *
+ * @details Tiles are stored in row-major order. Where the number of rows or columns is not a multiple of the tile
+ * size, the leftover strip of columns on the right is stored row-major after the tiles, followed by the leftover strip
+ * of rows along the bottom, so that no padding is needed.
+ * @tparam TileBits the base-2 logarithm of the tile width
+ */
+template<unsigned long TileBits = 3>
+struct MortonTiledLayout
+{
+    static_assert(TileBits <= 16, "Morton tiles are limited to 2^16 elements across.");
+
+    static const unsigned long tile_size = 1ul << TileBits;
+    static const unsigned long tile_area = tile_size * tile_size;
+
+    /**
+     * @brief Spreads the bits of the value out to every other bit.
+     */
+    static unsigned long spread(unsigned long x)
+    {
+        x &= 0xFFFF;
+        x = (x | (x << 8)) & 0x00FF00FF;
+        x = (x | (x << 4)) & 0x0F0F0F0F;
+        x = (x | (x << 2)) & 0x33333333;
+        x = (x | (x << 1)) & 0x55555555;
+        return x;
+    }
+
+    /**
+     * @brief Gathers every other bit of the value back together, reversing spread().
+     */
+    static unsigned long compact(unsigned long x)
+    {
+        x &= 0x55555555;
+        x = (x | (x >> 1)) & 0x33333333;
+        x = (x | (x >> 2)) & 0x0F0F0F0F;
+        x = (x | (x >> 4)) & 0x00FF00FF;
+        x = (x | (x >> 8)) & 0x0000FFFF;
+        return x;
+    }
+
+    static unsigned long index(unsigned long row, unsigned long col, unsigned long num_rows, unsigned long num_cols)
+    {
+        const unsigned long tiled_rows = num_rows & ~(tile_size - 1);
+        const unsigned long tiled_cols = num_cols & ~(tile_size - 1);
+        if(row < tiled_rows && col < tiled_cols)
+        {
+            unsigned long tile = (row >> TileBits) * (tiled_cols >> TileBits) + (col >> TileBits);
+            return tile * tile_area + (spread(row & (tile_size - 1)) << 1 | spread(col & (tile_size - 1)));
+        }
+        if(row < tiled_rows)
+        {
+            return tiled_rows * tiled_cols + row * (num_cols - tiled_cols) + col - tiled_cols;
+        }
+        return tiled_rows * num_cols + (row - tiled_rows) * num_cols + col;
+    }
+
+    static void coordinates(unsigned long position, unsigned long num_rows, unsigned long num_cols,
+                            unsigned long &row, unsigned long &col)
+    {
+        const unsigned long tiled_rows = num_rows & ~(tile_size - 1);
+        const unsigned long tiled_cols = num_cols & ~(tile_size - 1);
+        if(position < tiled_rows * tiled_cols)
+        {
+            unsigned long tile = position >> (2 * TileBits);
+            unsigned long within = position & (tile_area - 1);
+            unsigned long tiles_per_row = tiled_cols >> TileBits;
+            row = (tile / tiles_per_row) * tile_size + compact(within >> 1);
+            col = (tile % tiles_per_row) * tile_size + compact(within);
+            return;
+        }
+        position -= tiled_rows * tiled_cols;
+        if(position < tiled_rows * (num_cols - tiled_cols))
+        {
+            row = position / (num_cols - tiled_cols);
+            col = tiled_cols + position % (num_cols - tiled_cols);
+            return;
+        }
+        position -= tiled_rows * (num_cols - tiled_cols);
+        row = tiled_rows + position / num_cols;
+        col = position % num_cols;
+    }
+
+    template<class F>
+    static void forEachInRegion(unsigned long num_rows, unsigned long num_cols, unsigned long row_start,
+                                unsigned long row_end, unsigned long col_start, unsigned long col_end, F function)
+    {
+        const unsigned long tiled_rows = num_rows & ~(tile_size - 1);
+        const unsigned long tiled_cols = num_cols & ~(tile_size - 1);
+        // The tiles overlapping the region, in storage order
+        const unsigned long tile_row_end = std::min(row_end, tiled_rows);
+        const unsigned long tile_col_end = std::min(col_end, tiled_cols);
+        for(unsigned long tile_row = row_start >> TileBits;
+            tile_row_end > 0 && tile_row <= (tile_row_end - 1) >> TileBits; tile_row++)
+        {
+            for(unsigned long tile_col = col_start >> TileBits;
+                tile_col_end > 0 && tile_col <= (tile_col_end - 1) >> TileBits; tile_col++)
+            {
+                unsigned long base = (tile_row * (tiled_cols >> TileBits) + tile_col) * tile_area;
+                for(unsigned long within = 0; within < tile_area; within++)
+                {
+                    unsigned long row = tile_row * tile_size + compact(within >> 1);
+                    unsigned long col = tile_col * tile_size + compact(within);
+                    if(row >= row_start && row < tile_row_end && col >= col_start && col < tile_col_end)
+                    {
+                        function(base + within, row, col);
+                    }
+                }
+            }
+        }
+        // Then the strip to the right of the tiles, and finally the strip below them
+        for(unsigned long row = row_start; row < tile_row_end; row++)
+        {
+            for(unsigned long col = std::max(col_start, tiled_cols); col < col_end; col++)
+            {
+                function(index(row, col, num_rows, num_cols), row, col);
+            }
+        }
+        for(unsigned long row = std::max(row_start, tiled_rows); row < row_end; row++)
+        {
+            for(unsigned long col = col_start; col < col_end; col++)
+            {
+                function(index(row, col, num_rows, num_cols), row, col);
+            }
+        }
+    }
+};
+
+#endif //LIB_MATRIXLAYOUT_H
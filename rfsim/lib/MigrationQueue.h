@@ -0,0 +1,142 @@
+/**
+ * @brief Contains the bounded lock-free queue used to hand migrating animals between tiles of the landscape.
+ */
+
+#ifndef LIB_MIGRATIONQUEUE_H
+#define LIB_MIGRATIONQUEUE_H
+
+#include <atomic>
+#include <memory>
+
+/**
+ * @brief A bounded multi-producer, single-consumer queue which never blocks.
+ *
+ * @details Each slot carries a sequence number recording whether it is free for the producer of a given position or
+ * holds a value ready for the consumer. Producers claim positions with a compare-and-swap on the enqueue position and
+ * publish their value by advancing the slot's sequence, so a producer's own values are always dequeued in the order
+ * they were pushed. When the queue is full, push() fails rather than waiting, leaving the producer to keep the value
+ * elsewhere.
+ * @tparam T the type of the values, which must be default-constructible
+ */
+template<class T>
+class MigrationQueue
+{
+protected:
+    struct Slot
+    {
+        std::atomic<unsigned long> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    unsigned long mask;
+    // Padded apart so that producers and the consumer do not share a cache line
+    alignas(64) std::atomic<unsigned long> enqueue_position;
+    alignas(64) unsigned long dequeue_position;
+
+public:
+
+    MigrationQueue() : slots(), mask(0), enqueue_position(0), dequeue_position(0)
+    {
+    }
+
+    MigrationQueue(const MigrationQueue &) = delete;
+
+    MigrationQueue &operator=(const MigrationQueue &) = delete;
+
+    /**
+     * @brief Discards the contents of the queue and resizes it.
+     * @details Not thread-safe: must only be called while no other thread is using the queue.
+     * @param capacity the minimum number of values the queue can hold, which is rounded up to a power of two
+     */
+    void reset(unsigned long capacity)
+    {
+        unsigned long size = 1;
+        while(size < capacity)
+        {
+            size *= 2;
+        }
+        if(size != mask + 1 || !slots)
+        {
+            slots.reset(new Slot[size]);
+        }
+        mask = size - 1;
+        for(unsigned long i = 0; i < size; i++)
+        {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        enqueue_position.store(0, std::memory_order_relaxed);
+        dequeue_position = 0;
+    }
+
+    /**
+     * @brief Gets the number of values the queue can hold.
+     * @return the capacity
+     */
+    unsigned long getCapacity() const
+    {
+        return slots ? mask + 1 : 0;
+    }
+
+    /**
+     * @brief Adds the value to the queue. Safe to call from any number of threads at once.
+     * @param value the value to add
+     * @return true if the value was added, or false if the queue was full
+     */
+    bool push(const T &value)
+    {
+        if(!slots)
+        {
+            return false;
+        }
+        unsigned long position = enqueue_position.load(std::memory_order_relaxed);
+        while(true)
+        {
+            Slot &slot = slots[position & mask];
+            unsigned long sequence = slot.sequence.load(std::memory_order_acquire);
+            long difference = static_cast<long>(sequence) - static_cast<long>(position);
+            if(difference == 0)
+            {
+                if(enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    slot.value = value;
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if(difference < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = enqueue_position.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Removes the oldest published value from the queue. Must only be called by the consuming thread.
+     * @param value set to the removed value
+     * @return true if a value was removed, or false if the queue was empty
+     */
+    bool pop(T &value)
+    {
+        if(!slots)
+        {
+            return false;
+        }
+        Slot &slot = slots[dequeue_position & mask];
+        unsigned long sequence = slot.sequence.load(std::memory_order_acquire);
+        if(static_cast<long>(sequence) - static_cast<long>(dequeue_position + 1) < 0)
+        {
+            return false;
+        }
+        value = slot.value;
+        slot.sequence.store(dequeue_position + mask + 1, std::memory_order_release);
+        dequeue_position++;
+        return true;
+    }
+};
+
+#endif //LIB_MIGRATIONQUEUE_H
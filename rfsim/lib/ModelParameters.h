@@ -0,0 +1,91 @@
+/**
+ * @brief Contains the tunable parameters of the model.
+ */
+
+#ifndef LIB_MODELPARAMETERS_H
+#define LIB_MODELPARAMETERS_H
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+/**
+ * @brief The parameters of the model which can be varied between runs.
+ *
+ * @details The defaults reproduce the original model exactly. Changing grass_growth, grass_variation or the
+ * reproduction thresholds never changes the number of random numbers drawn. Changing move_probability does, as an
+ * animal only draws its two offsets when it moves, as in the original model. Runs with the same seed are only kept on
+ * the same random numbers across all parameters by per-cell streams, which restart in every cell and step.
+ */
+struct ModelParameters
+{
+    // Each cell's grass grows by grass_growth plus a uniform integer from 0 to grass_variation every step
+    double grass_growth = 1000.0;
+    unsigned long grass_variation = 500;
+    // Animals reproduce while their energy exceeds the threshold
+    double rabbit_reproduction_threshold = 10.0;
+    double fox_reproduction_threshold = 50.0;
+    // The probability that an animal moves in each step
+    double move_probability = 0.1;
+
+    /**
+     * @brief Checks that the parameters are usable.
+     * @throws std::invalid_argument if any parameter is out of range
+     */
+    void validate() const
+    {
+        if(!(grass_growth >= 0.0))
+        {
+            throw std::invalid_argument("Grass growth must be non-negative.");
+        }
+        if(!(rabbit_reproduction_threshold >= 0.0) || !(fox_reproduction_threshold >= 0.0))
+        {
+            throw std::invalid_argument("Reproduction thresholds must be non-negative.");
+        }
+        if(!(move_probability >= 0.0 && move_probability <= 1.0))
+        {
+            throw std::invalid_argument("Move probability must be between 0 and 1.");
+        }
+    }
+
+    /**
+     * @brief Sets the parameter with the given name.
+     * @param name the name of the parameter, matching the member name
+     * @param value the new value
+     * @throws std::invalid_argument if there is no parameter with the name
+     */
+    void set(const std::string &name, double value)
+    {
+        if(name == "grass_growth")
+        {
+            grass_growth = value;
+        }
+        else if(name == "grass_variation")
+        {
+            // Checked before the conversion, which is undefined for values out of range.
+            if(!(value >= 0.0 && value <= 4294967295.0) || std::floor(value) != value)
+            {
+                throw std::invalid_argument("Grass variation must be a whole number from 0 to 4294967295.");
+            }
+            grass_variation = static_cast<unsigned long>(value);
+        }
+        else if(name == "rabbit_reproduction_threshold")
+        {
+            rabbit_reproduction_threshold = value;
+        }
+        else if(name == "fox_reproduction_threshold")
+        {
+            fox_reproduction_threshold = value;
+        }
+        else if(name == "move_probability")
+        {
+            move_probability = value;
+        }
+        else
+        {
+            throw std::invalid_argument("Unknown model parameter: " + name);
+        }
+    }
+};
+
+#endif //LIB_MODELPARAMETERS_H
@@ -0,0 +1,206 @@
+/**
+ * @brief Contains the writer of a growing .npy time series, which other processes can read while it is written.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include "NpyTimeSeries.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    // The largest number of steps which fits in the 8-character field of the header
+    const unsigned long max_steps = 99999999;
+    // The smallest number of steps the file grows by
+    const unsigned long min_growth = 16;
+
+    /**
+     * @brief Formats the number of steps right-aligned in 8 characters, as stored in the header.
+     */
+    uint64_t formatSteps(unsigned long steps)
+    {
+        char text[9];
+        snprintf(text, sizeof(text), "%8lu", steps);
+        uint64_t field;
+        memcpy(&field, text, sizeof(field));
+        return field;
+    }
+}
+
+#ifndef _WIN32
+
+NpyTimeSeries::NpyTimeSeries(const std::string &file_path, unsigned long num_rows, unsigned long num_cols)
+        : path(file_path), file(-1), rows(num_rows), cols(num_cols), steps(0), capacity(0), mapping(nullptr),
+          mapped_size(0), steps_field(0), header_size(0)
+{
+    // The magic string, version and header length take 10 bytes. Spaces before the shape align its first element.
+    std::string prefix = "{'descr': '<i4', 'fortran_order': False, 'shape': ";
+    while((10 + prefix.size() + 1) % 8 != 0)
+    {
+        prefix.push_back(' ');
+    }
+    prefix.push_back('(');
+    steps_field = 10 + prefix.size();
+    std::stringstream suffix;
+    suffix << ", 2, " << rows << ", " << cols << "), }";
+    std::string header = prefix + std::string(8, ' ') + suffix.str();
+    header.append(63 - (10 + header.size()) % 64, ' ');
+    header.push_back('\n');
+    header_size = 10 + header.size();
+    file = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(file < 0)
+    {
+        throw std::runtime_error("Could not create time series file: " + path);
+    }
+    if(ftruncate(file, static_cast<off_t>(header_size)) != 0)
+    {
+        release();
+        throw std::runtime_error("Could not size time series file: " + path);
+    }
+    void* address = mmap(nullptr, header_size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    if(address == MAP_FAILED)
+    {
+        release();
+        throw std::runtime_error("Could not map time series file: " + path);
+    }
+    mapping = static_cast<char*>(address);
+    mapped_size = header_size;
+    memcpy(mapping, "\x93NUMPY\x01\x00", 8);
+    mapping[8] = static_cast<char>(header.size() & 0xFF);
+    mapping[9] = static_cast<char>(header.size() >> 8);
+    memcpy(mapping + 10, header.data(), header.size());
+    uint64_t field = formatSteps(0);
+    memcpy(mapping + steps_field, &field, sizeof(field));
+}
+
+void NpyTimeSeries::reserve(unsigned long needed)
+{
+    if(needed <= capacity)
+    {
+        return;
+    }
+    if(needed > max_steps)
+    {
+        throw std::runtime_error("Time series files are limited to 99999999 steps.");
+    }
+    const unsigned long new_capacity = std::min(max_steps, std::max(needed, std::max(2 * capacity, min_growth)));
+    const unsigned long new_size = header_size + new_capacity * 2 * rows * cols * sizeof(int32_t);
+    if(ftruncate(file, static_cast<off_t>(new_size)) != 0)
+    {
+        throw std::runtime_error("Could not grow time series file: " + path);
+    }
+#ifdef __linux__
+    void* address = mremap(mapping, mapped_size, new_size, MREMAP_MAYMOVE);
+    if(address == MAP_FAILED)
+    {
+        throw std::runtime_error("Could not map time series file: " + path);
+    }
+#else
+    munmap(mapping, mapped_size);
+    void* address = mmap(nullptr, new_size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    if(address == MAP_FAILED)
+    {
+        mapping = nullptr;
+        throw std::runtime_error("Could not map time series file: " + path);
+    }
+#endif
+    mapping = static_cast<char*>(address);
+    mapped_size = new_size;
+    capacity = new_capacity;
+}
+
+void NpyTimeSeries::beginStep(int32_t* &rabbits, int32_t* &foxes)
+{
+    if(mapping == nullptr)
+    {
+        throw std::runtime_error("The time series file has been closed: " + path);
+    }
+    reserve(steps + 1);
+    rabbits = reinterpret_cast<int32_t*>(mapping + header_size) + steps * 2 * rows * cols;
+    foxes = rabbits + rows * cols;
+}
+
+void NpyTimeSeries::commitStep()
+{
+    steps++;
+    // The release ordering keeps the step's data ahead of the new shape.
+    __atomic_store_n(reinterpret_cast<uint64_t*>(mapping + steps_field), formatSteps(steps), __ATOMIC_RELEASE);
+}
+
+void NpyTimeSeries::release()
+{
+    if(mapping != nullptr)
+    {
+        munmap(mapping, mapped_size);
+        mapping = nullptr;
+    }
+    if(file >= 0)
+    {
+        ::close(file);
+        file = -1;
+    }
+}
+
+void NpyTimeSeries::close()
+{
+    if(file >= 0)
+    {
+        // Drop the room reserved for steps which were never written.
+        if(ftruncate(file, static_cast<off_t>(header_size + steps * 2 * rows * cols * sizeof(int32_t))) != 0)
+        {
+            release();
+            throw std::runtime_error("Could not truncate time series file: " + path);
+        }
+    }
+    release();
+}
+
+#else
+
+NpyTimeSeries::NpyTimeSeries(const std::string &file_path, unsigned long num_rows, unsigned long num_cols)
+        : path(file_path), file(-1), rows(num_rows), cols(num_cols), steps(0), capacity(0), mapping(nullptr),
+          mapped_size(0), steps_field(0), header_size(0)
+{
+    throw std::runtime_error("Memory-mapped time series are not supported on Windows.");
+}
+
+void NpyTimeSeries::reserve(unsigned long)
+{
+}
+
+void NpyTimeSeries::beginStep(int32_t* &, int32_t* &)
+{
+}
+
+void NpyTimeSeries::commitStep()
+{
+}
+
+void NpyTimeSeries::release()
+{
+}
+
+void NpyTimeSeries::close()
+{
+}
+
+#endif
+
+NpyTimeSeries::~NpyTimeSeries()
+{
+    try
+    {
+        close();
+    }
+    catch(std::exception &)
+    {
+    }
+}
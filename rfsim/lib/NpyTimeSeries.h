@@ -0,0 +1,101 @@
+/**
+ * @brief Contains the writer of a growing .npy time series, which other processes can read while it is written.
+ */
+
+#ifndef LIB_NPYTIMESERIES_H
+#define LIB_NPYTIMESERIES_H
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Writes the rabbit and fox counts after each step to a memory-mapped .npy file holding an int32 array of shape
+ * (steps, 2, rows, cols), which can be opened with np.load(path, mmap_mode='r') at any time.
+ *
+ * @details The file is grown in large chunks with ftruncate() and mremap(), so appending a step is only plain stores
+ * into the mapping. The number of steps in the header is held right-aligned in an 8-byte aligned field of the header
+ * text and is updated by a single 8-byte store after the step's data, so readers see either the old or the new shape,
+ * and every step within the shape is complete. The file is truncated to its final size when closed. Only available on
+ * POSIX systems; assumes a little-endian host.
+ */
+class NpyTimeSeries
+{
+protected:
+    std::string path;
+    int file;
+    unsigned long rows;
+    unsigned long cols;
+    unsigned long steps;
+    // The number of steps the file currently has room for
+    unsigned long capacity;
+    char* mapping;
+    unsigned long mapped_size;
+    // The position in the file of the 8-byte field holding the number of steps
+    unsigned long steps_field;
+    unsigned long header_size;
+
+    /**
+     * @brief Grows the file and the mapping to hold at least the given number of steps.
+     * @param needed the number of steps to make room for
+     */
+    void reserve(unsigned long needed);
+
+    /**
+     * @brief Unmaps and closes the file, without truncating it.
+     */
+    void release();
+
+public:
+    /**
+     * @brief Creates the file, replacing any existing file, with a header of zero steps.
+     * @param file_path the path of the .npy file
+     * @param num_rows the number of rows in each grid
+     * @param num_cols the number of columns in each grid
+     * @throws std::runtime_error if the file cannot be created or mapped
+     */
+    NpyTimeSeries(const std::string &file_path, unsigned long num_rows, unsigned long num_cols);
+
+    NpyTimeSeries(const NpyTimeSeries&) = delete;
+
+    NpyTimeSeries &operator=(const NpyTimeSeries&) = delete;
+
+    /**
+     * @brief Closes the file, if it has not already been closed.
+     */
+    ~NpyTimeSeries();
+
+    /**
+     * @brief Gets the storage for the next step, growing the file if needed, to be filled before commitStep().
+     * @param rabbits set to the rows * cols rabbit counts of the step, in row-major order
+     * @param foxes set to the rows * cols fox counts of the step, in row-major order
+     */
+    void beginStep(int32_t* &rabbits, int32_t* &foxes);
+
+    /**
+     * @brief Publishes the step filled since beginStep() by updating the shape in the header.
+     */
+    void commitStep();
+
+    /**
+     * @brief Truncates the file to the steps committed so far and closes it.
+     */
+    void close();
+
+    /**
+     * @brief Gets the number of steps committed.
+     */
+    unsigned long getSteps() const
+    {
+        return steps;
+    }
+
+    /**
+     * @brief Gets the path of the file.
+     */
+    const std::string &getPath() const
+    {
+        return path;
+    }
+};
+
+#endif //LIB_NPYTIMESERIES_H
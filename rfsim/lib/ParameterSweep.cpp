@@ -0,0 +1,98 @@
+/**
+ * @brief Contains the parameter sweep runner, which simulates replicates of the landscape at many points in parameter
+ * space in parallel.
+ */
+
+#include <cstdint>
+#include <stdexcept>
+#include "ParameterSweep.h"
+
+void ParameterSweep::addPoint(const ModelParameters &parameters)
+{
+    parameters.validate();
+    points.push_back(parameters);
+}
+
+void ParameterSweep::addGrid(const std::vector<std::pair<std::string, std::vector<double>>> &axes,
+                             const ModelParameters &base)
+{
+    unsigned long num_combinations = 1;
+    for(const auto &axis : axes)
+    {
+        num_combinations *= axis.second.size();
+    }
+    std::vector<ModelParameters> grid;
+    for(unsigned long combination = 0; combination < num_combinations; combination++)
+    {
+        ModelParameters parameters = base;
+        unsigned long remainder = combination;
+        for(auto axis = axes.rbegin(); axis != axes.rend(); ++axis)
+        {
+            parameters.set(axis->first, axis->second[remainder % axis->second.size()]);
+            remainder /= axis->second.size();
+        }
+        parameters.validate();
+        grid.push_back(parameters);
+    }
+    points.insert(points.end(), grid.begin(), grid.end());
+}
+
+unsigned long ParameterSweep::getNumPoints() const
+{
+    return points.size();
+}
+
+const ModelParameters &ParameterSweep::getPoint(unsigned long point) const
+{
+    return points.at(point);
+}
+
+unsigned long ParameterSweep::independentSeed(unsigned long seed, unsigned long point)
+{
+    // SplitMix64 finaliser of the seed offset by the point, so that nearby seeds and points give unrelated streams
+    uint64_t z = static_cast<uint64_t>(seed) + (static_cast<uint64_t>(point) + 1) * 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return static_cast<unsigned long>(z ^ (z >> 31));
+}
+
+void ParameterSweep::run(const std::vector<unsigned long> &seeds, unsigned long threads, bool common_random_numbers,
+                         const EnsembleOutput &output) const
+{
+    if(output.statistics != nullptr)
+    {
+        throw std::invalid_argument("Parameter sweeps do not support summary statistics.");
+    }
+    const unsigned long num_replicates = seeds.size();
+    std::vector<Ensemble> ensembles;
+    std::vector<EnsembleOutput> point_outputs;
+    for(unsigned long point = 0; point < points.size(); point++)
+    {
+        ensembles.emplace_back(x_size, y_size, steps, points[point]);
+        ensembles.back().setCellStreams(true);
+        // Each point writes to its own slice of the buffers, indexed by replicate as for a single ensemble
+        EnsembleOutput point_output;
+        const unsigned long first = point * num_replicates;
+        if(output.final_rabbits != nullptr && output.final_foxes != nullptr)
+        {
+            point_output.final_rabbits = output.final_rabbits + first * x_size * y_size;
+            point_output.final_foxes = output.final_foxes + first * x_size * y_size;
+        }
+        if(output.step_rabbits != nullptr && output.step_foxes != nullptr)
+        {
+            point_output.step_rabbits = output.step_rabbits + first * steps;
+            point_output.step_foxes = output.step_foxes + first * steps;
+        }
+        point_outputs.push_back(point_output);
+    }
+    WorkStealingScheduler scheduler(threads);
+    scheduler.run(points.size() * num_replicates,
+                  [&seeds, &ensembles, &point_outputs, num_replicates, common_random_numbers](unsigned long task,
+                                                                                              unsigned long)
+    {
+        const unsigned long point = task / num_replicates;
+        const unsigned long replicate = task % num_replicates;
+        unsigned long seed = common_random_numbers ? seeds[replicate] : independentSeed(seeds[replicate], point);
+        ensembles[point].runReplicate(replicate, seed, point_outputs[point], 0);
+    });
+}
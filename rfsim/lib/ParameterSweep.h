@@ -0,0 +1,94 @@
+/**
+ * @brief Contains the parameter sweep runner, which simulates replicates of the landscape at many points in parameter
+ * space in parallel.
+ */
+
+#ifndef LIB_PARAMETERSWEEP_H
+#define LIB_PARAMETERSWEEP_H
+
+#include <string>
+#include <utility>
+#include <vector>
+#include "Ensemble.h"
+
+/**
+ * @brief Runs an ensemble of replicates at each of a set of parameter points, with every replicate of every point as a
+ * separate task on one pool of threads.
+ *
+ * @details Replicates draw from one random number stream per cell and step, exactly as a CLandscape does once
+ * set_threads() has been called. With common random numbers, replicate r of every point uses the same seed, so every
+ * point draws the same numbers in each cell and step even once the populations have diverged. Differences between
+ * points are then due to the parameters rather than to sampling noise, so far fewer replicates are needed to resolve
+ * them. Otherwise, each point's seeds are derived from the given seeds and the index of the point, so that the points
+ * are independent.
+ */
+class ParameterSweep
+{
+protected:
+    unsigned long x_size;
+    unsigned long y_size;
+    unsigned long steps;
+    std::vector<ModelParameters> points;
+
+public:
+
+    /**
+     * @brief Creates a sweep with no points.
+     * @param x_size the x dimension of each landscape
+     * @param y_size the y dimension of each landscape
+     * @param steps the number of iterations to run each replicate for
+     */
+    ParameterSweep(unsigned long x_size, unsigned long y_size, unsigned long steps) : x_size(x_size), y_size(y_size),
+                                                                                     steps(steps), points()
+    {
+    }
+
+    /**
+     * @brief Adds a point to the sweep.
+     * @param parameters the parameters at the point, which are checked with ModelParameters::validate()
+     */
+    void addPoint(const ModelParameters &parameters);
+
+    /**
+     * @brief Adds every combination of the values of the given parameters, with the last parameter varying fastest.
+     * @param axes the name of each parameter to vary, with the values it takes
+     * @param base the values of the parameters which are not varied
+     */
+    void addGrid(const std::vector<std::pair<std::string, std::vector<double>>> &axes,
+                 const ModelParameters &base = ModelParameters());
+
+    /**
+     * @brief Gets the number of points in the sweep.
+     * @return the number of points
+     */
+    unsigned long getNumPoints() const;
+
+    /**
+     * @brief Gets the parameters at a point.
+     * @param point the index of the point
+     * @return the parameters
+     */
+    const ModelParameters &getPoint(unsigned long point) const;
+
+    /**
+     * @brief Gets the seed used for a replicate at a point without common random numbers.
+     * @param seed the seed given for the replicate
+     * @param point the index of the point
+     * @return the derived seed
+     */
+    static unsigned long independentSeed(unsigned long seed, unsigned long point);
+
+    /**
+     * @brief Runs one replicate for each seed at every point.
+     * @details Any exception thrown by a replicate is rethrown once the others have finished.
+     * @param seeds the seed of each replicate
+     * @param threads the number of threads to run the replicates on
+     * @param common_random_numbers if true, replicate r uses seeds[r] at every point
+     * @param output the buffers to write the results to, holding every replicate of the first point, followed by every
+     * replicate of the second, and so on. Summary statistics are not supported.
+     */
+    void run(const std::vector<unsigned long> &seeds, unsigned long threads, bool common_random_numbers,
+             const EnsembleOutput &output) const;
+};
+
+#endif //LIB_PARAMETERSWEEP_H
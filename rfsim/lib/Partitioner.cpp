@@ -0,0 +1,105 @@
+/**
+ * @brief Contains the partitioner which splits the landscape into rectangular blocks of similar population.
+ */
+
+#include "Partitioner.h"
+
+unsigned long Partitioner::sum(unsigned long row_start, unsigned long row_end, unsigned long col_start,
+                               unsigned long col_end) const
+{
+    return cumulative.getCopy(row_end, col_end) - cumulative.getCopy(row_start, col_end)
+           - cumulative.getCopy(row_end, col_start) + cumulative.getCopy(row_start, col_start);
+}
+
+void Partitioner::bisect(const Block &block, unsigned long parts, std::vector<Block> &blocks) const
+{
+    unsigned long rows = block.row_end - block.row_start;
+    unsigned long cols = block.col_end - block.col_start;
+    if(parts <= 1 || (rows <= 1 && cols <= 1))
+    {
+        blocks.push_back(block);
+        return;
+    }
+    unsigned long parts_first = parts / 2;
+    bool split_rows = rows >= cols;
+    unsigned long start = split_rows ? block.row_start : block.col_start;
+    unsigned long end = split_rows ? block.row_end : block.col_end;
+    // Find the first cut for which the leading side holds at least its share of the weight.
+    double target = static_cast<double>(block.weight) * parts_first / parts;
+    unsigned long low = start + 1;
+    unsigned long high = end - 1;
+    while(low < high)
+    {
+        unsigned long mid = low + (high - low) / 2;
+        unsigned long leading = split_rows ? sum(block.row_start, mid, block.col_start, block.col_end)
+                                           : sum(block.row_start, block.row_end, block.col_start, mid);
+        if(static_cast<double>(leading) < target)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    Block first = block;
+    Block second = block;
+    if(split_rows)
+    {
+        first.row_end = low;
+        second.row_start = low;
+    }
+    else
+    {
+        first.col_end = low;
+        second.col_start = low;
+    }
+    first.weight = sum(first.row_start, first.row_end, first.col_start, first.col_end);
+    second.weight = block.weight - first.weight;
+    bisect(first, parts_first, blocks);
+    bisect(second, parts - parts_first, blocks);
+}
+
+std::vector<Block> Partitioner::partition(Matrix<unsigned long> &weights, unsigned long parts)
+{
+    unsigned long rows = weights.getRows();
+    unsigned long cols = weights.getCols();
+    cumulative.setSize(rows + 1, cols + 1);
+    for(unsigned long i = 0; i < rows; i++)
+    {
+        unsigned long row_total = 0;
+        for(unsigned long j = 0; j < cols; j++)
+        {
+            row_total += weights.get(i, j);
+            cumulative.get(i + 1, j + 1) = cumulative.get(i, j + 1) + row_total;
+        }
+    }
+    std::vector<Block> blocks;
+    if(rows == 0 || cols == 0)
+    {
+        return blocks;
+    }
+    Block whole{0, rows, 0, cols, cumulative.get(rows, cols)};
+    bisect(whole, parts, blocks);
+    return blocks;
+}
+
+double Partitioner::imbalance(const std::vector<Block> &blocks)
+{
+    if(blocks.empty())
+    {
+        return 1.0;
+    }
+    unsigned long total = 0;
+    unsigned long heaviest = 0;
+    for(const auto &block : blocks)
+    {
+        total += block.weight;
+        heaviest = std::max(heaviest, block.weight);
+    }
+    if(total == 0)
+    {
+        return 1.0;
+    }
+    return static_cast<double>(heaviest) * blocks.size() / total;
+}
@@ -0,0 +1,74 @@
+/**
+ * @brief Contains the partitioner which splits the landscape into rectangular blocks of similar population.
+ */
+
+#ifndef LIB_PARTITIONER_H
+#define LIB_PARTITIONER_H
+
+#include <vector>
+#include "Matrix.h"
+
+/**
+ * @brief A rectangular block of cells, covering rows [row_start, row_end) and columns [col_start, col_end).
+ */
+struct Block
+{
+    unsigned long row_start;
+    unsigned long row_end;
+    unsigned long col_start;
+    unsigned long col_end;
+    // The total weight of the cells within the block when it was partitioned
+    unsigned long weight;
+};
+
+/**
+ * @brief Splits a grid of cell weights into rectangular blocks of roughly equal weight by recursive bisection.
+ *
+ * @details Each step cuts a block across its longer side, at the point which divides its weight in proportion to the
+ * number of parts each side will be split into. Block weights are found in O(1) from a summed-area table, so each cut
+ * is found by binary search.
+ */
+class Partitioner
+{
+protected:
+    // Summed-area table of the weights, with an extra leading row and column of zeros
+    Matrix<unsigned long> cumulative;
+
+    /**
+     * @brief Gets the total weight of the cells within the rectangle.
+     * @return the weight
+     */
+    unsigned long sum(unsigned long row_start, unsigned long row_end, unsigned long col_start,
+                      unsigned long col_end) const;
+
+    /**
+     * @brief Recursively splits the block into the given number of parts.
+     * @param block the block to split
+     * @param parts the number of parts
+     * @param blocks the output blocks to append to
+     */
+    void bisect(const Block &block, unsigned long parts, std::vector<Block> &blocks) const;
+
+public:
+
+    Partitioner() : cumulative()
+    {
+    }
+
+    /**
+     * @brief Partitions the weights into the given number of blocks.
+     * @param weights the weight (estimated work) of each cell
+     * @param parts the number of blocks to create
+     * @return the blocks, which together cover every cell exactly once
+     */
+    std::vector<Block> partition(Matrix<unsigned long> &weights, unsigned long parts);
+
+    /**
+     * @brief Gets the ratio of the heaviest block's weight to the mean block weight.
+     * @param blocks the blocks to check
+     * @return the imbalance, where 1.0 is perfectly balanced
+     */
+    static double imbalance(const std::vector<Block> &blocks);
+};
+
+#endif //LIB_PARTITIONER_H
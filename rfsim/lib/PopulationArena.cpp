@@ -0,0 +1,146 @@
+/**
+ * @brief Contains the PopulationArena class, which provides the storage for the populations of every cell in a
+ * landscape.
+ */
+
+#include <cstdlib>
+#include <new>
+#include "PopulationArena.h"
+
+namespace
+{
+    // Hands each thread the next shard the first time it uses any arena
+    std::atomic<std::size_t> next_shard(0);
+}
+
+PopulationArena::PopulationArena() : shards(), releasing(false)
+{
+}
+
+PopulationArena::~PopulationArena()
+{
+    for(auto &shard : shards)
+    {
+        for(auto &block : shard.blocks)
+        {
+            std::free(block);
+        }
+    }
+}
+
+std::size_t PopulationArena::sizeClass(std::size_t bytes)
+{
+    std::size_t size_class = 0;
+    while((static_cast<std::size_t>(64) << size_class) < bytes)
+    {
+        size_class++;
+    }
+    return size_class;
+}
+
+std::size_t PopulationArena::roundSize(std::size_t bytes)
+{
+    return static_cast<std::size_t>(64) << sizeClass(bytes);
+}
+
+PopulationArena::Shard &PopulationArena::threadShard()
+{
+    thread_local const std::size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % num_shards;
+    return shards[shard];
+}
+
+void* PopulationArena::allocate(std::size_t bytes)
+{
+    std::size_t size_class = sizeClass(bytes);
+    std::size_t rounded = static_cast<std::size_t>(64) << size_class;
+    Shard &shard = threadShard();
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if(size_class < shard.free_lists.size() && shard.free_lists[size_class] != nullptr)
+    {
+        void* ptr = shard.free_lists[size_class];
+        shard.free_lists[size_class] = *static_cast<void**>(ptr);
+        shard.live_bytes += rounded;
+        return ptr;
+    }
+    if(rounded > block_size / 4)
+    {
+        // Large populations get a block of their own, so that they don't waste the tail of a shared block.
+        void* ptr = std::malloc(rounded);
+        if(ptr == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        shard.blocks.push_back(ptr);
+        shard.reserved_bytes += rounded;
+        shard.live_bytes += rounded;
+        return ptr;
+    }
+    if(rounded > shard.remaining)
+    {
+        void* block = std::malloc(block_size);
+        if(block == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        shard.blocks.push_back(block);
+        shard.reserved_bytes += block_size;
+        shard.current = static_cast<char*>(block);
+        shard.remaining = block_size;
+    }
+    void* ptr = shard.current;
+    shard.current += rounded;
+    shard.remaining -= rounded;
+    shard.live_bytes += rounded;
+    return ptr;
+}
+
+void PopulationArena::deallocate(void* ptr, std::size_t bytes)
+{
+    if(releasing.load(std::memory_order_acquire))
+    {
+        return;
+    }
+    std::size_t size_class = sizeClass(bytes);
+    Shard &shard = threadShard();
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if(size_class >= shard.free_lists.size())
+    {
+        shard.free_lists.resize(size_class + 1, nullptr);
+    }
+    *static_cast<void**>(ptr) = shard.free_lists[size_class];
+    shard.free_lists[size_class] = ptr;
+    // May wrap below zero if the storage came from another shard, which the unsigned sum over the shards undoes.
+    shard.live_bytes -= static_cast<std::size_t>(64) << size_class;
+}
+
+void PopulationArena::beginRelease()
+{
+    releasing.store(true, std::memory_order_release);
+}
+
+bool PopulationArena::isReleasing() const
+{
+    return releasing.load(std::memory_order_acquire);
+}
+
+std::size_t PopulationArena::getReservedBytes() const
+{
+    std::size_t reserved_bytes = 0;
+    for(auto &shard : shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        reserved_bytes += shard.reserved_bytes;
+    }
+    return reserved_bytes;
+}
+
+std::size_t PopulationArena::getLiveBytes() const
+{
+    std::size_t live_bytes = 0;
+    for(auto &shard : shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        live_bytes += shard.live_bytes;
+    }
+    return live_bytes;
+}
@@ -0,0 +1,125 @@
+/**
+ * @brief Contains the PopulationArena class, which provides the storage for the populations of every cell in a
+ * landscape.
+ */
+
+#ifndef LIB_POPULATIONARENA_H
+#define LIB_POPULATIONARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief A slab allocator which carves the population storage for all the cells of a landscape from a small number
+ * of large blocks.
+ *
+ * @details Allocations are rounded up to a power-of-two size class. Freed allocations are kept on a per-class free
+ * list for reuse, so populations can grow and shrink without returning to the system allocator. All blocks are released
+ * together when the arena is destroyed, so tearing down a landscape costs one free() per block rather than one per
+ * cell.
+ *
+ * Allocation and deallocation are thread-safe. The arena is split into shards, each with its own blocks, free lists
+ * and lock, and each thread always uses the same shard, so the workers of a scheduler allocate in parallel rather than
+ * queueing on one lock. Storage freed by a thread goes on its own shard's free lists, whichever shard it came from.
+ */
+class PopulationArena
+{
+protected:
+    /**
+     * @brief The storage of one shard, on its own cache line so that threads using neighbouring shards do not contend.
+     */
+    struct alignas(64) Shard
+    {
+        // The blocks of memory held by the shard
+        std::vector<void*> blocks;
+        // The unused remainder of the most recent block
+        char* current = nullptr;
+        std::size_t remaining = 0;
+        // Singly-linked free lists for each power-of-two size class
+        std::vector<void*> free_lists;
+        std::size_t reserved_bytes = 0;
+        // Storage can be freed to a different shard than it came from, so only the sum over all shards is meaningful
+        std::size_t live_bytes = 0;
+        mutable std::mutex mutex;
+    };
+
+    static const std::size_t num_shards = 16;
+    Shard shards[num_shards];
+    std::atomic<bool> releasing;
+
+    /**
+     * @brief Gets the size class for the given number of bytes.
+     * @param bytes the (rounded) number of bytes
+     * @return the index of the free list for this size
+     */
+    static std::size_t sizeClass(std::size_t bytes);
+
+    /**
+     * @brief Gets the shard used by the calling thread.
+     * @return the shard
+     */
+    Shard &threadShard();
+
+public:
+
+    /**
+     * @brief The size of each block requested from the system allocator.
+     */
+    static const std::size_t block_size = 1 << 20;
+
+    PopulationArena();
+
+    ~PopulationArena();
+
+    PopulationArena(const PopulationArena &) = delete;
+
+    PopulationArena &operator=(const PopulationArena &) = delete;
+
+    /**
+     * @brief Rounds the number of bytes up to the size which will actually be allocated.
+     * @param bytes the number of bytes requested
+     * @return the number of bytes which will be reserved
+     */
+    static std::size_t roundSize(std::size_t bytes);
+
+    /**
+     * @brief Allocates storage from the calling thread's shard of the arena.
+     * @param bytes the number of bytes to allocate
+     * @return pointer to the storage, aligned for any fundamental type
+     */
+    void* allocate(std::size_t bytes);
+
+    /**
+     * @brief Returns storage to the calling thread's shard of the arena for later reuse.
+     * @param ptr the storage previously returned by allocate()
+     * @param bytes the number of bytes requested when allocating
+     */
+    void deallocate(void* ptr, std::size_t bytes);
+
+    /**
+     * @brief Marks the arena as about to be released, so that the owners of its storage can skip returning it.
+     */
+    void beginRelease();
+
+    /**
+     * @brief Checks if the arena is about to be released.
+     * @return true if storage no longer needs to be returned to the arena
+     */
+    bool isReleasing() const;
+
+    /**
+     * @brief Gets the total number of bytes held by the arena's blocks.
+     * @return the number of bytes reserved from the system
+     */
+    std::size_t getReservedBytes() const;
+
+    /**
+     * @brief Gets the number of bytes currently allocated from the arena.
+     * @return the number of live bytes
+     */
+    std::size_t getLiveBytes() const;
+};
+
+#endif //LIB_POPULATIONARENA_H
@@ -0,0 +1,45 @@
+/**
+ * @brief Contains the running totals of the landscape's populations.
+ */
+
+#ifndef LIB_POPULATIONTOTALS_H
+#define LIB_POPULATIONTOTALS_H
+
+/**
+ * @brief The total populations across the whole landscape, and the events of the most recent iteration.
+ *
+ * @details Totals are accumulated as each cell is updated, so reading them never needs a pass over the landscape.
+ */
+struct PopulationTotals
+{
+    unsigned long rabbits = 0;
+    unsigned long foxes = 0;
+    double grass = 0.0;
+    // Animals born during the iteration
+    unsigned long births = 0;
+    // Animals which starved, died of old age, were crowded out or died on the move, not counting those eaten
+    unsigned long deaths = 0;
+    // Rabbits eaten by foxes
+    unsigned long predation = 0;
+    // Animals which survived moving to another cell
+    unsigned long migrations = 0;
+
+    /**
+     * @brief Adds the totals of part of the landscape.
+     * @param other the totals to add
+     * @return this
+     */
+    PopulationTotals &operator+=(const PopulationTotals &other)
+    {
+        rabbits += other.rabbits;
+        foxes += other.foxes;
+        grass += other.grass;
+        births += other.births;
+        deaths += other.deaths;
+        predation += other.predation;
+        migrations += other.migrations;
+        return *this;
+    }
+};
+
+#endif //LIB_POPULATIONTOTALS_H
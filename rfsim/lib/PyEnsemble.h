@@ -0,0 +1,249 @@
+/**
+ * @brief Contains the wrapper for running ensembles of replicates from Python.
+ */
+#ifndef PY_ENSEMBLE
+#define PY_ENSEMBLE
+
+#include <Python.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#include "numpy/arrayobject.h"
+#include "Ensemble.h"
+
+/**
+ * @brief Reads the seeds from a Python sequence of integers.
+ * @param py_seeds the Python sequence
+ * @param seeds the vector to fill with the seeds
+ * @return false, with the Python error set, if the seeds could not be read
+ */
+static bool parseSeeds(PyObject* py_seeds, std::vector<unsigned long> &seeds)
+{
+    PyObject* seed_sequence = PySequence_Fast(py_seeds, "seeds must be a sequence of integers");
+    if(seed_sequence == nullptr)
+    {
+        return false;
+    }
+    for(Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(seed_sequence); i++)
+    {
+        seeds.push_back(PyLong_AsUnsignedLong(PySequence_Fast_GET_ITEM(seed_sequence, i)));
+    }
+    Py_DECREF(seed_sequence);
+    return PyErr_Occurred() == nullptr;
+}
+
+/**
+ * @brief Runs one replicate of the landscape for each seed, on a pool of native threads with the GIL released.
+ * @param self the Python module
+ * @param args the seeds, x and y sizes, number of steps, number of threads and, optionally, whether to record the
+ * total counts after every step
+ * @param kwargs keyword arguments
+ * @return a tuple of the final rabbit and fox counts of each cell, stacked into arrays of shape (seeds, y, x), followed
+ * by the total rabbit and fox counts after each step, of shape (seeds, steps), if requested
+ */
+static PyObject *runEnsemble(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    static const char* keywords[] = {"seeds", "x", "y", "steps", "threads", "record_steps", nullptr};
+    PyObject* py_seeds;
+    unsigned long x_size, y_size, steps, threads;
+    int record_steps = 0;
+    // parse arguments
+    if(!PyArg_ParseTupleAndKeywords(args, kwargs, "Okkkk|p", const_cast<char**>(keywords), &py_seeds, &x_size,
+                                    &y_size, &steps, &threads, &record_steps))
+    {
+        return nullptr;
+    }
+    std::vector<unsigned long> seeds;
+    if(!parseSeeds(py_seeds, seeds))
+    {
+        return nullptr;
+    }
+    // The outputs are allocated up front so that the replicates can write into them without the GIL.
+    npy_intp final_dims[3]{static_cast<npy_intp>(seeds.size()), static_cast<npy_intp>(y_size),
+                           static_cast<npy_intp>(x_size)};
+    npy_intp step_dims[2]{static_cast<npy_intp>(seeds.size()), static_cast<npy_intp>(steps)};
+    PyObject* final_rabbits = PyArray_ZEROS(3, final_dims, NPY_INT, 0);
+    PyObject* final_foxes = PyArray_ZEROS(3, final_dims, NPY_INT, 0);
+    PyObject* step_rabbits = record_steps ? PyArray_ZEROS(2, step_dims, NPY_ULONG, 0) : nullptr;
+    PyObject* step_foxes = record_steps ? PyArray_ZEROS(2, step_dims, NPY_ULONG, 0) : nullptr;
+    if(final_rabbits == nullptr || final_foxes == nullptr || (record_steps && (step_rabbits == nullptr
+                                                                                || step_foxes == nullptr)))
+    {
+        Py_XDECREF(final_rabbits);
+        Py_XDECREF(final_foxes);
+        Py_XDECREF(step_rabbits);
+        Py_XDECREF(step_foxes);
+        return nullptr;
+    }
+    EnsembleOutput output;
+    output.final_rabbits = static_cast<int*>(PyArray_DATA((PyArrayObject*) final_rabbits));
+    output.final_foxes = static_cast<int*>(PyArray_DATA((PyArrayObject*) final_foxes));
+    if(record_steps)
+    {
+        output.step_rabbits = static_cast<unsigned long*>(PyArray_DATA((PyArrayObject*) step_rabbits));
+        output.step_foxes = static_cast<unsigned long*>(PyArray_DATA((PyArrayObject*) step_foxes));
+    }
+    std::string error;
+    Py_BEGIN_ALLOW_THREADS
+    try
+    {
+        Ensemble(x_size, y_size, steps).run(seeds, threads, output);
+    }
+    catch(std::exception &e)
+    {
+        error = e.what();
+        if(error.empty())
+        {
+            error = "Ensemble failed.";
+        }
+    }
+    Py_END_ALLOW_THREADS
+    if(!error.empty())
+    {
+        Py_DECREF(final_rabbits);
+        Py_DECREF(final_foxes);
+        Py_XDECREF(step_rabbits);
+        Py_XDECREF(step_foxes);
+        PyErr_SetString(librfsimError, error.c_str());
+        return nullptr;
+    }
+    if(record_steps)
+    {
+        return Py_BuildValue("(NNNN)", final_rabbits, final_foxes, step_rabbits, step_foxes);
+    }
+    return Py_BuildValue("(NN)", final_rabbits, final_foxes);
+}
+
+/**
+ * @brief Converts the summaries to a dictionary of numpy arrays.
+ * @param summary the summaries to convert
+ * @param num_dims the number of dimensions of each summary array (1 or 2)
+ * @param dims the shape of each summary array
+ * @return dictionary of the mean, variance, quantiles (with the quantile as the leading dimension) and extinction
+ * probability (the fraction of replicates in which the count was zero)
+ */
+static PyObject *summaryToDict(const SummaryStatistics &summary, int num_dims, const npy_intp* dims)
+{
+    npy_intp quantile_dims[3]{static_cast<npy_intp>(summary.getQuantiles().size()), dims[0],
+                              num_dims > 1 ? dims[1] : 0};
+    PyObject* mean = PyArray_SimpleNew(num_dims, dims, NPY_DOUBLE);
+    PyObject* variance = PyArray_SimpleNew(num_dims, dims, NPY_DOUBLE);
+    PyObject* quantiles = PyArray_SimpleNew(num_dims + 1, quantile_dims, NPY_DOUBLE);
+    PyObject* extinction = PyArray_SimpleNew(num_dims, dims, NPY_DOUBLE);
+    if(mean == nullptr || variance == nullptr || quantiles == nullptr || extinction == nullptr)
+    {
+        Py_XDECREF(mean);
+        Py_XDECREF(variance);
+        Py_XDECREF(quantiles);
+        Py_XDECREF(extinction);
+        return nullptr;
+    }
+    auto mean_data = static_cast<double*>(PyArray_DATA((PyArrayObject*) mean));
+    auto variance_data = static_cast<double*>(PyArray_DATA((PyArrayObject*) variance));
+    auto quantile_data = static_cast<double*>(PyArray_DATA((PyArrayObject*) quantiles));
+    auto extinction_data = static_cast<double*>(PyArray_DATA((PyArrayObject*) extinction));
+    const unsigned long num_variables = summary.getNumVariables();
+    for(unsigned long variable = 0; variable < num_variables; variable++)
+    {
+        mean_data[variable] = summary.getMean(variable);
+        variance_data[variable] = summary.getVariance(variable);
+        extinction_data[variable] = summary.getZeroFraction(variable);
+        for(unsigned long q = 0; q < summary.getQuantiles().size(); q++)
+        {
+            quantile_data[q * num_variables + variable] = summary.getQuantile(variable, q);
+        }
+    }
+    return Py_BuildValue("{s:N,s:N,s:N,s:N}", "mean", mean, "variance", variance, "quantiles", quantiles,
+                         "extinction", extinction);
+}
+
+/**
+ * @brief Runs one replicate of the landscape for each seed, reducing the results to summary statistics as each
+ * replicate finishes, so that no replicate's grids are kept.
+ * @param self the Python module
+ * @param args the seeds, x and y sizes, number of steps, number of threads and, optionally, the quantiles to estimate
+ * @param kwargs keyword arguments
+ * @return dictionary of the summaries of the final count in each cell ("rabbits" and "foxes", of shape (y, x)) and of
+ * the total counts after each step ("rabbit_totals" and "fox_totals", of shape (steps,))
+ */
+static PyObject *runEnsembleStatistics(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    static const char* keywords[] = {"seeds", "x", "y", "steps", "threads", "quantiles", nullptr};
+    PyObject* py_seeds;
+    PyObject* py_quantiles = nullptr;
+    unsigned long x_size, y_size, steps, threads;
+    // parse arguments
+    if(!PyArg_ParseTupleAndKeywords(args, kwargs, "Okkkk|O", const_cast<char**>(keywords), &py_seeds, &x_size,
+                                    &y_size, &steps, &threads, &py_quantiles))
+    {
+        return nullptr;
+    }
+    std::vector<unsigned long> seeds;
+    if(!parseSeeds(py_seeds, seeds))
+    {
+        return nullptr;
+    }
+    std::vector<double> quantiles{0.05, 0.5, 0.95};
+    if(py_quantiles != nullptr)
+    {
+        PyObject* quantile_sequence = PySequence_Fast(py_quantiles, "quantiles must be a sequence of numbers");
+        if(quantile_sequence == nullptr)
+        {
+            return nullptr;
+        }
+        quantiles.clear();
+        for(Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(quantile_sequence); i++)
+        {
+            quantiles.push_back(PyFloat_AsDouble(PySequence_Fast_GET_ITEM(quantile_sequence, i)));
+        }
+        Py_DECREF(quantile_sequence);
+        if(PyErr_Occurred())
+        {
+            return nullptr;
+        }
+    }
+    std::unique_ptr<EnsembleStatistics> statistics;
+    std::string error;
+    Py_BEGIN_ALLOW_THREADS
+    try
+    {
+        // A few bands per thread keeps threads which finish together from queueing on the same band.
+        statistics.reset(new EnsembleStatistics(x_size * y_size, steps, quantiles, std::max(threads, 1ul) * 4));
+        EnsembleOutput output;
+        output.statistics = statistics.get();
+        Ensemble(x_size, y_size, steps).run(seeds, threads, output);
+    }
+    catch(std::exception &e)
+    {
+        error = e.what();
+        if(error.empty())
+        {
+            error = "Ensemble failed.";
+        }
+    }
+    Py_END_ALLOW_THREADS
+    if(!error.empty())
+    {
+        PyErr_SetString(librfsimError, error.c_str());
+        return nullptr;
+    }
+    npy_intp cell_dims[2]{static_cast<npy_intp>(y_size), static_cast<npy_intp>(x_size)};
+    npy_intp step_dims[1]{static_cast<npy_intp>(steps)};
+    PyObject* rabbits = summaryToDict(statistics->getCellRabbits(), 2, cell_dims);
+    PyObject* foxes = summaryToDict(statistics->getCellFoxes(), 2, cell_dims);
+    PyObject* rabbit_totals = summaryToDict(statistics->getStepRabbits(), 1, step_dims);
+    PyObject* fox_totals = summaryToDict(statistics->getStepFoxes(), 1, step_dims);
+    if(rabbits == nullptr || foxes == nullptr || rabbit_totals == nullptr || fox_totals == nullptr)
+    {
+        Py_XDECREF(rabbits);
+        Py_XDECREF(foxes);
+        Py_XDECREF(rabbit_totals);
+        Py_XDECREF(fox_totals);
+        return nullptr;
+    }
+    return Py_BuildValue("{s:N,s:N,s:N,s:N,s:N}", "rabbits", rabbits, "foxes", foxes, "rabbit_totals", rabbit_totals,
+                         "fox_totals", fox_totals, "replicates", PyLong_FromUnsignedLong(seeds.size()));
+}
+
+#endif // PY_ENSEMBLE
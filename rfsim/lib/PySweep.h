@@ -0,0 +1,206 @@
+/**
+ * @brief Contains the wrapper for running parameter sweeps from Python.
+ */
+#ifndef PY_SWEEP
+#define PY_SWEEP
+
+#include <Python.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include "numpy/arrayobject.h"
+#include "ParameterSweep.h"
+#include "PyWrapper.h"
+#include "PyEnsemble.h"
+
+/**
+ * @brief Adds the points of the sweep from Python.
+ * @param py_points either a dictionary of parameter names to sequences of values, which are swept over every
+ * combination with the last parameter varying fastest, or a sequence of dictionaries each giving a single point
+ * @param sweep the sweep to add the points to
+ * @return false, with the Python error set, if the points could not be read
+ */
+static bool parseSweepPoints(PyObject* py_points, ParameterSweep &sweep)
+{
+    if(PyDict_Check(py_points))
+    {
+        std::vector<std::pair<std::string, std::vector<double>>> axes;
+        PyObject* key;
+        PyObject* values;
+        Py_ssize_t position = 0;
+        while(PyDict_Next(py_points, &position, &key, &values))
+        {
+            const char* name = PyUnicode_AsUTF8(key);
+            if(name == nullptr)
+            {
+                return false;
+            }
+            PyObject* value_sequence = PySequence_Fast(values, "each parameter must have a sequence of values");
+            if(value_sequence == nullptr)
+            {
+                return false;
+            }
+            axes.emplace_back(name, std::vector<double>());
+            for(Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(value_sequence); i++)
+            {
+                axes.back().second.push_back(PyFloat_AsDouble(PySequence_Fast_GET_ITEM(value_sequence, i)));
+            }
+            Py_DECREF(value_sequence);
+            if(PyErr_Occurred())
+            {
+                return false;
+            }
+        }
+        try
+        {
+            sweep.addGrid(axes);
+        }
+        catch(std::exception &e)
+        {
+            PyErr_SetString(librfsimError, e.what());
+            return false;
+        }
+        return true;
+    }
+    PyObject* point_sequence = PySequence_Fast(py_points, "points must be a dictionary or a sequence of dictionaries");
+    if(point_sequence == nullptr)
+    {
+        return false;
+    }
+    for(Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(point_sequence); i++)
+    {
+        ModelParameters parameters;
+        if(!parseParameters(PySequence_Fast_GET_ITEM(point_sequence, i), parameters))
+        {
+            Py_DECREF(point_sequence);
+            return false;
+        }
+        try
+        {
+            sweep.addPoint(parameters);
+        }
+        catch(std::exception &e)
+        {
+            Py_DECREF(point_sequence);
+            PyErr_SetString(librfsimError, e.what());
+            return false;
+        }
+    }
+    Py_DECREF(point_sequence);
+    return true;
+}
+
+/**
+ * @brief Converts the parameters at a point to a dictionary.
+ * @param parameters the parameters
+ * @return a new dictionary of every parameter name and value
+ */
+static PyObject *parametersToDict(const ModelParameters &parameters)
+{
+    return Py_BuildValue("{s:d,s:k,s:d,s:d,s:d}", "grass_growth", parameters.grass_growth, "grass_variation",
+                         parameters.grass_variation, "rabbit_reproduction_threshold",
+                         parameters.rabbit_reproduction_threshold, "fox_reproduction_threshold",
+                         parameters.fox_reproduction_threshold, "move_probability", parameters.move_probability);
+}
+
+/**
+ * @brief Runs one replicate of the landscape for each seed at every point of a parameter sweep, on a pool of native
+ * threads with the GIL released.
+ * @param self the Python module
+ * @param args the points, seeds, x and y sizes, number of steps, number of threads and, optionally, whether to use
+ * common random numbers (true by default) and whether to record the total counts after every step
+ * @param kwargs keyword arguments
+ * @return dictionary of the parameters at each point ("points"), the final rabbit and fox counts of each cell
+ * ("rabbits" and "foxes", of shape (points, seeds, y, x)) and, if requested, the total counts after each step
+ * ("rabbit_totals" and "fox_totals", of shape (points, seeds, steps))
+ */
+static PyObject *runSweep(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    static const char* keywords[] = {"points", "seeds", "x", "y", "steps", "threads", "common_random_numbers",
+                                     "record_steps", nullptr};
+    PyObject* py_points;
+    PyObject* py_seeds;
+    unsigned long x_size, y_size, steps, threads;
+    int common_random_numbers = 1;
+    int record_steps = 0;
+    // parse arguments
+    if(!PyArg_ParseTupleAndKeywords(args, kwargs, "OOkkkk|pp", const_cast<char**>(keywords), &py_points, &py_seeds,
+                                    &x_size, &y_size, &steps, &threads, &common_random_numbers, &record_steps))
+    {
+        return nullptr;
+    }
+    std::vector<unsigned long> seeds;
+    if(!parseSeeds(py_seeds, seeds))
+    {
+        return nullptr;
+    }
+    ParameterSweep sweep(x_size, y_size, steps);
+    if(!parseSweepPoints(py_points, sweep))
+    {
+        return nullptr;
+    }
+    const auto num_points = static_cast<npy_intp>(sweep.getNumPoints());
+    npy_intp final_dims[4]{num_points, static_cast<npy_intp>(seeds.size()), static_cast<npy_intp>(y_size),
+                           static_cast<npy_intp>(x_size)};
+    npy_intp step_dims[3]{num_points, static_cast<npy_intp>(seeds.size()), static_cast<npy_intp>(steps)};
+    PyObject* final_rabbits = PyArray_ZEROS(4, final_dims, NPY_INT, 0);
+    PyObject* final_foxes = PyArray_ZEROS(4, final_dims, NPY_INT, 0);
+    PyObject* step_rabbits = record_steps ? PyArray_ZEROS(3, step_dims, NPY_ULONG, 0) : nullptr;
+    PyObject* step_foxes = record_steps ? PyArray_ZEROS(3, step_dims, NPY_ULONG, 0) : nullptr;
+    PyObject* points = PyList_New(num_points);
+    if(final_rabbits == nullptr || final_foxes == nullptr || points == nullptr
+       || (record_steps && (step_rabbits == nullptr || step_foxes == nullptr)))
+    {
+        Py_XDECREF(final_rabbits);
+        Py_XDECREF(final_foxes);
+        Py_XDECREF(step_rabbits);
+        Py_XDECREF(step_foxes);
+        Py_XDECREF(points);
+        return nullptr;
+    }
+    for(npy_intp point = 0; point < num_points; point++)
+    {
+        PyList_SET_ITEM(points, point, parametersToDict(sweep.getPoint(static_cast<unsigned long>(point))));
+    }
+    EnsembleOutput output;
+    output.final_rabbits = static_cast<int*>(PyArray_DATA((PyArrayObject*) final_rabbits));
+    output.final_foxes = static_cast<int*>(PyArray_DATA((PyArrayObject*) final_foxes));
+    if(record_steps)
+    {
+        output.step_rabbits = static_cast<unsigned long*>(PyArray_DATA((PyArrayObject*) step_rabbits));
+        output.step_foxes = static_cast<unsigned long*>(PyArray_DATA((PyArrayObject*) step_foxes));
+    }
+    std::string error;
+    Py_BEGIN_ALLOW_THREADS
+    try
+    {
+        sweep.run(seeds, threads, common_random_numbers != 0, output);
+    }
+    catch(std::exception &e)
+    {
+        error = e.what();
+        if(error.empty())
+        {
+            error = "Parameter sweep failed.";
+        }
+    }
+    Py_END_ALLOW_THREADS
+    if(!error.empty())
+    {
+        Py_DECREF(final_rabbits);
+        Py_DECREF(final_foxes);
+        Py_XDECREF(step_rabbits);
+        Py_XDECREF(step_foxes);
+        Py_DECREF(points);
+        PyErr_SetString(librfsimError, error.c_str());
+        return nullptr;
+    }
+    if(record_steps)
+    {
+        return Py_BuildValue("{s:N,s:N,s:N,s:N,s:N}", "points", points, "rabbits", final_rabbits, "foxes", final_foxes,
+                             "rabbit_totals", step_rabbits, "fox_totals", step_foxes);
+    }
+    return Py_BuildValue("{s:N,s:N,s:N}", "points", points, "rabbits", final_rabbits, "foxes", final_foxes);
+}
+
+#endif // PY_SWEEP
@@ -6,9 +6,11 @@
 
 #include <Python.h>
 #include <structmember.h>
+#include <algorithm>
 #include <memory>
 #include "numpy/arrayobject.h"
 #include "Landscape.h"
+#include "BackgroundIteration.h"
 
 /**
  * @brief Wrapper for the Landscape C class.
@@ -19,6 +21,8 @@ public:
     PyObject_HEAD
 
     std::unique_ptr<Landscape> landscape = nullptr;
+    // The run started by start(), which owns the landscape until it finishes
+    std::unique_ptr<BackgroundIteration> background = nullptr;
 
     virtual ~PyLandscape();
 
@@ -62,6 +66,8 @@ PyTemplate_clear(PyLandscape *self)
 static void
 PyTemplate_dealloc(PyLandscape *self)
 {
+    // Stops any background run at the end of its current iteration before the landscape goes.
+    self->background.reset();
     if(self->landscape != nullptr)
     {
         self->landscape.reset();
@@ -100,6 +106,21 @@ PyTemplate_init(PyLandscape *self, PyObject *args, PyObject *kwds)
     return 0;
 }
 
+/**
+ * @brief Checks that the landscape is not being iterated in the background, so that it is safe to use.
+ * @param self the Python self object
+ * @return false, with the Python error set, if a background run is still going
+ */
+static bool checkIdle(PyLandscape *self)
+{
+    if(self->background != nullptr && !self->background->isFinished())
+    {
+        PyErr_SetString(librfsimError, "The landscape is being iterated in the background; wait() or cancel() first.");
+        return false;
+    }
+    return true;
+}
+
 /**
  * @brief Sets up the simulation with a particular size and random number seed.
  * @param self the Python self object
@@ -107,6 +128,10 @@ PyTemplate_init(PyLandscape *self, PyObject *args, PyObject *kwds)
  */
 static PyObject *setup(PyLandscape *self, PyObject *args)
 {
+    if(!checkIdle(self))
+    {
+        return nullptr;
+    }
     // Set up the simulation, catch and return any errors.
     unsigned long seed;
     unsigned long x_size, y_size;
@@ -127,14 +152,137 @@ static PyObject *setup(PyLandscape *self, PyObject *args)
     Py_RETURN_NONE;
 }
 
+/**
+ * @brief Gets a level of the density pyramid as a numpy array.
+ * @param self the landscape to get the level for
+ * @param level the level, where level k sums blocks of 2^k by 2^k cells
+ * @param mean if true, divide each sum by the number of cells in its block
+ * @param quantity 0 for rabbits, 1 for foxes or 2 for grass
+ * @return the array of sums (int64, or float64 for grass) or means (float64)
+ */
+static PyObject *getLevelArray(PyLandscape *self, unsigned long level, bool mean, int quantity)
+{
+    import_array1(nullptr);
+    try
+    {
+        const unsigned long rows = DensityPyramid::levelSize(self->landscape->getRows(), level);
+        const unsigned long cols = DensityPyramid::levelSize(self->landscape->getCols(), level);
+        npy_intp dims[2]{static_cast<npy_intp>(rows), static_cast<npy_intp>(cols)};
+        const bool is_double = mean || quantity == 2;
+        PyObject* array = PyArray_SimpleNew(2, dims, is_double ? NPY_DOUBLE : NPY_INT64);
+        if(array == nullptr)
+        {
+            return nullptr;
+        }
+        void* data = PyArray_DATA((PyArrayObject*) array);
+        if(level == 0)
+        {
+            // The landscape itself, where each block is a single cell
+            vector<int32_t> rabbits(rows * cols);
+            vector<int32_t> foxes(rows * cols);
+            vector<double> grass(quantity == 2 ? rows * cols : 0);
+            if(quantity == 2)
+            {
+                self->landscape->copyGrass(grass.data());
+            }
+            else
+            {
+                self->landscape->copyCounts(rabbits.data(), foxes.data());
+            }
+            for(unsigned long k = 0; k < rows * cols; k++)
+            {
+                double value = quantity == 0 ? rabbits[k] : quantity == 1 ? foxes[k] : grass[k];
+                if(is_double)
+                {
+                    static_cast<double*>(data)[k] = value;
+                }
+                else
+                {
+                    static_cast<int64_t*>(data)[k] = static_cast<int64_t>(value);
+                }
+            }
+            return array;
+        }
+        const DensityPyramid &pyramid = self->landscape->getPyramid(level);
+        if(quantity == 2)
+        {
+            copy(pyramid.getGrass(level).begin(), pyramid.getGrass(level).end(), static_cast<double*>(data));
+        }
+        else
+        {
+            const vector<int64_t> &sums = quantity == 0 ? pyramid.getRabbits(level) : pyramid.getFoxes(level);
+            if(mean)
+            {
+                copy(sums.begin(), sums.end(), static_cast<double*>(data));
+            }
+            else
+            {
+                copy(sums.begin(), sums.end(), static_cast<int64_t*>(data));
+            }
+        }
+        if(mean)
+        {
+            auto values = static_cast<double*>(data);
+            for(unsigned long i = 0; i < rows; i++)
+            {
+                for(unsigned long j = 0; j < cols; j++)
+                {
+                    values[i * cols + j] /= pyramid.getCellsCovered(level, i, j);
+                }
+            }
+        }
+        return array;
+    }
+    catch(exception &e)
+    {
+        PyErr_SetString(librfsimError, e.what());
+        return nullptr;
+    }
+}
+
+/**
+ * @brief Parses the optional level and mean arguments of get_rabbits(), get_foxes() and get_grass().
+ * @return false, with the Python error set, if the arguments could not be parsed
+ */
+static bool parseLevelArguments(PyObject *args, PyObject *kwargs, unsigned long &level, int &mean)
+{
+    static const char* keywords[] = {"level", "mean", nullptr};
+    level = 0;
+    mean = 0;
+    if(!PyArg_ParseTupleAndKeywords(args, kwargs, "|kp", const_cast<char**>(keywords), &level, &mean))
+    {
+        return false;
+    }
+    if(level >= 64)
+    {
+        PyErr_SetString(PyExc_ValueError, "level must be less than 64");
+        return false;
+    }
+    return true;
+}
+
 /**
  * @brief Get the array of rabbits
  * @param self the landscape to get the rabbits for
- * @param args
+ * @param args optionally, the level of the density pyramid and whether to return block means rather than sums
  * @return the array of rabbits
  */
-static PyObject *getRabbitsArray(PyLandscape *self, PyObject *args)
+static PyObject *getRabbitsArray(PyLandscape *self, PyObject *args, PyObject *kwargs)
 {
+    if(!checkIdle(self))
+    {
+        return nullptr;
+    }
+    unsigned long level;
+    int mean;
+    if(!parseLevelArguments(args, kwargs, level, mean))
+    {
+        return nullptr;
+    }
+    if(level > 0 || mean)
+    {
+        return getLevelArray(self, level, mean != 0, 0);
+    }
     // Set up the simulation, catch and return any errors.
     try
     {
@@ -144,17 +292,11 @@ static PyObject *getRabbitsArray(PyLandscape *self, PyObject *args)
         npy_intp dims[2]{static_cast<long int>(self->landscape->getRows()),
                          static_cast<long int>(self->landscape->getCols())};
         // the output data
-        int *out_rabbits = new int[self->landscape->getRows() * self->landscape->getCols()];
-        unsigned long index = 0;
-        for(unsigned long i = 0; i < self->landscape->getRows(); i++)
-        {
-            for(unsigned long j = 0; j < self->landscape->getCols(); j++)
-            {
-                out_rabbits[index] = static_cast<int>(self->landscape->get(i, j).getNumRabbits());
-                index++;
-            }
-        }
-        PyObject *pArray = PyArray_SimpleNewFromData(2, dims, NPY_INT, (void *) out_rabbits);
+        int32_t *out_rabbits = new int32_t[self->landscape->getRows() * self->landscape->getCols()];
+        // Copied in storage order rather than cell by cell, with the foxes going to a scratch buffer
+        vector<int32_t> foxes(self->landscape->getRows() * self->landscape->getCols());
+        self->landscape->copyCounts(out_rabbits, foxes.data());
+        PyObject *pArray = PyArray_SimpleNewFromData(2, dims, NPY_INT32, (void *) out_rabbits);
         PyObject *capsule = PyCapsule_New(out_rabbits, NULL, capsuleCleanup);
         // NULL can be a string but use the same string while calling PyCapsule_GetPointer inside capsule_cleanup
         PyArray_SetBaseObject((PyArrayObject *) pArray, capsule);
@@ -170,11 +312,25 @@ static PyObject *getRabbitsArray(PyLandscape *self, PyObject *args)
 /**
  * @brief Get the array of foxes
  * @param self the landscape to get the foxes for
- * @param args
+ * @param args optionally, the level of the density pyramid and whether to return block means rather than sums
  * @return the array of foxes
  */
-static PyObject *getFoxesArray(PyLandscape *self, PyObject *args)
+static PyObject *getFoxesArray(PyLandscape *self, PyObject *args, PyObject *kwargs)
 {
+    if(!checkIdle(self))
+    {
+        return nullptr;
+    }
+    unsigned long level;
+    int mean;
+    if(!parseLevelArguments(args, kwargs, level, mean))
+    {
+        return nullptr;
+    }
+    if(level > 0 || mean)
+    {
+        return getLevelArray(self, level, mean != 0, 1);
+    }
     // Set up the simulation, catch and return any errors.
     try
     {
@@ -184,17 +340,11 @@ static PyObject *getFoxesArray(PyLandscape *self, PyObject *args)
         npy_intp dims[2]{static_cast<long int>(self->landscape->getRows()),
                          static_cast<long int>(self->landscape->getCols())};
         // the output data
-        int *out_foxes = new int[self->landscape->getRows() * self->landscape->getCols()];
-        unsigned long index = 0;
-        for(unsigned long i = 0; i < self->landscape->getRows(); i++)
-        {
-            for(unsigned long j = 0; j < self->landscape->getCols(); j++)
-            {
-                out_foxes[index] = static_cast<int>(self->landscape->get(i, j).getNumFoxes());
-                index++;
-            }
-        }
-        PyObject *pArray = PyArray_SimpleNewFromData(2, dims, NPY_INT, (void *) out_foxes);
+        int32_t *out_foxes = new int32_t[self->landscape->getRows() * self->landscape->getCols()];
+        // Copied in storage order rather than cell by cell, with the rabbits going to a scratch buffer
+        vector<int32_t> rabbits(self->landscape->getRows() * self->landscape->getCols());
+        self->landscape->copyCounts(rabbits.data(), out_foxes);
+        PyObject *pArray = PyArray_SimpleNewFromData(2, dims, NPY_INT32, (void *) out_foxes);
         PyObject *capsule = PyCapsule_New(out_foxes, NULL, capsuleCleanup);
         // NULL can be a string but use the same string while calling PyCapsule_GetPointer inside capsule_cleanup
         PyArray_SetBaseObject((PyArrayObject *) pArray, capsule);
@@ -207,6 +357,27 @@ static PyObject *getFoxesArray(PyLandscape *self, PyObject *args)
     Py_RETURN_NONE;
 }
 
+/**
+ * @brief Get the array of grass
+ * @param self the landscape to get the grass for
+ * @param args optionally, the level of the density pyramid and whether to return block means rather than sums
+ * @return the array of grass
+ */
+static PyObject *getGrassArray(PyLandscape *self, PyObject *args, PyObject *kwargs)
+{
+    if(!checkIdle(self))
+    {
+        return nullptr;
+    }
+    unsigned long level;
+    int mean;
+    if(!parseLevelArguments(args, kwargs, level, mean))
+    {
+        return nullptr;
+    }
+    return getLevelArray(self, level, mean != 0, 2);
+}
+
 /**
  * @brief Iterates the simulation.
  * @param self the Python self object
@@ -215,6 +386,10 @@ static PyObject *getFoxesArray(PyLandscape *self, PyObject *args)
  */
 static PyObject *iterate(PyLandscape *self, PyObject *args)
 {
+    if(!checkIdle(self))
+    {
+        return nullptr;
+    }
     // Run the program, catch and return any errors.
     try
     {
@@ -236,6 +411,851 @@ static PyObject *iterate(PyLandscape *self, PyObject *args)
     Py_RETURN_FALSE;
 }
 
+/**
+ * @brief Runs the simulation on multiple threads.
+ * @param self the Python self object
+ * @param args the number of threads and, optionally, the grain size of each scheduled task
+ */
+static PyObject *setThreads(PyLandscape *self, PyObject *args)
+{
+    if(!checkIdle(self))
+    {
+        return nullptr;
+    }
+    unsigned long threads;
+    unsigned long grain_size = 4096;
+    // parse arguments
+    if(!PyArg_ParseTuple(args, "k|k", &threads, &grain_size))
+    {
+        return nullptr;
+    }
+    try
+    {
+        self->landscape->setThreads(threads, grain_size);
+    }
+    catch(exception &e)
+    {
+        PyErr_SetString(librfsimError, e.what());
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+/**
+ * @brief Switches the multi-threaded simulation to a static partition of the landscape, rebalanced periodically.
+ * @param self the Python self object
+ * @param args the number of iterations between rebalances, or 0 to return to work stealing
+ */
+static PyObject *setPartitioning(PyLandscape *self, PyObject *args)
+{
+    if(!checkIdle(self))
+    {
+        return nullptr;
+    }
+    unsigned long interval;
+    // parse arguments
+    if(!PyArg_ParseTuple(args, "k", &interval))
+    {
+        return nullptr;
+    }
+    self->landscape->setPartitioning(interval);
+    Py_RETURN_NONE;
+}
+
+/**
+ * @brief Sets whether each iteration writes to a separate next generation of the landscape.
+ * @param self the Python self object
+ * @param args true to double-buffer the landscape
+ */
+static PyObject *setDoubleBuffered(PyLandscape *self, PyObject *args)
+{
+    if(!checkIdle(self))
+    {
+        return nullptr;
+    }
+    int enabled;
+    // parse arguments
+    if(!PyArg_ParseTuple(args, "p", &enabled))
+    {
+        return nullptr;
+    }
+    self->landscape->setDoubleBuffered(enabled != 0);
+    Py_RETURN_NONE;
+}
+
+/**
+ * @brief Sets whether each tile's memory is allocated and initialised by the thread which owns it.
+ * @param self the Python self object
+ * @param args true to place each tile's memory on its owning thread's NUMA node
+ */
+static PyObject *setNumaPlacement(PyLandscape *self, PyObject *args)
+{
+    if(!checkIdle(self))
+    {
+        return nullptr;
+    }
+    int enabled;
+    // parse arguments
+    if(!PyArg_ParseTuple(args, "p", &enabled))
+    {
+        return nullptr;
+    }
+    try
+    {
+        self->landscape->setNumaPlacement(enabled != 0);
+    }
+    catch(exception &e)
+    {
+        PyErr_SetString(librfsimError, e.what());
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+/**
+ * @brief Updates the model parameters from a mapping of parameter names to values.
+ * @param mapping the Python dictionary of parameter names and values, which may be null
+ * @param parameters the parameters to update
+ * @return false, with the Python error set, if the mapping could not be read or named an unknown parameter
+ */
+static bool parseParameters(PyObject* mapping, ModelParameters &parameters)
+{
+    if(mapping == nullptr)
+    {
+        return true;
+    }
+    if(!PyDict_Check(mapping))
+    {
+        PyErr_SetString(PyExc_TypeError, "parameters must be a dictionary of names and values");
+        return false;
+    }
+    PyObject* key;
+    PyObject* value;
+    Py_ssize_t position = 0;
+    while(PyDict_Next(mapping, &position, &key, &value))
+    {
+        const char* name = PyUnicode_AsUTF8(key);
+        double number = PyFloat_AsDouble(value);
+        if(name == nullptr || PyErr_Occurred())
+        {
+            return false;
+        }
+        try
+        {
+            parameters.set(name, number);
+        }
+        catch(exception &e)
+        {
+            PyErr_SetString(librfsimError, e.what());
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Sets the model parameters given as keyword arguments, leaving the others unchanged.
+ * @param self the Python self object
+ * @param args no positional arguments
+ * @param kwargs the parameter names and values
+ */
+static PyObject *setParameters(PyLandscape *self, PyObject *args, PyObject *kwargs)
+{
+    if(!checkIdle(self))
+    {
+        return nullptr;
+    }
+    if(PyTuple_Size(args) != 0)
+    {
+        PyErr_SetString(PyExc_TypeError, "set_parameters() only takes keyword arguments");
+        return nullptr;
+    }
+    ModelParameters parameters = self->landscape->getParameters();
+    if(!parseParameters(kwargs, parameters))
+    {
+        return nullptr;
+    }
+    try
+    {
+        self->landscape->setParameters(parameters);
+    }
+    catch(exception &e)
+    {
+        PyErr_SetString(librfsimError, e.what());
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+/**
+ * @brief Gets the landscape-wide totals, which are maintained as the landscape iterates rather than counted on demand.
+ * @param self the Python self object
+ * @param args
+ * @return dictionary of the populations and grass, and the births, deaths, predation and migrations of the last
+ * iteration
+ */
+static PyObject *getTotals(PyLandscape *self, PyObject *args)
+{
+    if(!checkIdle(self))
+    {
+        return nullptr;
+    }
+    const PopulationTotals &totals = self->landscape->getTotals();
+    return Py_BuildValue("{s:k,s:k,s:d,s:k,s:k,s:k,s:k}",
+                         "rabbits", totals.rabbits,
+                         "foxes", totals.foxes,
+                         "grass", totals.grass,
+                         "births", totals.births,
+                         "deaths", totals.deaths,
+                         "predation", totals.predation,
+                         "migrations", totals.migrations);
+}
+
+/**
+ * @brief Gets the totals at the start and after every iteration since the landscape was set up.
+ * @param self the Python self object
+ * @param args
+ * @return dictionary of arrays, keyed as for totals(), each with one more element than the iterations run
+ */
+static PyObject *getHistory(PyLandscape *self, PyObject *args)
+{
+    if(!checkIdle(self))
+    {
+        return nullptr;
+    }
+    import_array1(nullptr);
+    const vector<PopulationTotals> &history = self->landscape->getHistory();
+    npy_intp dims[1]{static_cast<npy_intp>(history.size())};
+    const char* names[] = {"rabbits", "foxes", "births", "deaths", "predation", "migrations"};
+    unsigned long PopulationTotals::* members[] = {&PopulationTotals::rabbits, &PopulationTotals::foxes,
+                                                   &PopulationTotals::births, &PopulationTotals::deaths,
+                                                   &PopulationTotals::predation, &PopulationTotals::migrations};
+    PyObject* result = PyDict_New();
+    for(unsigned long k = 0; k < 6 && result != nullptr; k++)
+    {
+        PyObject* array = PyArray_SimpleNew(1, dims, NPY_ULONG);
+        if(array == nullptr)
+        {
+            Py_CLEAR(result);
+            break;
+        }
+        auto data = static_cast<unsigned long*>(PyArray_DATA((PyArrayObject*) array));
+        for(unsigned long step = 0; step < history.size(); step++)
+        {
+            data[step] = history[step].*members[k];
+        }
+        PyDict_SetItemString(result, names[k], array);
+        Py_DECREF(array);
+    }
+    PyObject* grass = result == nullptr ? nullptr : PyArray_SimpleNew(1, dims, NPY_DOUBLE);
+    if(grass == nullptr)
+    {
+        Py_XDECREF(result);
+        return nullptr;
+    }
+    auto data = static_cast<double*>(PyArray_DATA((PyArrayObject*) grass));
+    for(unsigned long step = 0; step < history.size(); step++)
+    {
+        data[step] = history[step].grass;
+    }
+    PyDict_SetItemString(result, "grass", grass);
+    Py_DECREF(grass);
+    return result;
+}
+
+/**
+ * @brief Sets whether the summed-area tables are rebuilt after every iteration, rather than when next queried.
+ * @param self the Python self object
+ * @param args true to rebuild the tables after every iteration
+ */
+static PyObject *setSummedAreaTables(PyLandscape *self, PyObject *args)
+{
+    if(!checkIdle(self))
+    {
+        return nullptr;
+    }
+    int enabled;
+    // parse arguments
+    if(!PyArg_ParseTuple(args, "p", &enabled))
+    {
+        return nullptr;
+    }
+    self->landscape->setSummedAreaTables(enabled != 0);
+    Py_RETURN_NONE;
+}
+
+/**
+ * @brief Sums the rabbits, foxes and grass within each of a batch of rectangles, using the summed-area tables.
+ * @param self the Python self object
+ * @param args an array of shape (n, 4) of rectangles, each given as (row_start, col_start, row_end, col_end) with the
+ * ends excluded, as in grid[row_start:row_end, col_start:col_end]
+ * @return dictionary of arrays of the rabbits, foxes and grass in each rectangle
+ */
+static PyObject *getRegionSums(PyLandscape *self, PyObject *args)
+{
+    if(!checkIdle(self))
+    {
+        return nullptr;
+    }
+    import_array1(nullptr);
+    PyObject* rect_object;
+    if(!PyArg_ParseTuple(args, "O", &rect_object))
+    {
+        return nullptr;
+    }
+    PyObject* rects = PyArray_FROMANY(rect_object, NPY_LONG, 2, 2, NPY_ARRAY_IN_ARRAY);
+    if(rects == nullptr)
+    {
+        return nullptr;
+    }
+    if(PyArray_DIM((PyArrayObject*) rects, 1) != 4)
+    {
+        Py_DECREF(rects);
+        PyErr_SetString(PyExc_ValueError, "rects must have shape (n, 4)");
+        return nullptr;
+    }
+    npy_intp dims[1]{PyArray_DIM((PyArrayObject*) rects, 0)};
+    const long* corners = static_cast<const long*>(PyArray_DATA((PyArrayObject*) rects));
+    PyObject* rabbits = PyArray_SimpleNew(1, dims, NPY_UINT64);
+    PyObject* foxes = PyArray_SimpleNew(1, dims, NPY_UINT64);
+    PyObject* grass = PyArray_SimpleNew(1, dims, NPY_DOUBLE);
+    if(rabbits == nullptr || foxes == nullptr || grass == nullptr)
+    {
+        Py_DECREF(rects);
+        Py_XDECREF(rabbits);
+        Py_XDECREF(foxes);
+        Py_XDECREF(grass);
+        return nullptr;
+    }
+    auto rabbit_sums = static_cast<uint64_t*>(PyArray_DATA((PyArrayObject*) rabbits));
+    auto fox_sums = static_cast<uint64_t*>(PyArray_DATA((PyArrayObject*) foxes));
+    auto grass_sums = static_cast<double*>(PyArray_DATA((PyArrayObject*) grass));
+    try
+    {
+        const SummedAreaTables &tables = self->landscape->getSummedAreaTables();
+        for(npy_intp k = 0; k < dims[0]; k++)
+        {
+            const long* rect = corners + 4 * k;
+            if(*min_element(rect, rect + 4) < 0)
+            {
+                throw out_of_range("Region bounds must be non-negative.");
+            }
+            RegionSums sums = tables.sum(rect[0], rect[1], rect[2], rect[3]);
+            rabbit_sums[k] = sums.rabbits;
+            fox_sums[k] = sums.foxes;
+            grass_sums[k] = sums.grass;
+        }
+    }
+    catch(exception &e)
+    {
+        Py_DECREF(rects);
+        Py_DECREF(rabbits);
+        Py_DECREF(foxes);
+        Py_DECREF(grass);
+        PyErr_SetString(librfsimError, e.what());
+        return nullptr;
+    }
+    Py_DECREF(rects);
+    return Py_BuildValue("{s:N,s:N,s:N}", "rabbits", rabbits, "foxes", foxes, "grass", grass);
+}
+
+/**
+ * @brief Creates a one-dimensional numpy array holding a copy of the values.
+ * @param values the values
+ * @param type the numpy type of the array, matching the values
+ * @return the array, or null with the Python error set
+ */
+template<class T>
+static PyObject *copyToArray(const vector<T> &values, int type)
+{
+    npy_intp dims[1]{static_cast<npy_intp>(values.size())};
+    PyObject* array = PyArray_SimpleNew(1, dims, type);
+    if(array != nullptr)
+    {
+        copy(values.begin(), values.end(), static_cast<T*>(PyArray_DATA((PyArrayObject*) array)));
+    }
+    return array;
+}
+
+/**
+ * @brief Computes the semivariance, pair correlation and Moran's I of one of the grids, binned by distance.
+ * @param self the Python self object
+ * @param args the grid (rabbits, foxes or grass) and the edges of the distance bins
+ * @return dictionary of the edges and the pairs, semivariance, pair_correlation and morans_i of each bin
+ */
+static PyObject *getSpatialStatistics(PyLandscape *self, PyObject *args)
+{
+    if(!checkIdle(self))
+    {
+        return nullptr;
+    }
+    import_array1(nullptr);
+    const char* quantity;
+    PyObject* edge_object;
+    if(!PyArg_ParseTuple(args, "sO", &quantity, &edge_object))
+    {
+        return nullptr;
+    }
+    PyObject* edge_array = PyArray_FROMANY(edge_object, NPY_DOUBLE, 1, 1, NPY_ARRAY_IN_ARRAY);
+    if(edge_array == nullptr)
+    {
+        return nullptr;
+    }
+    auto edge_data = static_cast<const double*>(PyArray_DATA((PyArrayObject*) edge_array));
+    vector<double> edges(edge_data, edge_data + PyArray_DIM((PyArrayObject*) edge_array, 0));
+    Py_DECREF(edge_array);
+    DistanceStatistics statistics;
+    try
+    {
+        statistics = self->landscape->getDistanceStatistics(quantity, edges);
+    }
+    catch(exception &e)
+    {
+        PyErr_SetString(librfsimError, e.what());
+        return nullptr;
+    }
+    return Py_BuildValue("{s:N,s:N,s:N,s:N,s:N}",
+                         "edges", copyToArray(statistics.edges, NPY_DOUBLE),
+                         "pairs", copyToArray(statistics.pairs, NPY_ULONG),
+                         "semivariance", copyToArray(statistics.semivariance, NPY_DOUBLE),
+                         "pair_correlation", copyToArray(statistics.pair_correlation, NPY_DOUBLE),
+                         "morans_i", copyToArray(statistics.morans_i, NPY_DOUBLE));
+}
+
+/**
+ * @brief Computes Moran's I of one of the grids.
+ * @param self the Python self object
+ * @param args the grid (rabbits, foxes or grass) and, optionally, the greatest distance between neighbours
+ * @return Moran's I
+ */
+static PyObject *getMoransI(PyLandscape *self, PyObject *args)
+{
+    if(!checkIdle(self))
+    {
+        return nullptr;
+    }
+    const char* quantity;
+    double max_distance = 1.0;
+    if(!PyArg_ParseTuple(args, "s|d", &quantity, &max_distance))
+    {
+        return nullptr;
+    }
+    try
+    {
+        return PyFloat_FromDouble(self->landscape->getMoransI(quantity, max_distance));
+    }
+    catch(exception &e)
+    {
+        PyErr_SetString(librfsimError, e.what());
+        return nullptr;
+    }
+}
+
+/**
+ * @brief Gets the cells whose populations have changed since the token was taken. Grass grows in most cells at every
+ * step, so cells whose grass alone has changed are only included if asked for.
+ * @param self the Python self object
+ * @param args optionally, the token from an earlier call, where the default of 0 returns every cell, and whether to
+ * include the cells whose grass has changed
+ * @return tuple of a dictionary of the index (row-major), rabbits, foxes and grass of each changed cell, and the token
+ * to pass to the next call
+ */
+static PyObject *getChanges(PyLandscape *self, PyObject *args, PyObject *kwargs)
+{
+    if(!checkIdle(self))
+    {
+        return nullptr;
+    }
+    import_array1(nullptr);
+    static const char* keywords[] = {"token", "grass", nullptr};
+    unsigned long since = 0;
+    int include_grass = 0;
+    if(!PyArg_ParseTupleAndKeywords(args, kwargs, "|kp", const_cast<char**>(keywords), &since, &include_grass))
+    {
+        return nullptr;
+    }
+    vector<unsigned long> indices;
+    vector<int32_t> rabbits;
+    vector<int32_t> foxes;
+    vector<double> grass;
+    unsigned long token = self->landscape->getChanges(since, include_grass != 0, indices, rabbits, foxes, grass);
+    return Py_BuildValue("({s:N,s:N,s:N,s:N}k)",
+                         "index", copyToArray(indices, NPY_ULONG),
+                         "rabbits", copyToArray(rabbits, NPY_INT32),
+                         "foxes", copyToArray(foxes, NPY_INT32),
+                         "grass", copyToArray(grass, NPY_DOUBLE),
+                         token);
+}
+
+/**
+ * @brief Starts writing the counts at every step to a memory-mapped .npy file, readable while the simulation runs.
+ * @param self the Python self object
+ * @param args the path of the file
+ */
+static PyObject *startNpyOutput(PyLandscape *self, PyObject *args)
+{
+    if(!checkIdle(self))
+    {
+        return nullptr;
+    }
+    const char* path;
+    if(!PyArg_ParseTuple(args, "s", &path))
+    {
+        return nullptr;
+    }
+    try
+    {
+        self->landscape->startTimeSeries(path);
+    }
+    catch(exception &e)
+    {
+        PyErr_SetString(librfsimError, e.what());
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+/**
+ * @brief Stops writing the time series file, truncating it to the steps written.
+ * @param self the Python self object
+ * @param args
+ */
+static PyObject *stopNpyOutput(PyLandscape *self, PyObject *args)
+{
+    if(!checkIdle(self))
+    {
+        return nullptr;
+    }
+    try
+    {
+        self->landscape->stopTimeSeries();
+    }
+    catch(exception &e)
+    {
+        PyErr_SetString(librfsimError, e.what());
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+/**
+ * @brief Starts writing the counts at every step to a compressed history file, read with rfsim.history.HistoryReader.
+ * @param self the Python self object
+ * @param args the path of the file
+ * @param kwargs optionally keyframe_interval, the number of frames from one keyframe to the next
+ */
+static PyObject *startHistoryFile(PyLandscape *self, PyObject *args, PyObject *kwargs)
+{
+    if(!checkIdle(self))
+    {
+        return nullptr;
+    }
+    static const char* keywords[] = {"path", "keyframe_interval", nullptr};
+    const char* path;
+    unsigned long keyframe_interval = 64;
+    if(!PyArg_ParseTupleAndKeywords(args, kwargs, "s|k", const_cast<char**>(keywords), &path, &keyframe_interval))
+    {
+        return nullptr;
+    }
+    try
+    {
+        self->landscape->startHistoryFile(path, keyframe_interval);
+    }
+    catch(exception &e)
+    {
+        PyErr_SetString(librfsimError, e.what());
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+/**
+ * @brief Stops writing the history file, once every queued frame has been encoded.
+ * @param self the Python self object
+ * @param args
+ */
+static PyObject *stopHistoryFile(PyLandscape *self, PyObject *args)
+{
+    if(!checkIdle(self))
+    {
+        return nullptr;
+    }
+    try
+    {
+        self->landscape->stopHistoryFile();
+    }
+    catch(exception &e)
+    {
+        PyErr_SetString(librfsimError, e.what());
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+/**
+ * @brief Reads a stopping condition from a dictionary with a kind (extinct, below, above or stable), a total (rabbits,
+ * foxes or animals) and, depending on the kind, a threshold or an epsilon and window.
+ * @param mapping the Python dictionary describing the condition
+ * @param conditions the conditions to append the condition to
+ * @return false, with the Python error set, if the condition could not be read
+ */
+static bool parseStoppingCondition(PyObject* mapping, vector<StoppingCondition> &conditions)
+{
+    if(!PyDict_Check(mapping))
+    {
+        PyErr_SetString(PyExc_TypeError, "each condition must be a dictionary");
+        return false;
+    }
+    PyObject* kind = PyDict_GetItemString(mapping, "kind");
+    PyObject* total = PyDict_GetItemString(mapping, "total");
+    if(kind == nullptr || total == nullptr)
+    {
+        PyErr_SetString(PyExc_KeyError, "each condition needs a kind and a total");
+        return false;
+    }
+    const char* kind_name = PyUnicode_AsUTF8(kind);
+    const char* total_name = PyUnicode_AsUTF8(total);
+    if(kind_name == nullptr || total_name == nullptr)
+    {
+        return false;
+    }
+    try
+    {
+        StoppingCondition::Kind condition_kind = StoppingCondition::parseKind(kind_name);
+        PyObject* threshold = PyDict_GetItemString(mapping, condition_kind == StoppingCondition::Kind::stable ?
+                                                            "epsilon" : "threshold");
+        PyObject* window = PyDict_GetItemString(mapping, "window");
+        double threshold_value = threshold == nullptr ? 0.0 : PyFloat_AsDouble(threshold);
+        unsigned long window_value = window == nullptr ? 1 : PyLong_AsUnsignedLong(window);
+        if(PyErr_Occurred())
+        {
+            return false;
+        }
+        conditions.emplace_back(condition_kind, StoppingCondition::parseQuantity(total_name), threshold_value,
+                                window_value);
+    }
+    catch(exception &e)
+    {
+        PyErr_SetString(librfsimError, e.what());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Iterates until one of the stopping conditions holds, checking them in C++ after every iteration.
+ * @param self the Python self object
+ * @param args the maximum number of iterations and the list of conditions
+ * @return tuple of the number of iterations run and the index of the condition which held, or None
+ */
+static PyObject *runUntil(PyLandscape *self, PyObject *args)
+{
+    if(!checkIdle(self))
+    {
+        return nullptr;
+    }
+    unsigned long max_steps;
+    PyObject* condition_list;
+    if(!PyArg_ParseTuple(args, "kO", &max_steps, &condition_list))
+    {
+        return nullptr;
+    }
+    PyObject* sequence = PySequence_Fast(condition_list, "conditions must be a sequence");
+    if(sequence == nullptr)
+    {
+        return nullptr;
+    }
+    vector<StoppingCondition> conditions;
+    for(Py_ssize_t k = 0; k < PySequence_Fast_GET_SIZE(sequence); k++)
+    {
+        if(!parseStoppingCondition(PySequence_Fast_GET_ITEM(sequence, k), conditions))
+        {
+            Py_DECREF(sequence);
+            return nullptr;
+        }
+    }
+    Py_DECREF(sequence);
+    unsigned long steps;
+    long met;
+    try
+    {
+        steps = self->landscape->runUntil(max_steps, conditions, met);
+    }
+    catch(exception &e)
+    {
+        PyErr_SetString(librfsimError, e.what());
+        return nullptr;
+    }
+    if(met < 0)
+    {
+        return Py_BuildValue("(kO)", steps, Py_None);
+    }
+    return Py_BuildValue("(kl)", steps, met);
+}
+
+/**
+ * @brief Gets the timings and load-balance statistics of the multi-threaded simulation.
+ * @param self the Python self object
+ * @param args
+ * @return dictionary of the profiling results
+ */
+static PyObject *getProfile(PyLandscape *self, PyObject *args)
+{
+    if(!checkIdle(self))
+    {
+        return nullptr;
+    }
+    const LandscapeProfile &profile = self->landscape->getProfile();
+    return Py_BuildValue("{s:d,s:d,s:d,s:d,s:d,s:k}",
+                         "iteration_time", profile.iteration_time,
+                         "task_imbalance", profile.task_imbalance,
+                         "partition_imbalance", profile.partition_imbalance,
+                         "rebalance_time", profile.rebalance_time,
+                         "total_rebalance_time", profile.total_rebalance_time,
+                         "rebalances", profile.rebalances);
+}
+
+/**
+ * @brief Starts iterating the simulation on a native background thread, returning immediately.
+ * @param self the Python self object
+ * @param args the number of iterations to run
+ */
+static PyObject *startBackground(PyLandscape *self, PyObject *args)
+{
+    unsigned long steps;
+    // parse arguments
+    if(!PyArg_ParseTuple(args, "k", &steps))
+    {
+        return nullptr;
+    }
+    if(!checkIdle(self))
+    {
+        return nullptr;
+    }
+    try
+    {
+        self->background.reset();
+        self->background = std::make_unique<BackgroundIteration>(*self->landscape, steps);
+    }
+    catch(exception &e)
+    {
+        PyErr_SetString(librfsimError, e.what());
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+/**
+ * @brief Gets the progress of the background run.
+ * @param self the Python self object
+ * @param args
+ * @return tuple of the number of iterations completed and the number requested, or (0, 0) if start() has not been
+ * called
+ */
+static PyObject *getProgress(PyLandscape *self, PyObject *args)
+{
+    if(self->background == nullptr)
+    {
+        return Py_BuildValue("(kk)", 0ul, 0ul);
+    }
+    return Py_BuildValue("(kk)", self->background->getCompleted(), self->background->getTotal());
+}
+
+/**
+ * @brief Waits for the background run to finish, with the GIL released.
+ * @param self the Python self object
+ * @param args optionally, the maximum number of seconds to wait (None waits indefinitely)
+ * @return True if the run has finished (or none was started), False if the timeout expired; raises if the run failed
+ */
+static PyObject *waitBackground(PyLandscape *self, PyObject *args)
+{
+    PyObject* py_timeout = Py_None;
+    // parse arguments
+    if(!PyArg_ParseTuple(args, "|O", &py_timeout))
+    {
+        return nullptr;
+    }
+    double timeout = -1.0;
+    if(py_timeout != Py_None)
+    {
+        timeout = PyFloat_AsDouble(py_timeout);
+        if(PyErr_Occurred())
+        {
+            return nullptr;
+        }
+    }
+    if(self->background == nullptr)
+    {
+        Py_RETURN_TRUE;
+    }
+    // Wait in short slices so that KeyboardInterrupt and other signals are still handled.
+    const double slice = 0.1;
+    bool finished = false;
+    while(!finished)
+    {
+        double wait_time = timeout < 0 ? slice : std::min(timeout, slice);
+        BackgroundIteration* background = self->background.get();
+        Py_BEGIN_ALLOW_THREADS
+        finished = background->wait(wait_time);
+        Py_END_ALLOW_THREADS
+        if(timeout >= 0)
+        {
+            timeout -= wait_time;
+            if(timeout <= 0)
+            {
+                break;
+            }
+        }
+        if(!finished && PyErr_CheckSignals() != 0)
+        {
+            return nullptr;
+        }
+    }
+    if(!finished)
+    {
+        Py_RETURN_FALSE;
+    }
+    try
+    {
+        self->background->rethrowError();
+    }
+    catch(exception &e)
+    {
+        PyErr_SetString(librfsimError, e.what());
+        return nullptr;
+    }
+    Py_RETURN_TRUE;
+}
+
+/**
+ * @brief Asks the background run to stop at the end of its current iteration, without waiting for it.
+ * @param self the Python self object
+ * @param args
+ */
+static PyObject *cancelBackground(PyLandscape *self, PyObject *args)
+{
+    if(self->background != nullptr)
+    {
+        self->background->cancel();
+    }
+    Py_RETURN_NONE;
+}
+
+/**
+ * @brief Checks whether the landscape is being iterated in the background.
+ * @param self the Python self object
+ * @param args
+ * @return True if a background run has not yet finished
+ */
+static PyObject *isRunning(PyLandscape *self, PyObject *args)
+{
+    if(self->background != nullptr && !self->background->isFinished())
+    {
+        Py_RETURN_TRUE;
+    }
+    Py_RETURN_FALSE;
+}
+
 /**
  * @brief Generates the object methods for python.
  * @return the method definition
@@ -245,12 +1265,62 @@ static PyMethodDef *genPyLandscapeMethods()
     static PyMethodDef PyLandscapeMethods[] = {
             {"iterate",     (PyCFunction) iterate,         METH_VARARGS,
                     "Run the simulation"},
-            {"get_rabbits", (PyCFunction) getRabbitsArray, METH_VARARGS,
-                    "Get the array of rabbits"},
-            {"get_foxes",   (PyCFunction) getFoxesArray,   METH_VARARGS,
-                    "Get the array of foxes"},
+            {"get_rabbits", (PyCFunction) getRabbitsArray, METH_VARARGS | METH_KEYWORDS,
+                    "Get the array of rabbits, or with level=k the sums (or with mean=True the means) over 2^k blocks"},
+            {"get_foxes",   (PyCFunction) getFoxesArray,   METH_VARARGS | METH_KEYWORDS,
+                    "Get the array of foxes, or with level=k the sums (or with mean=True the means) over 2^k blocks"},
+            {"get_grass",   (PyCFunction) getGrassArray,   METH_VARARGS | METH_KEYWORDS,
+                    "Get the array of grass, or with level=k the sums (or with mean=True the means) over 2^k blocks"},
             {"setup",       (PyCFunction) setup,           METH_VARARGS,
                     "Set up the simulation."},
+            {"set_threads", (PyCFunction) setThreads,      METH_VARARGS,
+                    "Run the simulation on the given number of threads, with an optional grain size for each task."},
+            {"set_partitioning", (PyCFunction) setPartitioning, METH_VARARGS,
+                    "Partition the landscape into one block per thread, rebalanced every n iterations."},
+            {"set_double_buffered", (PyCFunction) setDoubleBuffered, METH_VARARGS,
+                    "Read each iteration from the current generation and write to the next, swapping them after."},
+            {"set_numa_placement", (PyCFunction) setNumaPlacement, METH_VARARGS,
+                    "Pin threads and initialise each tile's memory on its owning thread. Call before setup()."},
+            {"set_parameters", (PyCFunction) setParameters, METH_VARARGS | METH_KEYWORDS,
+                    "Set model parameters by name, e.g. grass_growth, move_probability."},
+            {"totals",      (PyCFunction) getTotals,       METH_NOARGS,
+                    "Get the total populations and grass, and the births, deaths, predation and migrations of the "
+                    "last iteration."},
+            {"history",     (PyCFunction) getHistory,      METH_NOARGS,
+                    "Get arrays of the totals at the start and after every iteration."},
+            {"set_summed_area_tables", (PyCFunction) setSummedAreaTables, METH_VARARGS,
+                    "Rebuild the summed-area tables after every iteration, rather than when next queried."},
+            {"region_sums", (PyCFunction) getRegionSums,   METH_VARARGS,
+                    "Sum the rabbits, foxes and grass within each (row_start, col_start, row_end, col_end) rectangle."},
+            {"spatial_statistics", (PyCFunction) getSpatialStatistics, METH_VARARGS,
+                    "Compute the semivariance, pair correlation and Moran's I of a grid in each distance bin."},
+            {"morans_i",    (PyCFunction) getMoransI,      METH_VARARGS,
+                    "Compute Moran's I of a grid, with cells within max_distance (default 1) as neighbours."},
+            {"get_changes", (PyCFunction) getChanges,      METH_VARARGS | METH_KEYWORDS,
+                    "Get the cells whose populations (or, with grass=True, grass) changed since the token from an "
+                    "earlier call, and the token for the next call."},
+            {"start_npy_output", (PyCFunction) startNpyOutput, METH_VARARGS,
+                    "Write the counts at every step to a growing .npy file, which np.load(mmap_mode='r') can read live."},
+            {"stop_npy_output", (PyCFunction) stopNpyOutput, METH_NOARGS,
+                    "Stop writing the .npy time series, truncating the file to the steps written."},
+            {"start_history_file", (PyCFunction) startHistoryFile, METH_VARARGS | METH_KEYWORDS,
+                    "Write the counts at every step to a compressed, seekable history file, encoded in the background."},
+            {"stop_history_file", (PyCFunction) stopHistoryFile, METH_NOARGS,
+                    "Finish encoding the history file, write its index and close it."},
+            {"run_until",   (PyCFunction) runUntil,        METH_VARARGS,
+                    "Iterate up to max_steps times, stopping early once one of the conditions holds."},
+            {"start",       (PyCFunction) startBackground, METH_VARARGS,
+                    "Start running n iterations on a background thread, returning immediately."},
+            {"progress",    (PyCFunction) getProgress,     METH_NOARGS,
+                    "Get the (completed, total) iterations of the background run."},
+            {"wait",        (PyCFunction) waitBackground,  METH_VARARGS,
+                    "Wait up to timeout seconds for the background run, returning True once it has finished."},
+            {"cancel",      (PyCFunction) cancelBackground, METH_NOARGS,
+                    "Stop the background run at the end of its current iteration."},
+            {"running",     (PyCFunction) isRunning,       METH_NOARGS,
+                    "Check whether a background run is still going."},
+            {"profile",     (PyCFunction) getProfile,      METH_NOARGS,
+                    "Get the timings and load-balance statistics of the simulation."},
             {nullptr}  /* Sentinel */
     };
     return PyLandscapeMethods;
@@ -214,6 +214,24 @@ public:
         seeded = false;
     }
 
+    /**
+     * @brief Reseeds the generator to the start of one of many independent streams derived from the seed.
+     * @details Used to give each cell its own random numbers, so that parallel results do not depend on which thread
+     * processes which cell.
+     * @param seed the simulation seed
+     * @param stream the stream number
+     */
+    void setStream(uint64_t seed, uint64_t stream)
+    {
+        // The stream is offset from a hash of the seed, rather than combined symmetrically with it, so that seed a's
+        // stream b differs from seed b's stream a.
+        SplitMix64 seed_generator(seed);
+        SplitMix64 stream_generator(seed_generator.next() + stream);
+        Xoroshiro256plus::setSeed(stream_generator.next());
+        this->seed = seed;
+        seeded = true;
+    }
+
     /**
      * @brief Generates a random number uniformly from 0 to the maximum value provided.
      * @param max the maximum number.
@@ -16,9 +16,9 @@ void Rabbit::eatGrass(const double &grass_amount)
     energy += eaten_amount;
 }
 
-bool Rabbit::canReproduce()
+bool Rabbit::canReproduce(const ModelParameters &parameters)
 {
-    if(energy > 10 && !oldAge())
+    if(energy > parameters.rabbit_reproduction_threshold && !oldAge())
     {
         energy -= 5;
         return true;
@@ -42,3 +42,68 @@ void Rabbit::kill()
     age = 100;
     energy = 0;
 }
+
+double Rabbit::grazePopulation(Rabbit* rabbits, unsigned long num_rabbits, double grass_amount)
+{
+    if(!isExact(grass_amount))
+    {
+        for(unsigned long i = 0; i < num_rabbits; i++)
+        {
+            if(grass_amount > 1.0)
+            {
+                rabbits[i].eatGrass(grass_amount);
+                grass_amount -= 30;
+            }
+            rabbits[i].exist();
+        }
+        return grass_amount;
+    }
+    unsigned long num_feeding = min(num_rabbits, countSubtractions(grass_amount, 1.0, 30.0));
+    // Feeding and existing are applied in a single pass, so large populations are only read from memory once.
+    // All but the last feeding rabbit always find a full 30 grass.
+    for(unsigned long i = 0; i + 1 < num_feeding; i++)
+    {
+        rabbits[i].energy += 30.0;
+        rabbits[i].energy -= 5;
+        rabbits[i].age += 1;
+    }
+    if(num_feeding > 0)
+    {
+        Rabbit &last = rabbits[num_feeding - 1];
+        last.energy += min(grass_amount - 30.0 * (num_feeding - 1), 30.0);
+        last.energy -= 5;
+        last.age += 1;
+    }
+    for(unsigned long i = num_feeding; i < num_rabbits; i++)
+    {
+        rabbits[i].energy -= 5;
+        rabbits[i].age += 1;
+    }
+    return grass_amount - 30.0 * num_feeding;
+}
+
+unsigned long Rabbit::reproducePopulation(Rabbit* rabbits, unsigned long num_rabbits,
+                                         const ModelParameters &parameters)
+{
+    unsigned long total = 0;
+    for(unsigned long i = 0; i < num_rabbits; i++)
+    {
+        Rabbit &rabbit = rabbits[i];
+        if(rabbit.Rabbit::oldAge())
+        {
+            continue;
+        }
+        if(!isExact(rabbit.energy) || !isExact(parameters.rabbit_reproduction_threshold))
+        {
+            while(rabbit.canReproduce(parameters))
+            {
+                total++;
+            }
+            continue;
+        }
+        unsigned long offspring = countSubtractions(rabbit.energy, parameters.rabbit_reproduction_threshold, 5.0);
+        rabbit.energy -= 5.0 * offspring;
+        total += offspring;
+    }
+    return total;
+}
@@ -6,6 +6,7 @@
 #define LIB_ANIMAL_H
 
 #include "Animal.h"
+#include "SmallVector.h"
 
 /**
  * @brief Contains the behaviours of a rabbit
@@ -28,9 +29,10 @@ public:
 
     /**
      * @brief Check if the rabbit can reproduce
+     * @param parameters the model parameters, giving the energy needed to reproduce
      * @return true if the rabbit reproduces
      */
-    bool canReproduce();
+    bool canReproduce(const ModelParameters &parameters);
 
     /**
      * @brief The painful process of existence costs energy.
@@ -48,6 +50,35 @@ public:
      */
     void kill();
 
+    /**
+     * @brief Feeds a population of rabbits in order from the grass available, and applies the cost of existence.
+     * @details Gives bitwise-identical results to calling eatGrass() and exist() on each rabbit in turn, while
+     * reducing the grass by 30 per feeding rabbit, but computes the number of rabbits which feed in closed form.
+     * @param rabbits pointer to the first rabbit
+     * @param num_rabbits the number of rabbits
+     * @param grass_amount the grass available
+     * @return the grass remaining after feeding
+     */
+    static double grazePopulation(Rabbit* rabbits, unsigned long num_rabbits, double grass_amount);
+
+    /**
+     * @brief Deducts the reproduction cost from each rabbit for every offspring it can produce.
+     * @details Gives bitwise-identical results to calling canReproduce() on each rabbit until it returns false, but
+     * computes the number of offspring per rabbit in closed form.
+     * @param rabbits pointer to the first rabbit
+     * @param num_rabbits the number of rabbits
+     * @param parameters the model parameters, giving the energy needed to reproduce
+     * @return the total number of offspring produced
+     */
+    static unsigned long reproducePopulation(Rabbit* rabbits, unsigned long num_rabbits,
+                                             const ModelParameters &parameters);
+
 };
 
+/**
+ * @brief The rabbits within a single cell. Cells hold hundreds of rabbits from the first few steps, so none are stored
+ * inline, where the space would only be dead weight once they spilled to the heap.
+ */
+typedef SmallVector<Rabbit, 0> RabbitPopulation;
+
 #endif //LIB_ANIMAL_H
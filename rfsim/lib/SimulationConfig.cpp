@@ -0,0 +1,223 @@
+/**
+ * @brief Contains the configuration of a single simulation run, as read from a config file or a job request.
+ */
+
+#include <sstream>
+#include <stdexcept>
+#include "SimulationConfig.h"
+
+namespace
+{
+    /**
+     * @brief Parses a whole non-negative integer.
+     * @param key the name of the setting, for the error message
+     * @param value the text to parse
+     * @return the integer
+     */
+    unsigned long parseUnsigned(const std::string &key, const std::string &value)
+    {
+        std::size_t end = 0;
+        unsigned long result = 0;
+        try
+        {
+            result = std::stoul(value, &end);
+        }
+        catch(std::exception &)
+        {
+            end = 0;
+        }
+        if(end == 0 || end != value.size() || value[0] == '-')
+        {
+            throw std::invalid_argument("Invalid value for " + key + ": " + value);
+        }
+        return result;
+    }
+
+    /**
+     * @brief Parses a real number.
+     * @param key the name of the setting, for the error message
+     * @param value the text to parse
+     * @return the number
+     */
+    double parseDouble(const std::string &key, const std::string &value)
+    {
+        std::size_t end = 0;
+        double result = 0.0;
+        try
+        {
+            result = std::stod(value, &end);
+        }
+        catch(std::exception &)
+        {
+            end = 0;
+        }
+        if(end == 0 || end != value.size())
+        {
+            throw std::invalid_argument("Invalid value for " + key + ": " + value);
+        }
+        return result;
+    }
+
+    /**
+     * @brief Parses a boolean, given as true/false, yes/no, on/off or 1/0.
+     * @param key the name of the setting, for the error message
+     * @param value the text to parse
+     * @return the boolean
+     */
+    bool parseBool(const std::string &key, const std::string &value)
+    {
+        if(value == "true" || value == "yes" || value == "on" || value == "1")
+        {
+            return true;
+        }
+        if(value == "false" || value == "no" || value == "off" || value == "0")
+        {
+            return false;
+        }
+        throw std::invalid_argument("Invalid value for " + key + ": " + value);
+    }
+
+    /**
+     * @brief Removes leading and trailing whitespace.
+     * @param text the text to trim
+     * @return the trimmed text
+     */
+    std::string trim(const std::string &text)
+    {
+        const char* whitespace = " \t\r\n";
+        std::size_t first = text.find_first_not_of(whitespace);
+        if(first == std::string::npos)
+        {
+            return "";
+        }
+        return text.substr(first, text.find_last_not_of(whitespace) - first + 1);
+    }
+}
+
+void SimulationConfig::set(const std::string &key, const std::string &value)
+{
+    if(key == "x")
+    {
+        x_size = parseUnsigned(key, value);
+    }
+    else if(key == "y")
+    {
+        y_size = parseUnsigned(key, value);
+    }
+    else if(key == "seed")
+    {
+        seed = parseUnsigned(key, value);
+    }
+    else if(key == "steps")
+    {
+        steps = parseUnsigned(key, value);
+    }
+    else if(key == "threads")
+    {
+        threads = parseUnsigned(key, value);
+    }
+    else if(key == "grain")
+    {
+        grain_size = parseUnsigned(key, value);
+    }
+    else if(key == "partitioning")
+    {
+        partitioning = parseUnsigned(key, value);
+    }
+    else if(key == "double_buffered")
+    {
+        double_buffered = parseBool(key, value);
+    }
+    else if(key == "numa_placement")
+    {
+        numa_placement = parseBool(key, value);
+    }
+    else if(key == "format")
+    {
+        format = value;
+    }
+    else if(key == "keyframe_interval")
+    {
+        keyframe_interval = parseUnsigned(key, value);
+    }
+    else if(key == "output_file")
+    {
+        output_file = value;
+    }
+    else
+    {
+        parameters.set(key, parseDouble(key, value));
+    }
+}
+
+void SimulationConfig::load(std::istream &stream)
+{
+    std::string line;
+    unsigned long line_number = 0;
+    while(std::getline(stream, line))
+    {
+        line_number++;
+        line = trim(line.substr(0, line.find('#')));
+        if(line.empty())
+        {
+            continue;
+        }
+        std::size_t separator = line.find('=');
+        try
+        {
+            if(separator == std::string::npos)
+            {
+                throw std::invalid_argument("expected key = value");
+            }
+            set(trim(line.substr(0, separator)), trim(line.substr(separator + 1)));
+        }
+        catch(std::invalid_argument &e)
+        {
+            std::stringstream message;
+            message << "Line " << line_number << ": " << e.what();
+            throw std::invalid_argument(message.str());
+        }
+    }
+}
+
+void SimulationConfig::validate() const
+{
+    if(x_size == 0 || y_size == 0)
+    {
+        throw std::invalid_argument("The landscape must have at least one cell.");
+    }
+    if(threads == 0)
+    {
+        throw std::invalid_argument("Number of threads must be at least 1.");
+    }
+    if(format != "csv" && format != "totals" && format != "npy" && format != "npy_series" &&
+       format != "history")
+    {
+        throw std::invalid_argument("Unknown output format: " + format);
+    }
+    if((format == "npy_series" || format == "history") && output_file == "-")
+    {
+        throw std::invalid_argument("The " + format + " format must be written to an output file.");
+    }
+    parameters.validate();
+}
+
+bool SimulationConfig::isParallel() const
+{
+    return threads > 1 || partitioning > 0 || double_buffered || numa_placement;
+}
+
+void SimulationConfig::configure(Landscape &landscape) const
+{
+    validate();
+    landscape.setSeed(seed);
+    landscape.setParameters(parameters);
+    if(isParallel())
+    {
+        landscape.setThreads(threads, grain_size);
+        landscape.setPartitioning(partitioning);
+        landscape.setDoubleBuffered(double_buffered);
+        landscape.setNumaPlacement(numa_placement);
+    }
+    landscape.setLandscapeSize(x_size, y_size);
+}
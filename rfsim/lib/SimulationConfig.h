@@ -0,0 +1,79 @@
+/**
+ * @brief Contains the configuration of a single simulation run, as read from a config file or a job request.
+ */
+
+#ifndef LIB_SIMULATIONCONFIG_H
+#define LIB_SIMULATIONCONFIG_H
+
+#include <istream>
+#include <string>
+#include "Landscape.h"
+#include "ModelParameters.h"
+
+/**
+ * @brief The settings of a single simulation run.
+ *
+ * @details Settings are given as key-value pairs, where the keys are the names of the members below (x, y, seed,
+ * steps, threads, grain, partitioning, double_buffered, numa_placement, format, keyframe_interval and output_file) or of a
+ * ModelParameters member. Runs with one thread and no partitioning, double-buffering or NUMA placement use the
+ * single-threaded update, exactly as a CLandscape does; otherwise each cell draws from its own random number stream.
+ */
+struct SimulationConfig
+{
+    unsigned long x_size = 10;
+    unsigned long y_size = 10;
+    unsigned long seed = 1;
+    unsigned long steps = 1;
+    unsigned long threads = 1;
+    unsigned long grain_size = 4096;
+    // The number of iterations between rebalances of a partitioned landscape, or 0 for work stealing
+    unsigned long partitioning = 0;
+    bool double_buffered = false;
+    bool numa_placement = false;
+    // How the results are written: csv (the final counts of each cell), totals (the total counts after each step),
+    // npy (the final counts as an int32 array of shape (2, y, x), rabbits then foxes), npy_series (the counts at the
+    // start and after each step, as a memory-mapped int32 array of shape (steps + 1, 2, y, x) readable during the run)
+    // or history (the same counts in a compressed history file, read with rfsim.history.HistoryReader)
+    std::string format = "csv";
+    // The number of frames from one keyframe to the next in a history file
+    unsigned long keyframe_interval = 64;
+    // The file to write the results to, or - for standard output
+    std::string output_file = "-";
+    ModelParameters parameters;
+
+    /**
+     * @brief Sets a single setting.
+     * @param key the name of the setting
+     * @param value the value, as text
+     * @throws std::invalid_argument if the key is unknown or the value cannot be parsed
+     */
+    void set(const std::string &key, const std::string &value);
+
+    /**
+     * @brief Reads settings from a config file, one "key = value" pair per line. Blank lines and anything after a #
+     * are ignored.
+     * @param stream the config file
+     * @throws std::invalid_argument, naming the line, if any line cannot be read
+     */
+    void load(std::istream &stream);
+
+    /**
+     * @brief Checks that the settings are usable.
+     * @throws std::invalid_argument if any setting is out of range
+     */
+    void validate() const;
+
+    /**
+     * @brief Checks whether the run uses the multi-threaded update.
+     * @return true if each cell draws from its own random number stream
+     */
+    bool isParallel() const;
+
+    /**
+     * @brief Sets up the landscape for the run, ready to iterate.
+     * @param landscape a newly constructed landscape
+     */
+    void configure(Landscape &landscape) const;
+};
+
+#endif //LIB_SIMULATIONCONFIG_H
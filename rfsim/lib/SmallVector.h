@@ -0,0 +1,511 @@
+/**
+ * @brief Contains a small-buffer-optimised vector for storing the animals within a single cell.
+ */
+
+#ifndef LIB_SMALLVECTOR_H
+#define LIB_SMALLVECTOR_H
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include "PopulationArena.h"
+
+/**
+ * @brief Uninitialised storage for the elements a SmallVector holds inline.
+ * @tparam T the type of the elements
+ * @tparam N the number of elements
+ */
+template<class T, unsigned long N>
+class InlineBuffer
+{
+protected:
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type items[N];
+
+public:
+    T* inlineData()
+    {
+        return reinterpret_cast<T*>(items);
+    }
+
+    const T* inlineData() const
+    {
+        return reinterpret_cast<const T*>(items);
+    }
+};
+
+/**
+ * @brief Without an inline buffer, the storage of an empty container is null. The class is empty, so takes no space
+ * as a base class.
+ */
+template<class T>
+class InlineBuffer<T, 0>
+{
+public:
+    T* inlineData()
+    {
+        return nullptr;
+    }
+
+    const T* inlineData() const
+    {
+        return nullptr;
+    }
+};
+
+/**
+ * @brief A contiguous container which stores up to N elements inline, only moving to the heap once that capacity is
+ * exceeded.
+ *
+ * @details Elements are held in the range [head, head + count) of the storage, so that elements can be dropped from
+ * the front in O(1) by advancing the head, as in a ring buffer. The free space in front of the head is reclaimed the
+ * next time the container would otherwise need to grow. Iterators are plain pointers, so the container can be used
+ * with the standard algorithms (e.g. std::remove_if).
+ *
+ * Heap storage is taken from the PopulationArena provided by setArena(), or from the system allocator if no arena has
+ * been set.
+ *
+ * Each inline element adds its full size to the container whether or not it is used, so N should only cover the
+ * occupancy actually seen in sparse cells. With N of 0 the container is a plain heap vector of five words.
+ * @tparam T the type of the elements
+ * @tparam N the number of elements stored inline
+ */
+template<class T, unsigned long N>
+class SmallVector : protected InlineBuffer<T, N>
+{
+protected:
+    // The smallest heap allocation, so that a container without an inline buffer does not grow one element at a time
+    static const unsigned long min_heap_capacity = N > 0 ? N * 2 : 4;
+    T* storage;
+    unsigned long capacity;
+    unsigned long head;
+    unsigned long count;
+    PopulationArena* arena;
+
+    /**
+     * @brief Checks if the elements are currently held in the inline buffer.
+     * @return true if no heap storage is in use
+     */
+    bool isInline() const
+    {
+        return storage == this->inlineData();
+    }
+
+    /**
+     * @brief Moves the live elements to the start of the new storage, releasing the old storage if required.
+     * @param new_storage the storage to move to
+     * @param new_capacity the capacity of the new storage
+     */
+    void relocate(T* new_storage, unsigned long new_capacity)
+    {
+        T* first = begin();
+        for(unsigned long i = 0; i < count; i++)
+        {
+            new(new_storage + i) T(std::move(first[i]));
+            first[i].T::~T();
+        }
+        releaseStorage();
+        storage = new_storage;
+        capacity = new_capacity;
+        head = 0;
+    }
+
+    /**
+     * @brief Makes space for at least one more element at the back of the container.
+     */
+    void makeSpace()
+    {
+        if(head + count < capacity)
+        {
+            return;
+        }
+        if(head > 0)
+        {
+            // Reclaim the space freed by dropFront() before growing.
+            T* first = begin();
+            for(unsigned long i = 0; i < count; i++)
+            {
+                new(storage + i) T(std::move(first[i]));
+                first[i].T::~T();
+            }
+            head = 0;
+            return;
+        }
+        reserve(std::max(capacity * 2, min_heap_capacity));
+    }
+
+    /**
+     * @brief Frees the heap storage, if any is in use.
+     */
+    void releaseStorage()
+    {
+        if(!isInline())
+        {
+            if(arena != nullptr)
+            {
+                arena->deallocate(storage, capacity * sizeof(T));
+            }
+            else
+            {
+                std::free(storage);
+            }
+        }
+    }
+
+    /**
+     * @brief Allocates heap storage for the given number of elements.
+     * @param new_capacity the number of elements, which is increased to use any space left by rounding
+     * @return the new storage
+     */
+    T* allocateStorage(unsigned long &new_capacity)
+    {
+        void* ptr;
+        if(arena != nullptr)
+        {
+            new_capacity = PopulationArena::roundSize(new_capacity * sizeof(T)) / sizeof(T);
+            ptr = arena->allocate(new_capacity * sizeof(T));
+        }
+        else
+        {
+            ptr = std::malloc(new_capacity * sizeof(T));
+        }
+        if(ptr == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(ptr);
+    }
+
+public:
+
+    static_assert(alignof(T) <= alignof(std::max_align_t), "SmallVector heap storage is not aligned for T.");
+
+    SmallVector() : InlineBuffer<T, N>(), storage(this->inlineData()), capacity(N), head(0), count(0), arena(nullptr)
+    {
+    }
+
+    /**
+     * @brief Constructs the container with the given number of default-constructed elements.
+     * @param size the number of elements to construct
+     */
+    explicit SmallVector(unsigned long size) : SmallVector()
+    {
+        reserve(size);
+        for(unsigned long i = 0; i < size; i++)
+        {
+            new(storage + i) T();
+        }
+        count = size;
+    }
+
+    SmallVector(const SmallVector &other) : SmallVector()
+    {
+        reserve(other.size());
+        for(const auto &item : other)
+        {
+            new(storage + count) T(item);
+            count++;
+        }
+    }
+
+    SmallVector(SmallVector &&other) noexcept : SmallVector()
+    {
+        arena = other.arena;
+        swap(other);
+    }
+
+    ~SmallVector()
+    {
+        // Storage in an arena which is being released is freed wholesale with the arena, so neither the elements nor
+        // the storage need to be individually released.
+        if(isInline() || arena == nullptr || !arena->isReleasing())
+        {
+            clear();
+            releaseStorage();
+        }
+    }
+
+    SmallVector &operator=(const SmallVector &other)
+    {
+        if(this != &other)
+        {
+            clear();
+            reserve(other.size());
+            for(const auto &item : other)
+            {
+                new(storage + count) T(item);
+                count++;
+            }
+        }
+        return *this;
+    }
+
+    SmallVector &operator=(SmallVector &&other) noexcept
+    {
+        if(this != &other)
+        {
+            clear();
+            swap(other);
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Swaps the contents of the two containers.
+     * @details Heap storage is exchanged in O(1); inline elements are moved between the buffers.
+     * @param other the container to swap with
+     */
+    void swap(SmallVector &other) noexcept
+    {
+        if(!isInline() || !other.isInline())
+        {
+            // Heap storage always stays with the arena it was allocated from.
+            std::swap(arena, other.arena);
+        }
+        if(!isInline() && !other.isInline())
+        {
+            std::swap(storage, other.storage);
+            std::swap(capacity, other.capacity);
+            std::swap(head, other.head);
+            std::swap(count, other.count);
+            return;
+        }
+        SmallVector &small = isInline() ? *this : other;
+        SmallVector &large = isInline() ? other : *this;
+        // Move the small container's inline elements into the scratch space, then hand it the other's storage.
+        T* tmp_storage = large.storage;
+        unsigned long tmp_capacity = large.capacity;
+        unsigned long tmp_head = large.head;
+        unsigned long tmp_count = large.count;
+        bool large_inline = large.isInline();
+        InlineBuffer<T, N> scratch;
+        T* scratch_ptr = scratch.inlineData();
+        for(unsigned long i = 0; i < small.count; i++)
+        {
+            new(scratch_ptr + i) T(std::move(small.begin()[i]));
+            small.begin()[i].T::~T();
+        }
+        unsigned long small_count = small.count;
+        if(large_inline)
+        {
+            for(unsigned long i = 0; i < tmp_count; i++)
+            {
+                new(small.storage + i) T(std::move(tmp_storage[tmp_head + i]));
+                tmp_storage[tmp_head + i].T::~T();
+            }
+            small.head = 0;
+        }
+        else
+        {
+            small.storage = tmp_storage;
+            small.capacity = tmp_capacity;
+            small.head = tmp_head;
+            large.storage = large.inlineData();
+            large.capacity = N;
+        }
+        small.count = tmp_count;
+        for(unsigned long i = 0; i < small_count; i++)
+        {
+            new(large.storage + i) T(std::move(scratch_ptr[i]));
+            scratch_ptr[i].T::~T();
+        }
+        large.head = 0;
+        large.count = small_count;
+    }
+
+    T* begin()
+    {
+        return storage + head;
+    }
+
+    T* end()
+    {
+        return storage + head + count;
+    }
+
+    const T* begin() const
+    {
+        return storage + head;
+    }
+
+    const T* end() const
+    {
+        return storage + head + count;
+    }
+
+    T &operator[](unsigned long index)
+    {
+        return storage[head + index];
+    }
+
+    const T &operator[](unsigned long index) const
+    {
+        return storage[head + index];
+    }
+
+    T &back()
+    {
+        return storage[head + count - 1];
+    }
+
+    unsigned long size() const
+    {
+        return count;
+    }
+
+    bool empty() const
+    {
+        return count == 0;
+    }
+
+    /**
+     * @brief Gets the number of elements which can be stored without reallocating.
+     * @return the capacity
+     */
+    unsigned long getCapacity() const
+    {
+        return capacity;
+    }
+
+    /**
+     * @brief Ensures the container can hold at least the given number of elements.
+     * @param new_capacity the number of elements to make space for
+     */
+    void reserve(unsigned long new_capacity)
+    {
+        if(new_capacity <= capacity - head)
+        {
+            return;
+        }
+        new_capacity = std::max(new_capacity, min_heap_capacity);
+        T* new_storage = allocateStorage(new_capacity);
+        relocate(new_storage, new_capacity);
+    }
+
+    /**
+     * @brief Sets the arena to take heap storage from, moving any existing heap-allocated elements into it.
+     * @details The elements are packed as tightly as possible, moving back to the inline buffer if they fit, so this
+     * can also be used to compact the container.
+     * @param new_arena the arena to use, or nullptr to use the system allocator
+     */
+    void setArena(PopulationArena* new_arena)
+    {
+        if(isInline())
+        {
+            arena = new_arena;
+            return;
+        }
+        T* old_storage = storage;
+        unsigned long old_capacity = capacity;
+        PopulationArena* old_arena = arena;
+        T* first = begin();
+        arena = new_arena;
+        unsigned long new_capacity = N;
+        if(count > N)
+        {
+            new_capacity = count;
+            storage = allocateStorage(new_capacity);
+        }
+        else
+        {
+            storage = this->inlineData();
+        }
+        for(unsigned long i = 0; i < count; i++)
+        {
+            new(storage + i) T(std::move(first[i]));
+            first[i].T::~T();
+        }
+        capacity = new_capacity;
+        head = 0;
+        if(old_arena != nullptr)
+        {
+            old_arena->deallocate(old_storage, old_capacity * sizeof(T));
+        }
+        else
+        {
+            std::free(old_storage);
+        }
+    }
+
+    /**
+     * @brief Gets the arena which heap storage is taken from.
+     * @return the arena, or nullptr if the system allocator is used
+     */
+    PopulationArena* getArena() const
+    {
+        return arena;
+    }
+
+    void push_back(const T &value)
+    {
+        makeSpace();
+        new(end()) T(value);
+        count++;
+    }
+
+    template<class... Args>
+    void emplace_back(Args &&... args)
+    {
+        makeSpace();
+        new(end()) T(std::forward<Args>(args)...);
+        count++;
+    }
+
+    /**
+     * @brief Removes the elements in the range [first, last), moving subsequent elements down.
+     * @param first the first element to remove
+     * @param last one past the last element to remove
+     * @return pointer to the element following the removed range
+     */
+    T* erase(T* first, T* last)
+    {
+        if(first == begin())
+        {
+            dropFront(static_cast<unsigned long>(last - first));
+            return begin();
+        }
+        T* new_end = std::move(last, end(), first);
+        for(T* it = new_end; it != end(); ++it)
+        {
+            it->T::~T();
+        }
+        count -= static_cast<unsigned long>(last - first);
+        return first;
+    }
+
+    /**
+     * @brief Removes the first n elements in O(n) destructor calls and without moving any other elements.
+     * @param n the number of elements to remove from the front
+     */
+    void dropFront(unsigned long n)
+    {
+        n = std::min(n, count);
+        T* first = begin();
+        for(unsigned long i = 0; i < n; i++)
+        {
+            first[i].T::~T();
+        }
+        count -= n;
+        head = count == 0 ? 0 : head + n;
+    }
+
+    /**
+     * @brief Removes all elements, keeping any allocated storage.
+     */
+    void clear()
+    {
+        for(auto &item : *this)
+        {
+            item.T::~T();
+        }
+        head = 0;
+        count = 0;
+    }
+};
+
+template<class T, unsigned long N>
+const unsigned long SmallVector<T, N>::min_heap_capacity;
+
+#endif //LIB_SMALLVECTOR_H
@@ -0,0 +1,178 @@
+/**
+ * @brief Contains the spatial statistics kernels, computed over the landscape's grids without exporting them.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include "SpatialStatistics.h"
+
+namespace
+{
+    /**
+     * @brief The offset from one cell of a pair to the other, and the distance bin it falls in.
+     */
+    struct Offset
+    {
+        long row;
+        long col;
+        unsigned long bin;
+    };
+
+    // The number of independent partial sums in the inner loop, which the compiler can keep in vector registers
+    const unsigned long lanes = 4;
+
+    /**
+     * @brief Accumulates the sums over every pair of cells in a row at the given column offset.
+     * @param a the first cell of each pair
+     * @param b the second cell of each pair
+     * @param n the number of pairs
+     * @param mean the mean of the grid
+     * @param sums the sum of products of deviations from the mean, of squared differences and of products, added to
+     */
+    void accumulatePairs(const double* a, const double* b, unsigned long n, double mean, double* sums)
+    {
+        double deviation[lanes] = {0.0};
+        double squared[lanes] = {0.0};
+        double product[lanes] = {0.0};
+        unsigned long j = 0;
+        for(; j + lanes <= n; j += lanes)
+        {
+            for(unsigned long lane = 0; lane < lanes; lane++)
+            {
+                const double x = a[j + lane];
+                const double y = b[j + lane];
+                deviation[lane] += (x - mean) * (y - mean);
+                squared[lane] += (x - y) * (x - y);
+                product[lane] += x * y;
+            }
+        }
+        for(; j < n; j++)
+        {
+            deviation[0] += (a[j] - mean) * (b[j] - mean);
+            squared[0] += (a[j] - b[j]) * (a[j] - b[j]);
+            product[0] += a[j] * b[j];
+        }
+        for(unsigned long lane = 0; lane < lanes; lane++)
+        {
+            sums[0] += deviation[lane];
+            sums[1] += squared[lane];
+            sums[2] += product[lane];
+        }
+    }
+}
+
+DistanceStatistics SpatialStatistics::compute(const double* values, unsigned long rows, unsigned long cols,
+                                              const std::vector<double> &edges, const ParallelFor &parallel_for,
+                                              unsigned long num_tasks)
+{
+    if(edges.size() < 2 || !(edges[0] >= 0.0) || !std::isfinite(edges.back()))
+    {
+        throw std::invalid_argument("Distance bins need at least two finite, non-negative edges.");
+    }
+    for(unsigned long k = 1; k < edges.size(); k++)
+    {
+        if(!(edges[k] > edges[k - 1]))
+        {
+            throw std::invalid_argument("Distance bin edges must be increasing.");
+        }
+    }
+    const unsigned long num_bins = edges.size() - 1;
+    const unsigned long num_cells = rows * cols;
+    double mean = 0.0;
+    for(unsigned long k = 0; k < num_cells; k++)
+    {
+        mean += values[k];
+    }
+    mean /= std::max(num_cells, 1ul);
+    double variance = 0.0;
+    for(unsigned long k = 0; k < num_cells; k++)
+    {
+        variance += (values[k] - mean) * (values[k] - mean);
+    }
+    // Each pair is counted once, from the cell earlier in row-major order
+    const double largest = std::min(std::floor(edges.back()), static_cast<double>(std::max(rows, cols)));
+    const long reach = static_cast<long>(largest);
+    std::vector<Offset> offsets;
+    for(long row = 0; row <= reach; row++)
+    {
+        for(long col = row == 0 ? 1 : -reach; col <= reach; col++)
+        {
+            const double distance = std::sqrt(static_cast<double>(row * row + col * col));
+            auto upper = std::lower_bound(edges.begin(), edges.end(), distance);
+            if(upper != edges.begin() && upper != edges.end() && row < static_cast<long>(rows) &&
+               std::abs(col) < static_cast<long>(cols))
+            {
+                offsets.push_back(Offset{row, col, static_cast<unsigned long>(upper - edges.begin()) - 1});
+            }
+        }
+    }
+    const unsigned long tasks = std::max(1ul, std::min(num_tasks, rows));
+    // Sums of deviation products, squared differences and products for each offset, from each task
+    std::vector<double> task_sums(tasks * offsets.size() * 3, 0.0);
+    parallel_for(tasks, [&](unsigned long task)
+    {
+        double* sums = task_sums.data() + task * offsets.size() * 3;
+        for(unsigned long i = task * rows / tasks; i < (task + 1) * rows / tasks; i++)
+        {
+            for(unsigned long k = 0; k < offsets.size(); k++)
+            {
+                const Offset &offset = offsets[k];
+                if(i + offset.row >= rows)
+                {
+                    continue;
+                }
+                const unsigned long col_start = offset.col < 0 ? static_cast<unsigned long>(-offset.col) : 0;
+                const unsigned long col_end = offset.col > 0 ? cols - offset.col : cols;
+                const double* a = values + i * cols + col_start;
+                const double* b = values + (i + offset.row) * cols + col_start + offset.col;
+                accumulatePairs(a, b, col_end - col_start, mean, sums + 3 * k);
+            }
+        }
+    });
+    DistanceStatistics statistics;
+    statistics.edges = edges;
+    statistics.pairs.assign(num_bins, 0);
+    std::vector<double> deviation(num_bins, 0.0);
+    std::vector<double> squared(num_bins, 0.0);
+    std::vector<double> product(num_bins, 0.0);
+    for(unsigned long k = 0; k < offsets.size(); k++)
+    {
+        const unsigned long bin = offsets[k].bin;
+        statistics.pairs[bin] += (rows - offsets[k].row) * (cols - std::abs(offsets[k].col));
+        for(unsigned long task = 0; task < tasks; task++)
+        {
+            const double* sums = task_sums.data() + (task * offsets.size() + k) * 3;
+            deviation[bin] += sums[0];
+            squared[bin] += sums[1];
+            product[bin] += sums[2];
+        }
+    }
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    for(unsigned long bin = 0; bin < num_bins; bin++)
+    {
+        const double pairs = statistics.pairs[bin];
+        if(pairs == 0)
+        {
+            statistics.semivariance.push_back(nan);
+            statistics.pair_correlation.push_back(nan);
+            statistics.morans_i.push_back(nan);
+            continue;
+        }
+        statistics.semivariance.push_back(squared[bin] / (2.0 * pairs));
+        statistics.pair_correlation.push_back(mean == 0.0 ? nan : product[bin] / pairs / (mean * mean));
+        statistics.morans_i.push_back(variance == 0.0 ? nan : num_cells * deviation[bin] / (pairs * variance));
+    }
+    return statistics;
+}
+
+double SpatialStatistics::moransI(const double* values, unsigned long rows, unsigned long cols, double max_distance,
+                                  const ParallelFor &parallel_for, unsigned long num_tasks)
+{
+    if(!(max_distance > 0.0))
+    {
+        throw std::invalid_argument("The neighbourhood distance must be positive.");
+    }
+    return compute(values, rows, cols, {0.0, max_distance}, parallel_for, num_tasks).morans_i[0];
+}
@@ -0,0 +1,75 @@
+/**
+ * @brief Contains the spatial statistics kernels, computed over the landscape's grids without exporting them.
+ */
+
+#ifndef LIB_SPATIALSTATISTICS_H
+#define LIB_SPATIALSTATISTICS_H
+
+#include <functional>
+#include <vector>
+
+/**
+ * @brief Statistics of pairs of cells, binned by the distance between them.
+ *
+ * @details Bin k holds the pairs of distinct cells whose centres are more than edges[k] and at most edges[k + 1] apart,
+ * each pair counted once. Bins without any pairs hold NaN.
+ */
+struct DistanceStatistics
+{
+    std::vector<double> edges;
+    // The number of pairs in each bin
+    std::vector<unsigned long> pairs;
+    // Half the mean squared difference between the values of each pair
+    std::vector<double> semivariance;
+    // The mean product of the values of each pair, divided by the squared mean value
+    std::vector<double> pair_correlation;
+    // Moran's I, with a weight of one between the cells of every pair in the bin (a correlogram)
+    std::vector<double> morans_i;
+};
+
+/**
+ * @brief Computes spatial autocorrelation, variograms and pair correlation over a grid of values.
+ *
+ * @details Pairs are enumerated by their offset, so the cost is the number of cells times the number of offsets within
+ * the largest distance, rather than the square of the number of cells. For each offset, the inner loop runs along
+ * contiguous rows with several independent partial sums, so that it can be vectorised; bands of rows are run in
+ * parallel.
+ */
+class SpatialStatistics
+{
+public:
+    // Called as parallel_for(n, function) to call function(k) for each k from 0 to n, in any order and on any thread
+    typedef std::function<void(unsigned long, const std::function<void(unsigned long)>&)> ParallelFor;
+
+    /**
+     * @brief Computes the binned statistics of a grid.
+     * @param values the grid, of rows * cols values in row-major order
+     * @param rows the number of rows
+     * @param cols the number of columns
+     * @param edges the edges of the distance bins, at least two, non-negative and increasing
+     * @param parallel_for runs the bands of rows
+     * @param num_tasks the number of bands of rows to split the grid into
+     * @return the statistics of each bin
+     * @throws std::invalid_argument if the edges are not valid
+     */
+    static DistanceStatistics compute(const double* values, unsigned long rows, unsigned long cols,
+                                      const std::vector<double> &edges, const ParallelFor &parallel_for,
+                                      unsigned long num_tasks);
+
+    /**
+     * @brief Computes Moran's I of a grid, with a weight of one between every pair of distinct cells within the
+     * given distance of each other.
+     * @details A distance of 1 gives the usual rook's-case contiguity, and the square root of 2 the queen's case.
+     * @param values the grid, of rows * cols values in row-major order
+     * @param rows the number of rows
+     * @param cols the number of columns
+     * @param max_distance the greatest distance between neighbouring cells
+     * @param parallel_for runs the bands of rows
+     * @param num_tasks the number of bands of rows to split the grid into
+     * @return Moran's I, or NaN if there are no neighbours or the grid is constant
+     */
+    static double moransI(const double* values, unsigned long rows, unsigned long cols, double max_distance,
+                          const ParallelFor &parallel_for, unsigned long num_tasks);
+};
+
+#endif //LIB_SPATIALSTATISTICS_H
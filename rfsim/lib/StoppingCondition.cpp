@@ -0,0 +1,110 @@
+/**
+ * @brief Contains the conditions which can end a run of the landscape early.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "StoppingCondition.h"
+
+StoppingCondition::StoppingCondition(Kind condition_kind, Quantity condition_quantity, double condition_threshold,
+                                     unsigned long condition_window) : kind(condition_kind),
+                                                                       quantity(condition_quantity),
+                                                                       threshold(condition_threshold),
+                                                                       window(condition_window), history(),
+                                                                       samples(0)
+{
+    if(kind == Kind::stable)
+    {
+        if(!(threshold > 0.0))
+        {
+            throw std::invalid_argument("The relative change for stability must be positive.");
+        }
+        if(window == 0)
+        {
+            throw std::invalid_argument("The window for stability must be at least one iteration.");
+        }
+        history.resize(window);
+    }
+    else if(!std::isfinite(threshold))
+    {
+        throw std::invalid_argument("The threshold must be finite.");
+    }
+}
+
+StoppingCondition::Kind StoppingCondition::parseKind(const std::string &name)
+{
+    if(name == "extinct")
+    {
+        return Kind::extinct;
+    }
+    if(name == "below")
+    {
+        return Kind::below;
+    }
+    if(name == "above")
+    {
+        return Kind::above;
+    }
+    if(name == "stable")
+    {
+        return Kind::stable;
+    }
+    throw std::invalid_argument("Unknown stopping condition: " + name);
+}
+
+StoppingCondition::Quantity StoppingCondition::parseQuantity(const std::string &name)
+{
+    if(name == "rabbits")
+    {
+        return Quantity::rabbits;
+    }
+    if(name == "foxes")
+    {
+        return Quantity::foxes;
+    }
+    if(name == "animals")
+    {
+        return Quantity::animals;
+    }
+    throw std::invalid_argument("Unknown total: " + name);
+}
+
+void StoppingCondition::reset()
+{
+    samples = 0;
+}
+
+bool StoppingCondition::update(const PopulationTotals &totals)
+{
+    double value;
+    switch(quantity)
+    {
+        case Quantity::rabbits:
+            value = totals.rabbits;
+            break;
+        case Quantity::foxes:
+            value = totals.foxes;
+            break;
+        default:
+            value = totals.rabbits + totals.foxes;
+            break;
+    }
+    switch(kind)
+    {
+        case Kind::extinct:
+            return value == 0.0;
+        case Kind::below:
+            return value < threshold;
+        case Kind::above:
+            return value > threshold;
+        default:
+            break;
+    }
+    // The slot for the value from window iterations ago is the one about to be overwritten.
+    double &oldest = history[samples % window];
+    bool holds = samples >= window && std::abs(value - oldest) < threshold * std::max(oldest, 1.0);
+    oldest = value;
+    samples++;
+    return holds;
+}
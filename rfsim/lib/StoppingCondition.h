@@ -0,0 +1,91 @@
+/**
+ * @brief Contains the conditions which can end a run of the landscape early.
+ */
+
+#ifndef LIB_STOPPINGCONDITION_H
+#define LIB_STOPPINGCONDITION_H
+
+#include <string>
+#include <vector>
+#include "PopulationTotals.h"
+
+/**
+ * @brief A condition on the landscape's population totals, checked after every iteration of a run.
+ *
+ * @details Each check takes constant time, as it only reads the totals maintained by the landscape and, for stability,
+ * a ring buffer of the last few totals.
+ */
+class StoppingCondition
+{
+public:
+    enum class Kind
+    {
+        // The quantity has reached zero
+        extinct,
+        // The quantity is below the threshold
+        below,
+        // The quantity is above the threshold
+        above,
+        // The relative change in the quantity over the window is less than the threshold
+        stable
+    };
+
+    enum class Quantity
+    {
+        rabbits,
+        foxes,
+        // Rabbits and foxes together
+        animals
+    };
+
+protected:
+    Kind kind;
+    Quantity quantity;
+    double threshold;
+    unsigned long window;
+    // The last window values of the quantity, for stability
+    std::vector<double> history;
+    unsigned long samples;
+
+public:
+    /**
+     * @brief Creates the condition.
+     * @param condition_kind the kind of condition
+     * @param condition_quantity the total the condition is on
+     * @param condition_threshold the threshold for below and above, or the relative change for stable
+     * @param condition_window the number of iterations the change is measured over, for stable
+     * @throws std::invalid_argument if the threshold or window is out of range
+     */
+    StoppingCondition(Kind condition_kind, Quantity condition_quantity, double condition_threshold = 0.0,
+                      unsigned long condition_window = 1);
+
+    /**
+     * @brief Parses the name of a kind of condition.
+     * @param name one of extinct, below, above or stable
+     * @return the kind
+     * @throws std::invalid_argument if the name is not recognised
+     */
+    static Kind parseKind(const std::string &name);
+
+    /**
+     * @brief Parses the name of a total.
+     * @param name one of rabbits, foxes or animals
+     * @return the quantity
+     * @throws std::invalid_argument if the name is not recognised
+     */
+    static Quantity parseQuantity(const std::string &name);
+
+    /**
+     * @brief Forgets the totals seen so far, ready for a new run.
+     */
+    void reset();
+
+    /**
+     * @brief Records the totals after an iteration and checks whether the condition now holds.
+     * @param totals the current totals of the landscape
+     * @return true if the condition holds
+     */
+    bool update(const PopulationTotals &totals);
+};
+
+#endif //LIB_STOPPINGCONDITION_H
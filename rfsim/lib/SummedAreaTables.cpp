@@ -0,0 +1,24 @@
+/**
+ * @brief Contains the summed-area tables used to answer rectangular region queries in constant time.
+ */
+
+#include <stdexcept>
+#include "SummedAreaTables.h"
+
+RegionSums SummedAreaTables::sum(unsigned long row_start, unsigned long col_start, unsigned long row_end,
+                                 unsigned long col_end) const
+{
+    if(row_start > row_end || col_start > col_end || row_end > num_rows || col_end > num_cols)
+    {
+        throw std::out_of_range("The region must lie within the landscape, with each start no greater than its end.");
+    }
+    const unsigned long top_left = index(row_start, col_start);
+    const unsigned long top_right = index(row_start, col_end);
+    const unsigned long bottom_left = index(row_end, col_start);
+    const unsigned long bottom_right = index(row_end, col_end);
+    RegionSums sums;
+    sums.rabbits = rabbits[bottom_right] - rabbits[bottom_left] - rabbits[top_right] + rabbits[top_left];
+    sums.foxes = foxes[bottom_right] - foxes[bottom_left] - foxes[top_right] + foxes[top_left];
+    sums.grass = grass[bottom_right] - grass[bottom_left] - grass[top_right] + grass[top_left];
+    return sums;
+}
@@ -0,0 +1,142 @@
+/**
+ * @brief Contains the summed-area tables used to answer rectangular region queries in constant time.
+ */
+
+#ifndef LIB_SUMMEDAREATABLES_H
+#define LIB_SUMMEDAREATABLES_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief The sums of the rabbits, foxes and grass within a rectangular region of the landscape.
+ */
+struct RegionSums
+{
+    uint64_t rabbits = 0;
+    uint64_t foxes = 0;
+    double grass = 0.0;
+};
+
+/**
+ * @brief Summed-area tables (integral images) of the rabbits, foxes and grass in each cell.
+ *
+ * @details Each table has one more row and column than the landscape, with element (i, j) holding the sum over all
+ * cells above and to the left of (i, j), so the sum over any rectangle is found from its four corners.
+ */
+class SummedAreaTables
+{
+protected:
+    unsigned long num_rows;
+    unsigned long num_cols;
+    std::vector<uint64_t> rabbits;
+    std::vector<uint64_t> foxes;
+    std::vector<double> grass;
+
+    /**
+     * @brief Gets the position in the tables of the element at the given row and column.
+     */
+    unsigned long index(unsigned long row, unsigned long col) const
+    {
+        return row * (num_cols + 1) + col;
+    }
+
+public:
+
+    SummedAreaTables() : num_rows(0), num_cols(0), rabbits(), foxes(), grass()
+    {
+
+    }
+
+    /**
+     * @brief Builds the tables in two passes: prefix sums along each row, in bands of rows, then down each column, in
+     * strips of columns.
+     * @param rows the number of rows in the landscape
+     * @param cols the number of columns in the landscape
+     * @param counts called as counts(row, column, rabbits, foxes, grass) to read each cell
+     * @param parallel_for called as parallel_for(n, function) to call function(k) for each k from 0 to n, in any
+     * order and on any thread
+     * @param num_tasks the number of bands and strips to split each pass into
+     */
+    template<class Counts, class ParallelFor>
+    void build(unsigned long rows, unsigned long cols, Counts counts, ParallelFor parallel_for,
+               unsigned long num_tasks)
+    {
+        num_rows = rows;
+        num_cols = cols;
+        const unsigned long size = (rows + 1) * (cols + 1);
+        rabbits.assign(size, 0);
+        foxes.assign(size, 0);
+        grass.assign(size, 0.0);
+        const unsigned long row_tasks = std::max(1ul, std::min(num_tasks, rows));
+        parallel_for(row_tasks, [this, rows, cols, &counts, row_tasks](unsigned long task)
+        {
+            for(unsigned long i = task * rows / row_tasks; i < (task + 1) * rows / row_tasks; i++)
+            {
+                uint64_t row_rabbits = 0;
+                uint64_t row_foxes = 0;
+                double row_grass = 0.0;
+                for(unsigned long j = 0; j < cols; j++)
+                {
+                    unsigned long cell_rabbits;
+                    unsigned long cell_foxes;
+                    double cell_grass;
+                    counts(i, j, cell_rabbits, cell_foxes, cell_grass);
+                    row_rabbits += cell_rabbits;
+                    row_foxes += cell_foxes;
+                    row_grass += cell_grass;
+                    const unsigned long position = index(i + 1, j + 1);
+                    rabbits[position] = row_rabbits;
+                    foxes[position] = row_foxes;
+                    grass[position] = row_grass;
+                }
+            }
+        });
+        // Each strip is walked row by row, so the inner loop runs over contiguous elements.
+        const unsigned long col_tasks = std::max(1ul, std::min(num_tasks, cols));
+        parallel_for(col_tasks, [this, rows, cols, col_tasks](unsigned long task)
+        {
+            const unsigned long start = task * cols / col_tasks + 1;
+            const unsigned long end = (task + 1) * cols / col_tasks + 1;
+            for(unsigned long i = 2; i <= rows; i++)
+            {
+                const unsigned long above = index(i - 1, 0);
+                const unsigned long current = index(i, 0);
+                for(unsigned long j = start; j < end; j++)
+                {
+                    rabbits[current + j] += rabbits[above + j];
+                    foxes[current + j] += foxes[above + j];
+                    grass[current + j] += grass[above + j];
+                }
+            }
+        });
+    }
+
+    /**
+     * @brief Gets the sums over the rectangle of cells from row_start to row_end and col_start to col_end, excluding
+     * the ends, in constant time.
+     * @return the sums
+     * @throws std::out_of_range if the rectangle does not lie within the landscape
+     */
+    RegionSums sum(unsigned long row_start, unsigned long col_start, unsigned long row_end,
+                   unsigned long col_end) const;
+
+    /**
+     * @brief Gets the number of rows in the landscape the tables were built from.
+     */
+    unsigned long getRows() const
+    {
+        return num_rows;
+    }
+
+    /**
+     * @brief Gets the number of columns in the landscape the tables were built from.
+     */
+    unsigned long getCols() const
+    {
+        return num_cols;
+    }
+};
+
+#endif //LIB_SUMMEDAREATABLES_H
@@ -0,0 +1,256 @@
+/**
+ * @brief Contains a work-stealing scheduler for running the per-cell phases of the simulation across threads.
+ */
+
+#include <cstring>
+#include <stdexcept>
+#include "WorkStealingScheduler.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace
+{
+    /**
+     * @brief Pins the calling thread to a CPU for its lifetime, then restores the thread's previous affinity.
+     */
+    class CallerPin
+    {
+#ifdef __linux__
+        cpu_set_t previous;
+        bool pinned;
+
+    public:
+        explicit CallerPin(int cpu) : previous(), pinned(false)
+        {
+            if(cpu < 0 || pthread_getaffinity_np(pthread_self(), sizeof(previous), &previous) != 0)
+            {
+                return;
+            }
+            cpu_set_t cpu_set;
+            CPU_ZERO(&cpu_set);
+            CPU_SET(cpu, &cpu_set);
+            pinned = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+        }
+
+        ~CallerPin()
+        {
+            if(pinned)
+            {
+                pthread_setaffinity_np(pthread_self(), sizeof(previous), &previous);
+            }
+        }
+#else
+    public:
+        explicit CallerPin(int)
+        {
+        }
+#endif
+
+        CallerPin(const CallerPin &) = delete;
+
+        CallerPin &operator=(const CallerPin &) = delete;
+    };
+}
+
+WorkStealingScheduler::WorkStealingScheduler(unsigned long num_threads) : queues(), threads(),
+                                                                          current_function(nullptr), mutex(),
+                                                                          start_condition(), finish_condition(),
+                                                                          generation(0), active_workers(0),
+                                                                          remaining_tasks(0), error(nullptr),
+                                                                          stopping(false), stealing(true),
+                                                                          caller_cpu(-1)
+{
+    if(num_threads == 0)
+    {
+        throw std::invalid_argument("Scheduler requires at least one thread.");
+    }
+    for(unsigned long i = 0; i < num_threads; i++)
+    {
+        queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+    }
+    for(unsigned long i = 1; i < num_threads; i++)
+    {
+        threads.emplace_back(&WorkStealingScheduler::workerLoop, this, i);
+    }
+}
+
+WorkStealingScheduler::~WorkStealingScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    start_condition.notify_all();
+    for(auto &thread : threads)
+    {
+        thread.join();
+    }
+}
+
+unsigned long WorkStealingScheduler::getNumThreads() const
+{
+    return queues.size();
+}
+
+void WorkStealingScheduler::run(unsigned long num_tasks,
+                                const std::function<void(unsigned long, unsigned long)> &function,
+                                bool allow_stealing)
+{
+    if(num_tasks == 0)
+    {
+        return;
+    }
+    // Give each worker a contiguous range of the tasks.
+    unsigned long num_workers = queues.size();
+    for(unsigned long worker = 0; worker < num_workers; worker++)
+    {
+        std::lock_guard<std::mutex> lock(queues[worker]->mutex);
+        for(unsigned long task = worker * num_tasks / num_workers; task < (worker + 1) * num_tasks / num_workers;
+            task++)
+        {
+            queues[worker]->tasks.push_back(task);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        current_function = &function;
+        stealing = allow_stealing;
+        remaining_tasks = num_tasks;
+        error = nullptr;
+        active_workers = threads.size();
+        generation++;
+    }
+    start_condition.notify_all();
+    {
+        CallerPin pin(caller_cpu);
+        work(0);
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    finish_condition.wait(lock, [this]
+    { return active_workers == 0; });
+    current_function = nullptr;
+    if(error != nullptr)
+    {
+        std::exception_ptr tmp_error = error;
+        error = nullptr;
+        std::rethrow_exception(tmp_error);
+    }
+}
+
+void WorkStealingScheduler::pinThreads()
+{
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if(sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    {
+        throw std::runtime_error("Could not get the CPUs available to the process.");
+    }
+    std::vector<int> cpus;
+    for(int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        if(CPU_ISSET(cpu, &allowed))
+        {
+            cpus.push_back(cpu);
+        }
+    }
+    if(cpus.empty())
+    {
+        throw std::runtime_error("No CPUs are available to the process.");
+    }
+    // With stealing disabled and one task per worker, each worker runs exactly its own task. The calling thread is
+    // pinned by run() instead, so that its own affinity is not changed.
+    caller_cpu = -1;
+    run(queues.size(), [&cpus](unsigned long, unsigned long worker)
+    {
+        if(worker == 0)
+        {
+            return;
+        }
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(cpus[worker % cpus.size()], &cpu_set);
+        int result = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+        if(result != 0)
+        {
+            throw std::runtime_error(std::string("Could not pin thread to CPU: ") + std::strerror(result));
+        }
+    }, false);
+    caller_cpu = cpus[0];
+#endif
+}
+
+void WorkStealingScheduler::workerLoop(unsigned long worker)
+{
+    unsigned long seen_generation = 0;
+    while(true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            start_condition.wait(lock, [this, seen_generation]
+            { return stopping || generation != seen_generation; });
+            if(stopping)
+            {
+                return;
+            }
+            seen_generation = generation;
+        }
+        work(worker);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            active_workers--;
+        }
+        finish_condition.notify_one();
+    }
+}
+
+void WorkStealingScheduler::work(unsigned long worker)
+{
+    unsigned long task;
+    while(remaining_tasks.load() > 0 && takeTask(worker, task))
+    {
+        try
+        {
+            (*current_function)(task, worker);
+        }
+        catch(...)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(error == nullptr)
+            {
+                error = std::current_exception();
+            }
+        }
+        remaining_tasks--;
+    }
+}
+
+bool WorkStealingScheduler::takeTask(unsigned long worker, unsigned long &task)
+{
+    {
+        WorkerQueue &own = *queues[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if(!own.tasks.empty())
+        {
+            task = own.tasks.back();
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    // Steal from the other workers, starting with the next one along.
+    for(unsigned long offset = 1; stealing && offset < queues.size(); offset++)
+    {
+        WorkerQueue &victim = *queues[(worker + offset) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if(!victim.tasks.empty())
+        {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,114 @@
+/**
+ * @brief Contains a work-stealing scheduler for running the per-cell phases of the simulation across threads.
+ */
+
+#ifndef LIB_WORKSTEALINGSCHEDULER_H
+#define LIB_WORKSTEALINGSCHEDULER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Runs batches of independent tasks on a persistent pool of threads, with idle threads stealing tasks from
+ * busy ones.
+ *
+ * @details Each worker has its own deque of tasks, initially filled with a contiguous range of the tasks so that
+ * neighbouring cells stay on the same thread. A worker takes tasks from the back of its own deque and, once that is
+ * empty, steals from the front of the other workers' deques. The calling thread acts as worker 0.
+ */
+class WorkStealingScheduler
+{
+protected:
+    /**
+     * @brief The queue of tasks belonging to a single worker.
+     */
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<unsigned long> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> threads;
+    const std::function<void(unsigned long, unsigned long)>* current_function;
+    std::mutex mutex;
+    std::condition_variable start_condition;
+    std::condition_variable finish_condition;
+    unsigned long generation;
+    unsigned long active_workers;
+    std::atomic<unsigned long> remaining_tasks;
+    std::exception_ptr error;
+    bool stopping;
+    bool stealing;
+    // The CPU the calling thread is pinned to while it runs tasks as worker 0, or -1 if it is not pinned
+    int caller_cpu;
+
+    /**
+     * @brief The main loop of each of the pool's threads.
+     * @param worker the index of the worker
+     */
+    void workerLoop(unsigned long worker);
+
+    /**
+     * @brief Runs tasks from this worker's queue and then steals from the others until no tasks remain.
+     * @param worker the index of the worker
+     */
+    void work(unsigned long worker);
+
+    /**
+     * @brief Takes the next task for the worker, stealing if its own queue is empty.
+     * @param worker the index of the worker
+     * @param task set to the task to run
+     * @return true if a task was found
+     */
+    bool takeTask(unsigned long worker, unsigned long &task);
+
+public:
+
+    /**
+     * @brief Creates the scheduler, starting num_threads - 1 threads in addition to the calling thread.
+     * @param num_threads the total number of threads to run tasks on
+     */
+    explicit WorkStealingScheduler(unsigned long num_threads);
+
+    ~WorkStealingScheduler();
+
+    WorkStealingScheduler(const WorkStealingScheduler &) = delete;
+
+    WorkStealingScheduler &operator=(const WorkStealingScheduler &) = delete;
+
+    /**
+     * @brief Gets the number of threads tasks are run on.
+     * @return the number of threads, including the calling thread
+     */
+    unsigned long getNumThreads() const;
+
+    /**
+     * @brief Runs every task in [0, num_tasks), returning once all have completed.
+     * @details Any exception thrown by a task is rethrown on the calling thread once the other tasks have finished.
+     * @param num_tasks the number of tasks
+     * @param function called as function(task, worker) for each task
+     * @param allow_stealing if false, each worker only runs its own contiguous range of the tasks, so that a static
+     * assignment of tasks to threads is kept
+     */
+    void run(unsigned long num_tasks, const std::function<void(unsigned long, unsigned long)> &function,
+             bool allow_stealing = true);
+
+    /**
+     * @brief Pins each worker thread to its own CPU, so that the memory it first touches stays on its NUMA node.
+     * @details Workers are assigned the CPUs the process may run on in order, wrapping around if there are more
+     * workers than CPUs, so that neighbouring workers share a node. The thread calling run() is only pinned to worker
+     * 0's CPU for the duration of each run, and its own affinity is restored afterwards, so that threads it creates
+     * later are not confined to one CPU. Pinning is only supported on Linux; elsewhere the threads are left unpinned.
+     */
+    void pinThreads();
+};
+
+#endif //LIB_WORKSTEALINGSCHEDULER_H
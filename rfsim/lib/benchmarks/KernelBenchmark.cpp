@@ -0,0 +1,180 @@
+/**
+ * @brief Benchmarks the closed-form feeding and reproduction kernels against the sequential per-animal loops, checking
+ * that both give bitwise-identical results.
+ */
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "../Rabbit.h"
+#include "../Fox.h"
+
+/**
+ * @brief Generates a population of animals with varied energies, as found after a few iterations.
+ * @tparam T the type of animal
+ * @param size the number of animals
+ * @param random the random number generator
+ * @return the population
+ */
+template<class T>
+vector<T> generatePopulation(unsigned long size, Xoroshiro256plus &random)
+{
+    vector<T> population(size, T(Coordinates(0, 0)));
+    for(auto &animal : population)
+    {
+        animal.setAge(static_cast<int>(random.d01() * 12));
+        // Gives a spread of whole and half energies, as produced by feeding and predation
+        double energy = static_cast<unsigned long>(random.d01() * 400) * 0.5;
+        if(std::is_same<T, Rabbit>::value)
+        {
+            dynamic_cast<Rabbit&>(static_cast<Animal&>(animal)).eatGrass(energy);
+        }
+        else
+        {
+            // Foxes have no eatGrass(), so use the age-free existence cost to vary energy instead
+            for(unsigned long i = 0; i < static_cast<unsigned long>(energy) % 7; i++)
+            {
+                dynamic_cast<Fox&>(static_cast<Animal&>(animal)).exist();
+            }
+        }
+    }
+    return population;
+}
+
+/**
+ * @brief Checks that the energies of two populations are bitwise identical.
+ * @tparam T the type of animal
+ * @return true if all energies match
+ */
+template<class T>
+bool identical(const vector<T> &a, const vector<T> &b)
+{
+    for(unsigned long i = 0; i < a.size(); i++)
+    {
+        double x = a[i].getEnergy();
+        double y = b[i].getEnergy();
+        if(std::memcmp(&x, &y, sizeof(double)) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Times a function over the given number of repeats.
+ * @return the mean time per repeat in microseconds
+ */
+template<class F>
+double timeRepeats(unsigned long repeats, F function)
+{
+    auto start = std::chrono::steady_clock::now();
+    for(unsigned long i = 0; i < repeats; i++)
+    {
+        function();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / repeats;
+}
+
+int main()
+{
+    Xoroshiro256plus random(1);
+    const ModelParameters parameters;
+    bool all_identical = true;
+    std::cout << "kernel, animals, loop (us), closed form (us), identical" << std::endl;
+    std::cout << "(times exclude copying the population before each repeat)" << std::endl;
+    for(unsigned long density : {100ul, 1000ul, 10000ul, 20000ul, 50000ul, 100000ul})
+    {
+        unsigned long repeats = 10000000 / density;
+        auto rabbits = generatePopulation<Rabbit>(density, random);
+        double grass = 30.0 * density / 2 + 17.0;
+        // Feeding
+        vector<Rabbit> loop_rabbits;
+        vector<Rabbit> kernel_rabbits;
+        double loop_grass = 0;
+        double kernel_grass = 0;
+        double copy_time = timeRepeats(repeats, [&]()
+        {
+            loop_rabbits = rabbits;
+        });
+        double loop_time = timeRepeats(repeats, [&]()
+        {
+            loop_rabbits = rabbits;
+            loop_grass = grass;
+            for(auto &rabbit : loop_rabbits)
+            {
+                if(loop_grass > 1.0)
+                {
+                    rabbit.eatGrass(loop_grass);
+                    loop_grass -= 30;
+                }
+                rabbit.exist();
+            }
+        });
+        double kernel_time = timeRepeats(repeats, [&]()
+        {
+            kernel_rabbits = rabbits;
+            kernel_grass = Rabbit::grazePopulation(kernel_rabbits.data(), kernel_rabbits.size(), grass);
+        });
+        bool same = identical(loop_rabbits, kernel_rabbits) && loop_grass == kernel_grass;
+        all_identical = all_identical && same;
+        std::cout << "graze, " << density << ", " << loop_time - copy_time << ", " << kernel_time - copy_time << ", "
+                  << same << std::endl;
+        // Rabbit reproduction
+        unsigned long loop_total = 0;
+        unsigned long kernel_total = 0;
+        loop_time = timeRepeats(repeats, [&]()
+        {
+            loop_rabbits = rabbits;
+            loop_total = 0;
+            for(auto &rabbit : loop_rabbits)
+            {
+                while(rabbit.canReproduce(parameters))
+                {
+                    loop_total++;
+                }
+            }
+        });
+        kernel_time = timeRepeats(repeats, [&]()
+        {
+            kernel_rabbits = rabbits;
+            kernel_total = Rabbit::reproducePopulation(kernel_rabbits.data(), kernel_rabbits.size(), parameters);
+        });
+        same = identical(loop_rabbits, kernel_rabbits) && loop_total == kernel_total;
+        all_identical = all_identical && same;
+        std::cout << "rabbit reproduction, " << density << ", " << loop_time - copy_time << ", "
+                  << kernel_time - copy_time << ", " << same << std::endl;
+        // Fox reproduction
+        auto foxes = generatePopulation<Fox>(density, random);
+        vector<Fox> loop_foxes;
+        vector<Fox> kernel_foxes;
+        copy_time = timeRepeats(repeats, [&]()
+        {
+            loop_foxes = foxes;
+        });
+        loop_time = timeRepeats(repeats, [&]()
+        {
+            loop_foxes = foxes;
+            loop_total = 0;
+            for(auto &fox : loop_foxes)
+            {
+                while(fox.canReproduce(parameters))
+                {
+                    loop_total++;
+                }
+            }
+        });
+        kernel_time = timeRepeats(repeats, [&]()
+        {
+            kernel_foxes = foxes;
+            kernel_total = Fox::reproducePopulation(kernel_foxes.data(), kernel_foxes.size(), parameters);
+        });
+        same = identical(loop_foxes, kernel_foxes) && loop_total == kernel_total;
+        all_identical = all_identical && same;
+        std::cout << "fox reproduction, " << density << ", " << loop_time - copy_time << ", "
+                  << kernel_time - copy_time << ", " << same << std::endl;
+    }
+    return all_identical ? 0 : 1;
+}
@@ -0,0 +1,74 @@
+/**
+ * @brief Benchmarks NUMA-aware tile placement, where each tile's memory is initialised by the thread which owns it,
+ * against remote placement, where the main thread initialises every cell.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include "../Landscape.h"
+
+/**
+ * @brief Runs the simulation with the memory placed as given, timing the iterations.
+ * @param threads the number of threads
+ * @param size the width and height of the landscape
+ * @param iterations the number of iterations to time
+ * @param local if true, each tile's memory is placed by its owning thread, otherwise by the main thread
+ * @param counts set to the final number of rabbits and foxes in each cell
+ * @return the mean time per iteration in milliseconds
+ */
+double timePlacement(unsigned long threads, unsigned long size, unsigned long iterations, bool local,
+                     vector<unsigned long> &counts)
+{
+    Landscape landscape;
+    landscape.setSeed(1);
+    landscape.setThreads(threads, 4096);
+    landscape.setPartitioning(numeric_limits<unsigned long>::max());
+    if(local)
+    {
+        landscape.setNumaPlacement(true);
+        landscape.setLandscapeSize(size, size);
+    }
+    else
+    {
+        // Every cell is initialised on the main thread before the threads are pinned to their tiles.
+        landscape.setLandscapeSize(size, size);
+        landscape.setNumaPlacement(true);
+    }
+    auto start = std::chrono::steady_clock::now();
+    for(unsigned long i = 0; i < iterations; i++)
+    {
+        landscape.iterate();
+    }
+    auto end = std::chrono::steady_clock::now();
+    counts.clear();
+    for(unsigned long i = 0; i < size; i++)
+    {
+        for(unsigned long j = 0; j < size; j++)
+        {
+            const Cell &cell = landscape.get(i, j);
+            counts.push_back(cell.getNumRabbits());
+            counts.push_back(cell.getNumFoxes());
+        }
+    }
+    return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+}
+
+int main(int argc, char* argv[])
+{
+    unsigned long threads = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : std::thread::hardware_concurrency();
+    unsigned long size = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 150;
+    unsigned long iterations = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 6;
+    threads = std::max(threads, 1ul);
+    vector<unsigned long> remote_counts;
+    vector<unsigned long> local_counts;
+    std::cout << "placement, threads, size, iteration time (ms)" << std::endl;
+    double remote_time = timePlacement(threads, size, iterations, false, remote_counts);
+    std::cout << "remote, " << threads << ", " << size << ", " << remote_time << std::endl;
+    double local_time = timePlacement(threads, size, iterations, true, local_counts);
+    std::cout << "local, " << threads << ", " << size << ", " << local_time << std::endl;
+    bool same = remote_counts == local_counts;
+    std::cout << "identical: " << same << std::endl;
+    return same ? 0 : 1;
+}
@@ -0,0 +1,235 @@
+/**
+ * @brief Contains the implementation of the stable C interface, which wraps Landscape behind opaque handles.
+ */
+
+#include <exception>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "rfsim.h"
+#include "../Landscape.h"
+
+/**
+ * @brief The landscape behind a handle, with the buffers its counts are borrowed from.
+ */
+struct rfsim_landscape
+{
+    Landscape landscape;
+    bool set_up = false;
+    std::vector<int32_t> rabbits;
+    std::vector<int32_t> foxes;
+};
+
+namespace
+{
+    thread_local std::string last_error;
+
+    /**
+     * @brief Records the error for rfsim_last_error().
+     * @param status the status to return
+     * @param message the description of the error
+     * @return the status
+     */
+    rfsim_status fail(rfsim_status status, const std::string &message)
+    {
+        last_error = message;
+        return status;
+    }
+
+    /**
+     * @brief Runs the function, converting any exception to a status.
+     * @param function the function to run
+     * @return the status
+     */
+    template<class F>
+    rfsim_status guard(F function)
+    {
+        last_error.clear();
+        try
+        {
+            function();
+            return RFSIM_OK;
+        }
+        catch(std::bad_alloc &e)
+        {
+            return fail(RFSIM_ERROR_OUT_OF_MEMORY, e.what());
+        }
+        catch(std::invalid_argument &e)
+        {
+            return fail(RFSIM_ERROR_INVALID_ARGUMENT, e.what());
+        }
+        catch(std::out_of_range &e)
+        {
+            return fail(RFSIM_ERROR_INVALID_ARGUMENT, e.what());
+        }
+        catch(std::exception &e)
+        {
+            return fail(RFSIM_ERROR_RUNTIME, e.what());
+        }
+        catch(...)
+        {
+            return fail(RFSIM_ERROR_RUNTIME, "Unknown error.");
+        }
+    }
+}
+
+int rfsim_api_version(void)
+{
+    return RFSIM_API_VERSION;
+}
+
+const char* rfsim_status_string(rfsim_status status)
+{
+    switch(status)
+    {
+        case RFSIM_OK:
+            return "ok";
+        case RFSIM_ERROR_NULL_ARGUMENT:
+            return "null argument";
+        case RFSIM_ERROR_INVALID_ARGUMENT:
+            return "invalid argument";
+        case RFSIM_ERROR_NOT_SET_UP:
+            return "landscape not set up";
+        case RFSIM_ERROR_OUT_OF_MEMORY:
+            return "out of memory";
+        case RFSIM_ERROR_RUNTIME:
+            return "runtime error";
+    }
+    return "unknown status";
+}
+
+const char* rfsim_last_error(void)
+{
+    return last_error.c_str();
+}
+
+rfsim_status rfsim_create(rfsim_landscape** landscape)
+{
+    if(landscape == nullptr)
+    {
+        return fail(RFSIM_ERROR_NULL_ARGUMENT, "No handle to create.");
+    }
+    *landscape = nullptr;
+    return guard([landscape]{*landscape = new rfsim_landscape();});
+}
+
+void rfsim_destroy(rfsim_landscape* landscape)
+{
+    delete landscape;
+}
+
+rfsim_status rfsim_set_threads(rfsim_landscape* landscape, uint64_t threads, uint64_t grain)
+{
+    if(landscape == nullptr)
+    {
+        return fail(RFSIM_ERROR_NULL_ARGUMENT, "Null landscape.");
+    }
+    if(landscape->set_up)
+    {
+        return fail(RFSIM_ERROR_INVALID_ARGUMENT, "Threads must be set before the landscape is set up.");
+    }
+    return guard([=]{landscape->landscape.setThreads(threads, grain == 0 ? 4096 : grain);});
+}
+
+rfsim_status rfsim_set_parameter(rfsim_landscape* landscape, const char* name, double value)
+{
+    if(landscape == nullptr || name == nullptr)
+    {
+        return fail(RFSIM_ERROR_NULL_ARGUMENT, "Null landscape or parameter name.");
+    }
+    return guard([=]
+                 {
+                     ModelParameters parameters = landscape->landscape.getParameters();
+                     parameters.set(name, value);
+                     landscape->landscape.setParameters(parameters);
+                 });
+}
+
+rfsim_status rfsim_setup(rfsim_landscape* landscape, uint64_t seed, uint64_t x_size, uint64_t y_size)
+{
+    if(landscape == nullptr)
+    {
+        return fail(RFSIM_ERROR_NULL_ARGUMENT, "Null landscape.");
+    }
+    if(landscape->set_up)
+    {
+        return fail(RFSIM_ERROR_INVALID_ARGUMENT, "The landscape has already been set up.");
+    }
+    if(x_size == 0 || y_size == 0)
+    {
+        return fail(RFSIM_ERROR_INVALID_ARGUMENT, "The landscape must have at least one cell.");
+    }
+    return guard([=]
+                 {
+                     landscape->landscape.setSeed(seed);
+                     landscape->landscape.setLandscapeSize(x_size, y_size);
+                     landscape->rabbits.resize(x_size * y_size);
+                     landscape->foxes.resize(x_size * y_size);
+                     landscape->landscape.copyCounts(landscape->rabbits.data(), landscape->foxes.data());
+                     landscape->set_up = true;
+                 });
+}
+
+rfsim_status rfsim_iterate(rfsim_landscape* landscape, uint64_t steps)
+{
+    if(landscape == nullptr)
+    {
+        return fail(RFSIM_ERROR_NULL_ARGUMENT, "Null landscape.");
+    }
+    if(!landscape->set_up)
+    {
+        return fail(RFSIM_ERROR_NOT_SET_UP, "The landscape has not been set up.");
+    }
+    return guard([=]
+                 {
+                     for(uint64_t step = 0; step < steps; step++)
+                     {
+                         landscape->landscape.iterate();
+                     }
+                     landscape->landscape.copyCounts(landscape->rabbits.data(), landscape->foxes.data());
+                 });
+}
+
+rfsim_status rfsim_get_size(const rfsim_landscape* landscape, uint64_t* rows, uint64_t* cols)
+{
+    if(landscape == nullptr || rows == nullptr || cols == nullptr)
+    {
+        return fail(RFSIM_ERROR_NULL_ARGUMENT, "Null landscape or output.");
+    }
+    if(!landscape->set_up)
+    {
+        return fail(RFSIM_ERROR_NOT_SET_UP, "The landscape has not been set up.");
+    }
+    *rows = landscape->landscape.getRows();
+    *cols = landscape->landscape.getCols();
+    return RFSIM_OK;
+}
+
+rfsim_status rfsim_get_rabbits(const rfsim_landscape* landscape, const int32_t** counts)
+{
+    if(landscape == nullptr || counts == nullptr)
+    {
+        return fail(RFSIM_ERROR_NULL_ARGUMENT, "Null landscape or output.");
+    }
+    if(!landscape->set_up)
+    {
+        return fail(RFSIM_ERROR_NOT_SET_UP, "The landscape has not been set up.");
+    }
+    *counts = landscape->rabbits.data();
+    return RFSIM_OK;
+}
+
+rfsim_status rfsim_get_foxes(const rfsim_landscape* landscape, const int32_t** counts)
+{
+    if(landscape == nullptr || counts == nullptr)
+    {
+        return fail(RFSIM_ERROR_NULL_ARGUMENT, "Null landscape or output.");
+    }
+    if(!landscape->set_up)
+    {
+        return fail(RFSIM_ERROR_NOT_SET_UP, "The landscape has not been set up.");
+    }
+    *counts = landscape->foxes.data();
+    return RFSIM_OK;
+}
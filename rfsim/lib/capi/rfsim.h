@@ -0,0 +1,152 @@
+/**
+ * @brief The stable C interface to the simulation, for embedding it in other languages without Python.
+ *
+ * @details Landscapes are reached only through opaque handles. No function throws: each reports failure through its
+ * rfsim_status, with a description available from rfsim_last_error() on the same thread. Count accessors return
+ * pointers borrowed from buffers owned by the landscape, which are refreshed at the end of each rfsim_iterate() call,
+ * so an embedder can keep the pointer across steps without copying.
+ */
+
+#ifndef RFSIM_H
+#define RFSIM_H
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+// The library is built with RFSIM_BUILDING defined, and embedders import what it exports
+#ifdef RFSIM_BUILDING
+#define RFSIM_API __declspec(dllexport)
+#else
+#define RFSIM_API __declspec(dllimport)
+#endif
+#else
+#define RFSIM_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @brief The version of this interface, incremented whenever it changes incompatibly.
+ */
+#define RFSIM_API_VERSION 1
+
+/**
+ * @brief The result of each call.
+ */
+typedef enum
+{
+    RFSIM_OK = 0,
+    RFSIM_ERROR_NULL_ARGUMENT = 1,
+    RFSIM_ERROR_INVALID_ARGUMENT = 2,
+    RFSIM_ERROR_NOT_SET_UP = 3,
+    RFSIM_ERROR_OUT_OF_MEMORY = 4,
+    RFSIM_ERROR_RUNTIME = 5
+} rfsim_status;
+
+/**
+ * @brief An opaque handle to a landscape.
+ */
+typedef struct rfsim_landscape rfsim_landscape;
+
+/**
+ * @brief Gets the version of the interface the library was built with.
+ * @return RFSIM_API_VERSION, as compiled into the library
+ */
+RFSIM_API int rfsim_api_version(void);
+
+/**
+ * @brief Describes a status code.
+ * @param status the status
+ * @return a static string describing the status
+ */
+RFSIM_API const char* rfsim_status_string(rfsim_status status);
+
+/**
+ * @brief Gets the description of the last error on the calling thread.
+ * @return the description, valid until the next call on this thread, or an empty string if there was no error
+ */
+RFSIM_API const char* rfsim_last_error(void);
+
+/**
+ * @brief Creates an empty landscape.
+ * @param landscape set to the new handle, which must be released with rfsim_destroy()
+ * @return the status
+ */
+RFSIM_API rfsim_status rfsim_create(rfsim_landscape** landscape);
+
+/**
+ * @brief Destroys a landscape, invalidating any borrowed count pointers. Does nothing if the handle is null.
+ * @param landscape the handle
+ */
+RFSIM_API void rfsim_destroy(rfsim_landscape* landscape);
+
+/**
+ * @brief Uses the given number of threads, with each cell drawing from its own random number stream. Must be called
+ * before rfsim_setup().
+ * @param landscape the handle
+ * @param threads the number of threads
+ * @param grain the estimated work in each scheduled task, or 0 for the default
+ * @return the status
+ */
+RFSIM_API rfsim_status rfsim_set_threads(rfsim_landscape* landscape, uint64_t threads, uint64_t grain);
+
+/**
+ * @brief Sets a model parameter by name (e.g. "grass_growth" or "move_probability").
+ * @param landscape the handle
+ * @param name the name of the parameter
+ * @param value the new value
+ * @return the status
+ */
+RFSIM_API rfsim_status rfsim_set_parameter(rfsim_landscape* landscape, const char* name, double value);
+
+/**
+ * @brief Sets the seed and creates the cells of the landscape. May only be called once per landscape.
+ * @param landscape the handle
+ * @param seed the random number seed
+ * @param x_size the number of columns
+ * @param y_size the number of rows
+ * @return the status
+ */
+RFSIM_API rfsim_status rfsim_setup(rfsim_landscape* landscape, uint64_t seed, uint64_t x_size, uint64_t y_size);
+
+/**
+ * @brief Runs the simulation for a number of steps, then refreshes the count buffers.
+ * @param landscape the handle
+ * @param steps the number of steps
+ * @return the status
+ */
+RFSIM_API rfsim_status rfsim_iterate(rfsim_landscape* landscape, uint64_t steps);
+
+/**
+ * @brief Gets the dimensions of the landscape.
+ * @param landscape the handle
+ * @param rows set to the number of rows
+ * @param cols set to the number of columns
+ * @return the status
+ */
+RFSIM_API rfsim_status rfsim_get_size(const rfsim_landscape* landscape, uint64_t* rows, uint64_t* cols);
+
+/**
+ * @brief Borrows the number of rabbits in each cell.
+ * @param landscape the handle
+ * @param counts set to rows * cols counts in row-major order, owned by the landscape and valid until it is destroyed
+ * @return the status
+ */
+RFSIM_API rfsim_status rfsim_get_rabbits(const rfsim_landscape* landscape, const int32_t** counts);
+
+/**
+ * @brief Borrows the number of foxes in each cell.
+ * @param landscape the handle
+ * @param counts set to rows * cols counts in row-major order, owned by the landscape and valid until it is destroyed
+ * @return the status
+ */
+RFSIM_API rfsim_status rfsim_get_foxes(const rfsim_landscape* landscape, const int32_t** counts);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RFSIM_H
@@ -14,13 +14,19 @@
 #include "numpy/arrayobject.h"
 
 #include "PyWrapper.h"
+#include "PyEnsemble.h"
+#include "PySweep.h"
 using namespace std;
-#if PY_MAJOR_VERSION < 3
 static PyMethodDef LibMethods[] =
         {
+                {"run_ensemble", (PyCFunction) runEnsemble, METH_VARARGS | METH_KEYWORDS,
+                        "Run one replicate for each seed on a pool of threads, returning the stacked final counts."},
+                {"ensemble_statistics", (PyCFunction) runEnsembleStatistics, METH_VARARGS | METH_KEYWORDS,
+                        "Run one replicate for each seed, returning only summary statistics of the counts."},
+                {"run_sweep", (PyCFunction) runSweep, METH_VARARGS | METH_KEYWORDS,
+                        "Run one replicate for each seed at every parameter point, with common random numbers."},
                 {NULL, NULL, 0 , NULL}
         };
-#endif // PY_MAJOR_VERSION
 
 
 
@@ -42,6 +48,7 @@ static PyModuleDef genPyModuleDef()
 	tmpModuleDef.m_name = "librfsim";
 	tmpModuleDef.m_doc = "Wrapper for c++ library which performs simulations of rabbits and foxes on a landscape.";
 	tmpModuleDef.m_size = -1;
+	tmpModuleDef.m_methods = LibMethods;
 	return tmpModuleDef;
 }
 static PyModuleDef moduledef = genPyModuleDef();
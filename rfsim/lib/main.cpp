@@ -1,21 +1,156 @@
+/**
+ * @brief The rfsim command-line tool, which runs a single simulation from a config file without Python.
+ *
+ * Usage: rfsim <config file> [key=value]...
+ *
+ * Settings given after the config file override those within it. See SimulationConfig for the settings available.
+ */
+
+#include <cstdint>
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
 #include "Landscape.h"
+#include "SimulationConfig.h"
 
-using namespace std;
+namespace
+{
+    /**
+     * @brief Writes the final counts as a .npy file holding an int32 array of shape (2, rows, cols).
+     * @param landscape the landscape to write
+     * @param output the stream to write to
+     */
+    void writeNpy(Landscape &landscape, std::ostream &output)
+    {
+        std::stringstream header;
+        header << "{'descr': '<i4', 'fortran_order': False, 'shape': (2, " << landscape.getRows() << ", "
+               << landscape.getCols() << "), }";
+        // The magic string, version and header length take 10 bytes, and the header is padded to a multiple of 64.
+        std::string padded = header.str();
+        padded.append(63 - (10 + padded.size()) % 64, ' ');
+        padded.push_back('\n');
+        auto header_length = static_cast<unsigned short>(padded.size());
+        output.write("\x93NUMPY\x01\x00", 8);
+        output.put(static_cast<char>(header_length & 0xFF));
+        output.put(static_cast<char>(header_length >> 8));
+        output << padded;
+        std::vector<int32_t> values;
+        for(int animal = 0; animal < 2; animal++)
+        {
+            for(unsigned long i = 0; i < landscape.getRows(); i++)
+            {
+                for(unsigned long j = 0; j < landscape.getCols(); j++)
+                {
+                    values.push_back(static_cast<int32_t>(animal == 0 ? landscape.getNumRabbits(i, j)
+                                                                      : landscape.getNumFoxes(i, j)));
+                }
+            }
+        }
+        // Assumes a little-endian host, as does the header.
+        output.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(int32_t));
+    }
 
-int main()
+    /**
+     * @brief Runs the simulation, writing the results in the configured format.
+     * @param config the settings of the run
+     * @param output the stream to write to
+     */
+    void run(const SimulationConfig &config, std::ostream &output)
+    {
+        Landscape landscape;
+        config.configure(landscape);
+        if(config.format == "totals")
+        {
+            output << "step,rabbits,foxes" << "\n";
+        }
+        else if(config.format == "npy_series")
+        {
+            landscape.startTimeSeries(config.output_file);
+        }
+        else if(config.format == "history")
+        {
+            landscape.startHistoryFile(config.output_file, config.keyframe_interval);
+        }
+        for(unsigned long step = 0; step < config.steps; step++)
+        {
+            landscape.iterate();
+            if(config.format == "totals")
+            {
+                const PopulationTotals &totals = landscape.getTotals();
+                output << step << "," << totals.rabbits << "," << totals.foxes << "\n";
+            }
+        }
+        if(config.format == "csv")
+        {
+            output << "row,col,rabbits,foxes" << "\n";
+            for(unsigned long i = 0; i < landscape.getRows(); i++)
+            {
+                for(unsigned long j = 0; j < landscape.getCols(); j++)
+                {
+                    output << i << "," << j << "," << landscape.getNumRabbits(i, j) << ","
+                           << landscape.getNumFoxes(i, j) << "\n";
+                }
+            }
+        }
+        else if(config.format == "npy")
+        {
+            writeNpy(landscape, output);
+        }
+        landscape.stopTimeSeries();
+        landscape.stopHistoryFile();
+        output.flush();
+    }
+}
+
+int main(int argc, char* argv[])
 {
-    Landscape landscape = Landscape();
-    landscape.setSeed(1);
-    landscape.setLandscapeSize(5, 5);
-    for(unsigned long i = 0; i < 100; i ++)
+    if(argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <config file> [key=value]..." << std::endl;
+        return 2;
+    }
+    try
+    {
+        SimulationConfig config;
+        std::ifstream config_file(argv[1]);
+        if(!config_file)
+        {
+            throw std::runtime_error(std::string("Could not open config file: ") + argv[1]);
+        }
+        config.load(config_file);
+        for(int i = 2; i < argc; i++)
+        {
+            std::string setting(argv[i]);
+            std::size_t separator = setting.find('=');
+            if(separator == std::string::npos)
+            {
+                throw std::invalid_argument("Expected key=value, got: " + setting);
+            }
+            config.set(setting.substr(0, separator), setting.substr(separator + 1));
+        }
+        config.validate();
+        if(config.output_file == "-" || config.format == "npy_series" || config.format == "history")
+        {
+            // Time series and histories are written by their own writers of the output file.
+            run(config, std::cout);
+        }
+        else
+        {
+            std::ofstream output(config.output_file, std::ios::binary);
+            if(!output)
+            {
+                throw std::runtime_error("Could not open output file: " + config.output_file);
+            }
+            run(config, output);
+        }
+    }
+    catch(std::exception &e)
     {
-        std::cout << i << std::endl;
-        landscape.iterate();
-//        if(i > 999)
-//        {
-            landscape.print();
-//        }
+        std::cerr << "rfsim: " << e.what() << std::endl;
+        return 1;
     }
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,60 @@
+/**
+ * @brief The rfsim_server executable, which runs simulation jobs submitted over a Unix domain socket.
+ *
+ * Usage: rfsim_server <socket path> [workers]
+ *
+ * The number of workers defaults to the number of hardware threads. The server runs until it receives SIGINT or
+ * SIGTERM.
+ */
+
+#include <algorithm>
+#include <csignal>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "SimulationServer.h"
+
+namespace
+{
+    SimulationServer* running_server = nullptr;
+
+    void handleSignal(int)
+    {
+        if(running_server != nullptr)
+        {
+            running_server->requestStop();
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if(argc < 2 || argc > 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <socket path> [workers]" << std::endl;
+        return 2;
+    }
+    unsigned long workers = std::max(std::thread::hardware_concurrency(), 1u);
+    try
+    {
+        if(argc > 2)
+        {
+            workers = std::stoul(argv[2]);
+        }
+        SimulationServer server(argv[1], workers);
+        server.start();
+        running_server = &server;
+        std::signal(SIGINT, handleSignal);
+        std::signal(SIGTERM, handleSignal);
+        std::cout << "Listening on " << argv[1] << " with " << workers << " workers" << std::endl;
+        server.serve();
+        server.stop();
+        running_server = nullptr;
+    }
+    catch(std::exception &e)
+    {
+        std::cerr << "rfsim_server: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,429 @@
+/**
+ * @brief Contains the simulation server, which runs jobs submitted over a Unix domain socket on a pool of workers.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "SimulationServer.h"
+
+ServerConnection::ServerConnection(int socket_fd) : socket_fd(socket_fd), closed(false), outbox_mutex(),
+                                                    outbox_condition(), outbox(), outbox_bytes(0), flushing(false),
+                                                    writer()
+{
+    writer = std::thread(&ServerConnection::writeLoop, this);
+}
+
+ServerConnection::~ServerConnection()
+{
+    {
+        std::lock_guard<std::mutex> lock(outbox_mutex);
+        closed = true;
+    }
+    outbox_condition.notify_all();
+    writer.join();
+    ::close(socket_fd);
+}
+
+bool ServerConnection::send(const std::string &line, bool wait_for_space)
+{
+    std::unique_lock<std::mutex> lock(outbox_mutex);
+    if(wait_for_space)
+    {
+        outbox_condition.wait(lock, [this]{return closed || outbox_bytes < max_outbox_bytes;});
+    }
+    if(closed)
+    {
+        return false;
+    }
+    outbox.push_back(line + "\n");
+    outbox_bytes += outbox.back().size();
+    lock.unlock();
+    outbox_condition.notify_all();
+    return true;
+}
+
+void ServerConnection::writeLoop()
+{
+    std::deque<std::string> lines;
+    while(true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(outbox_mutex);
+            outbox_condition.wait(lock, [this]{return closed || !outbox.empty();});
+            if(closed && (!flushing || outbox.empty()))
+            {
+                lock.unlock();
+                ::shutdown(socket_fd, SHUT_RDWR);
+                return;
+            }
+            lines.swap(outbox);
+            outbox_bytes = 0;
+        }
+        // Senders waiting for space can queue the next lines while these are written.
+        outbox_condition.notify_all();
+        for(const std::string &message : lines)
+        {
+            std::size_t sent = 0;
+            while(sent < message.size())
+            {
+                ssize_t result = ::send(socket_fd, message.data() + sent, message.size() - sent, MSG_NOSIGNAL);
+                if(result < 0)
+                {
+                    if(errno == EINTR)
+                    {
+                        continue;
+                    }
+                    close();
+                    return;
+                }
+                sent += static_cast<std::size_t>(result);
+            }
+        }
+        lines.clear();
+    }
+}
+
+void ServerConnection::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(outbox_mutex);
+        closed = true;
+        flushing = false;
+    }
+    outbox_condition.notify_all();
+    ::shutdown(socket_fd, SHUT_RDWR);
+}
+
+void ServerConnection::finish()
+{
+    {
+        std::lock_guard<std::mutex> lock(outbox_mutex);
+        if(closed)
+        {
+            return;
+        }
+        closed = true;
+        flushing = true;
+    }
+    outbox_condition.notify_all();
+}
+
+bool ServerConnection::isClosed() const
+{
+    return closed;
+}
+
+int ServerConnection::getSocket() const
+{
+    return socket_fd;
+}
+
+SimulationServer::SimulationServer(const std::string &socket_path, unsigned long num_workers)
+        : socket_path(socket_path), num_workers(num_workers), listen_fd(-1), stopping(false), queue_mutex(),
+          queue_condition(), jobs(), workers(), connections_mutex(), readers_condition(), connections(),
+          active_readers(0)
+{
+    if(num_workers == 0)
+    {
+        throw std::invalid_argument("Server requires at least one worker.");
+    }
+}
+
+SimulationServer::~SimulationServer()
+{
+    stop();
+}
+
+ServerJob SimulationServer::parseJob(const std::vector<std::string> &tokens)
+{
+    if(tokens.size() < 2)
+    {
+        throw std::invalid_argument("Run requests must give a job id.");
+    }
+    ServerJob job;
+    job.id = tokens[1];
+    for(unsigned long i = 2; i < tokens.size(); i++)
+    {
+        std::size_t separator = tokens[i].find('=');
+        if(separator == std::string::npos)
+        {
+            throw std::invalid_argument("Expected key=value, got: " + tokens[i]);
+        }
+        std::string key = tokens[i].substr(0, separator);
+        std::string value = tokens[i].substr(separator + 1);
+        if(key == "output")
+        {
+            job.totals = false;
+            job.grids = false;
+            std::stringstream outputs(value);
+            std::string output;
+            while(std::getline(outputs, output, ','))
+            {
+                if(output == "totals")
+                {
+                    job.totals = true;
+                }
+                else if(output == "grids")
+                {
+                    job.grids = true;
+                }
+                else
+                {
+                    throw std::invalid_argument("Unknown output: " + output);
+                }
+            }
+        }
+        else
+        {
+            job.config.set(key, value);
+        }
+    }
+    job.config.validate();
+    return job;
+}
+
+void SimulationServer::start()
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if(socket_path.size() >= sizeof(address.sun_path))
+    {
+        throw std::runtime_error("Socket path is too long: " + socket_path);
+    }
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(listen_fd < 0)
+    {
+        throw std::runtime_error(std::string("Could not create socket: ") + std::strerror(errno));
+    }
+    // Replace any socket left behind by a previous server.
+    unlink(socket_path.c_str());
+    if(bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+       || listen(listen_fd, SOMAXCONN) != 0)
+    {
+        std::string error = std::strerror(errno);
+        ::close(listen_fd);
+        listen_fd = -1;
+        throw std::runtime_error("Could not listen on " + socket_path + ": " + error);
+    }
+    for(unsigned long i = 0; i < num_workers; i++)
+    {
+        workers.emplace_back(&SimulationServer::workerLoop, this);
+    }
+}
+
+void SimulationServer::serve()
+{
+    while(!stopping)
+    {
+        pollfd listener{listen_fd, POLLIN, 0};
+        // Wake regularly to notice stop requests made from signal handlers.
+        int ready = poll(&listener, 1, 200);
+        if(ready <= 0 || stopping)
+        {
+            continue;
+        }
+        int client_fd = accept(listen_fd, nullptr, nullptr);
+        if(client_fd < 0)
+        {
+            continue;
+        }
+        auto connection = std::make_shared<ServerConnection>(client_fd);
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        connections.push_back(connection);
+        active_readers++;
+        std::thread(&SimulationServer::readLoop, this, connection).detach();
+    }
+}
+
+void SimulationServer::requestStop()
+{
+    stopping = true;
+}
+
+void SimulationServer::stop()
+{
+    stopping = true;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        jobs.clear();
+    }
+    queue_condition.notify_all();
+    {
+        std::unique_lock<std::mutex> lock(connections_mutex);
+        for(auto &connection : connections)
+        {
+            connection->close();
+        }
+        readers_condition.wait(lock, [this]{return active_readers == 0;});
+    }
+    for(auto &worker : workers)
+    {
+        worker.join();
+    }
+    workers.clear();
+    if(listen_fd >= 0)
+    {
+        ::close(listen_fd);
+        listen_fd = -1;
+        unlink(socket_path.c_str());
+    }
+}
+
+void SimulationServer::readLoop(std::shared_ptr<ServerConnection> connection)
+{
+    std::string buffer;
+    char chunk[4096];
+    bool quit = false;
+    while(!stopping && !connection->isClosed())
+    {
+        ssize_t received = recv(connection->getSocket(), chunk, sizeof(chunk), 0);
+        if(received < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if(received <= 0)
+        {
+            break;
+        }
+        buffer.append(chunk, static_cast<std::size_t>(received));
+        std::size_t end;
+        while(!connection->isClosed() && (end = buffer.find('\n')) != std::string::npos)
+        {
+            std::string line = buffer.substr(0, end);
+            buffer.erase(0, end + 1);
+            if(!handleRequest(connection, line))
+            {
+                // The replies to earlier requests are still sent before the connection is shut down.
+                quit = true;
+                connection->finish();
+            }
+        }
+    }
+    if(!quit)
+    {
+        connection->close();
+    }
+    // Queued jobs keep the connection alive until they are abandoned.
+    std::lock_guard<std::mutex> lock(connections_mutex);
+    connections.erase(std::remove(connections.begin(), connections.end(), connection), connections.end());
+    active_readers--;
+    readers_condition.notify_all();
+}
+
+bool SimulationServer::handleRequest(const std::shared_ptr<ServerConnection> &connection, const std::string &line)
+{
+    std::vector<std::string> tokens;
+    std::stringstream words(line);
+    std::string word;
+    while(words >> word)
+    {
+        tokens.push_back(word);
+    }
+    if(tokens.empty())
+    {
+        return true;
+    }
+    if(tokens[0] == "quit")
+    {
+        return false;
+    }
+    if(tokens[0] != "run")
+    {
+        connection->send("error - Unknown request: " + tokens[0], false);
+        return true;
+    }
+    try
+    {
+        ServerJob job = parseJob(tokens);
+        job.connection = connection;
+        connection->send("queued " + job.id, false);
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            jobs.push_back(std::move(job));
+        }
+        queue_condition.notify_one();
+    }
+    catch(std::exception &e)
+    {
+        connection->send("error " + (tokens.size() > 1 ? tokens[1] : std::string("-")) + " " + e.what(), false);
+    }
+    return true;
+}
+
+void SimulationServer::workerLoop()
+{
+    while(true)
+    {
+        ServerJob job;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_condition.wait(lock, [this]{return stopping || !jobs.empty();});
+            if(stopping)
+            {
+                return;
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        if(job.connection->isClosed())
+        {
+            continue;
+        }
+        try
+        {
+            runJob(job);
+        }
+        catch(std::exception &e)
+        {
+            job.connection->send("error " + job.id + " " + e.what());
+        }
+    }
+}
+
+void SimulationServer::runJob(const ServerJob &job)
+{
+    const SimulationConfig &config = job.config;
+    Landscape landscape;
+    config.configure(landscape);
+    for(unsigned long step = 0; step < config.steps; step++)
+    {
+        if(stopping || job.connection->isClosed())
+        {
+            return;
+        }
+        landscape.iterate();
+        if(job.totals)
+        {
+            const PopulationTotals &totals = landscape.getTotals();
+            std::stringstream line;
+            line << "totals " << job.id << " " << step << " " << totals.rabbits << " " << totals.foxes;
+            job.connection->send(line.str());
+        }
+    }
+    if(job.grids)
+    {
+        std::stringstream rabbits;
+        std::stringstream foxes;
+        rabbits << "rabbits " << job.id << " " << config.y_size << " " << config.x_size;
+        foxes << "foxes " << job.id << " " << config.y_size << " " << config.x_size;
+        for(unsigned long i = 0; i < config.y_size; i++)
+        {
+            for(unsigned long j = 0; j < config.x_size; j++)
+            {
+                rabbits << " " << landscape.getNumRabbits(i, j);
+                foxes << " " << landscape.getNumFoxes(i, j);
+            }
+        }
+        job.connection->send(rabbits.str());
+        job.connection->send(foxes.str());
+    }
+    job.connection->send("done " + job.id);
+}
@@ -0,0 +1,206 @@
+/**
+ * @brief Contains the simulation server, which runs jobs submitted over a Unix domain socket on a pool of workers.
+ */
+
+#ifndef LIB_SIMULATIONSERVER_H
+#define LIB_SIMULATIONSERVER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../SimulationConfig.h"
+
+/**
+ * @brief A client connected to the server, to which the results of its jobs are streamed.
+ *
+ * @details Lines are queued in an outbox and written by the connection's own writer thread, so that no other thread
+ * ever blocks on the socket. In particular, the thread reading the client's requests never waits for the client to
+ * read its replies, which would deadlock with a client which submits many jobs before reading any results.
+ */
+class ServerConnection
+{
+protected:
+    int socket_fd;
+    std::atomic<bool> closed;
+    // The lines waiting to be written, and their total size
+    std::mutex outbox_mutex;
+    std::condition_variable outbox_condition;
+    std::deque<std::string> outbox;
+    std::size_t outbox_bytes;
+    // Whether the lines already queued are still to be written once the connection is closed
+    bool flushing;
+    std::thread writer;
+
+    /**
+     * @brief Writes the queued lines to the socket until the connection is closed.
+     */
+    void writeLoop();
+
+public:
+    // The size of the outbox beyond which send() waits for the client to catch up
+    static const std::size_t max_outbox_bytes = 4 << 20;
+
+    explicit ServerConnection(int socket_fd);
+
+    /**
+     * @brief Closes the connection, waiting for the writer thread to finish writing, if finish() was called.
+     */
+    ~ServerConnection();
+
+    ServerConnection(const ServerConnection &) = delete;
+
+    ServerConnection &operator=(const ServerConnection &) = delete;
+
+    /**
+     * @brief Queues a single line to be sent to the client. Safe to call from any thread; lines are never interleaved.
+     * @param line the line to send, without the trailing newline
+     * @param wait_for_space if true, first waits while the outbox is full, so that a client which is slow to read
+     * holds back the jobs producing its results; if false, queues the line at once, as the request reader must
+     * @return false if the client has disconnected
+     */
+    bool send(const std::string &line, bool wait_for_space = true);
+
+    /**
+     * @brief Marks the connection as closed and unblocks any pending reads, so that its jobs are abandoned. Lines
+     * which have not yet been written are discarded.
+     */
+    void close();
+
+    /**
+     * @brief Marks the connection as closed, so that its jobs are abandoned, but writes the lines already queued
+     * before shutting the socket down.
+     */
+    void finish();
+
+    /**
+     * @brief Checks whether the client has disconnected.
+     * @return true if the connection is closed
+     */
+    bool isClosed() const;
+
+    /**
+     * @brief Gets the socket of the connection.
+     * @return the file descriptor
+     */
+    int getSocket() const;
+};
+
+/**
+ * @brief A single simulation submitted by a client.
+ */
+struct ServerJob
+{
+    std::string id;
+    // The format and output file of the config are not used, as results are streamed back to the client
+    SimulationConfig config;
+    bool totals = true;
+    bool grids = false;
+    std::shared_ptr<ServerConnection> connection;
+};
+
+/**
+ * @brief Accepts simulation jobs over a Unix domain socket and runs them on a pool of worker threads, streaming the
+ * results back to the client which submitted them.
+ *
+ * @details The protocol is line-based text. Each request is a single line:
+ *
+ *     run <id> [output=totals,grids] [<setting>=<value>]...
+ *     quit
+ *
+ * where the settings are those of SimulationConfig (e.g. x, y, seed, steps and threads) and ModelParameters. The server replies "queued <id>" once a job is accepted, then
+ * streams "totals <id> <step> <rabbits> <foxes>" after every step if totals were requested, followed by
+ * "rabbits <id> <rows> <cols> <counts>..." and "foxes <id> <rows> <cols> <counts>..." (row-major) if grids were
+ * requested, and finally "done <id>". A job which cannot be parsed or fails replies "error <id> <message>" instead.
+ * Jobs from the same client may run concurrently, so their replies can be interleaved. Jobs belonging to a client
+ * which disconnects are abandoned.
+ */
+class SimulationServer
+{
+protected:
+    std::string socket_path;
+    unsigned long num_workers;
+    int listen_fd;
+    std::atomic<bool> stopping;
+    // The queue of jobs waiting for a worker
+    std::mutex queue_mutex;
+    std::condition_variable queue_condition;
+    std::deque<ServerJob> jobs;
+    std::vector<std::thread> workers;
+    // The connected clients, each served by its own (detached) reading thread
+    std::mutex connections_mutex;
+    std::condition_variable readers_condition;
+    std::vector<std::shared_ptr<ServerConnection>> connections;
+    unsigned long active_readers;
+
+    /**
+     * @brief The main loop of each worker, which runs jobs until the server stops.
+     */
+    void workerLoop();
+
+    /**
+     * @brief Reads requests from a client until it disconnects or the server stops.
+     * @param connection the client's connection
+     */
+    void readLoop(std::shared_ptr<ServerConnection> connection);
+
+    /**
+     * @brief Handles a single request line from a client.
+     * @param connection the client's connection
+     * @param line the request, without the trailing newline
+     * @return false if the client asked to close the connection
+     */
+    bool handleRequest(const std::shared_ptr<ServerConnection> &connection, const std::string &line);
+
+    /**
+     * @brief Runs a job and streams its results to its client.
+     * @param job the job to run
+     */
+    void runJob(const ServerJob &job);
+
+public:
+
+    /**
+     * @brief Creates the server.
+     * @param socket_path the path of the Unix domain socket to listen on
+     * @param num_workers the number of jobs to run at once
+     */
+    SimulationServer(const std::string &socket_path, unsigned long num_workers);
+
+    ~SimulationServer();
+
+    /**
+     * @brief Parses a run request into a job.
+     * @param tokens the words of the request, starting with "run"
+     * @return the job, without a connection
+     * @throws std::invalid_argument if the request is malformed
+     */
+    static ServerJob parseJob(const std::vector<std::string> &tokens);
+
+    /**
+     * @brief Binds the socket and starts the workers.
+     * @throws std::runtime_error if the socket cannot be created
+     */
+    void start();
+
+    /**
+     * @brief Accepts clients until stop() is called (e.g. from a signal handler, via requestStop()).
+     */
+    void serve();
+
+    /**
+     * @brief Asks the server to stop accepting clients. Safe to call from any thread.
+     */
+    void requestStop();
+
+    /**
+     * @brief Stops the server, abandoning any queued jobs, and removes the socket.
+     */
+    void stop();
+};
+
+#endif //LIB_SIMULATIONSERVER_H
@@ -0,0 +1,116 @@
+/**
+ * @brief Checks that the C interface can be compiled and linked as C, and that a landscape can be run through it.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "rfsim.h"
+
+static int failures = 0;
+
+/**
+ * @brief Reports a failure if a call did not return the expected status.
+ * @param status the status returned
+ * @param expected the status expected
+ * @param call a description of the call
+ */
+static void expect(rfsim_status status, rfsim_status expected, const char* call)
+{
+    if(status != expected)
+    {
+        fprintf(stderr, "%s returned %s (%s), not %s\n", call, rfsim_status_string(status), rfsim_last_error(),
+                rfsim_status_string(expected));
+        failures++;
+    }
+}
+
+/**
+ * @brief Runs a serial landscape and sums its counts.
+ * @param seed the random number seed
+ * @param steps the number of steps
+ * @param rabbits set to the total number of rabbits
+ * @param foxes set to the total number of foxes
+ */
+static void run(uint64_t seed, uint64_t steps, long* rabbits, long* foxes)
+{
+    rfsim_landscape* landscape = NULL;
+    uint64_t rows = 0;
+    uint64_t cols = 0;
+    const int32_t* rabbit_counts = NULL;
+    const int32_t* fox_counts = NULL;
+    const int32_t* borrowed = NULL;
+    uint64_t i;
+    *rabbits = -1;
+    *foxes = -1;
+    expect(rfsim_create(&landscape), RFSIM_OK, "rfsim_create");
+    if(landscape == NULL)
+    {
+        return;
+    }
+    expect(rfsim_iterate(landscape, 1), RFSIM_ERROR_NOT_SET_UP, "rfsim_iterate before rfsim_setup");
+    expect(rfsim_set_parameter(landscape, "no_such_parameter", 1.0), RFSIM_ERROR_INVALID_ARGUMENT,
+           "rfsim_set_parameter with an unknown name");
+    expect(rfsim_setup(landscape, seed, 12, 8), RFSIM_OK, "rfsim_setup");
+    expect(rfsim_setup(landscape, seed, 12, 8), RFSIM_ERROR_INVALID_ARGUMENT, "rfsim_setup twice");
+    expect(rfsim_get_rabbits(landscape, &borrowed), RFSIM_OK, "rfsim_get_rabbits");
+    expect(rfsim_iterate(landscape, steps), RFSIM_OK, "rfsim_iterate");
+    expect(rfsim_get_size(landscape, &rows, &cols), RFSIM_OK, "rfsim_get_size");
+    if(rows != 8 || cols != 12)
+    {
+        fprintf(stderr, "Expected 8 rows and 12 columns, got %lu and %lu\n", (unsigned long) rows,
+                (unsigned long) cols);
+        failures++;
+    }
+    expect(rfsim_get_rabbits(landscape, &rabbit_counts), RFSIM_OK, "rfsim_get_rabbits");
+    expect(rfsim_get_foxes(landscape, &fox_counts), RFSIM_OK, "rfsim_get_foxes");
+    if(rabbit_counts != borrowed)
+    {
+        fprintf(stderr, "The borrowed rabbit counts moved during rfsim_iterate\n");
+        failures++;
+    }
+    if(rabbit_counts != NULL && fox_counts != NULL)
+    {
+        *rabbits = 0;
+        *foxes = 0;
+        for(i = 0; i < rows * cols; i++)
+        {
+            if(rabbit_counts[i] < 0 || fox_counts[i] < 0)
+            {
+                fprintf(stderr, "Negative count in cell %lu\n", (unsigned long) i);
+                failures++;
+            }
+            *rabbits += rabbit_counts[i];
+            *foxes += fox_counts[i];
+        }
+    }
+    rfsim_destroy(landscape);
+}
+
+int main(void)
+{
+    long rabbits;
+    long foxes;
+    long repeat_rabbits;
+    long repeat_foxes;
+    if(rfsim_api_version() != RFSIM_API_VERSION)
+    {
+        fprintf(stderr, "The library has interface version %d, not %d\n", rfsim_api_version(), RFSIM_API_VERSION);
+        failures++;
+    }
+    expect(rfsim_create(NULL), RFSIM_ERROR_NULL_ARGUMENT, "rfsim_create with no handle");
+    if(strlen(rfsim_last_error()) == 0)
+    {
+        fprintf(stderr, "No error was described after a failed call\n");
+        failures++;
+    }
+    rfsim_destroy(NULL);
+    run(5, 20, &rabbits, &foxes);
+    run(5, 20, &repeat_rabbits, &repeat_foxes);
+    if(rabbits <= 0 || rabbits != repeat_rabbits || foxes != repeat_foxes)
+    {
+        fprintf(stderr, "Runs with the same seed gave %ld and %ld rabbits, %ld and %ld foxes\n", rabbits,
+                repeat_rabbits, foxes, repeat_foxes);
+        failures++;
+    }
+    return failures == 0 ? 0 : 1;
+}
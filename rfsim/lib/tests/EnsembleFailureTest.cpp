@@ -0,0 +1,87 @@
+/**
+ * @brief Checks that an ensemble in which one replicate throws still reduces the replicates which finished.
+ */
+
+#include <iostream>
+#include <stdexcept>
+#include "../Ensemble.h"
+
+/**
+ * @brief An ensemble in which a single replicate fails.
+ */
+class FailingEnsemble : public Ensemble
+{
+protected:
+    unsigned long failing;
+
+public:
+    FailingEnsemble(unsigned long failing) : Ensemble(6, 5, 4), failing(failing)
+    {
+    }
+
+    void runReplicate(unsigned long replicate, unsigned long seed, const EnsembleOutput &output,
+                      unsigned long first_band) const override
+    {
+        if(replicate == failing)
+        {
+            throw std::runtime_error("Replicate failed");
+        }
+        Ensemble::runReplicate(replicate, seed, output, first_band);
+    }
+};
+
+/**
+ * @brief Runs an ensemble with a failing replicate and checks what reached the statistics.
+ * @param threads the number of threads
+ * @param expected the number of replicates expected to be reduced
+ * @return the number of failures
+ */
+int check(unsigned long threads, unsigned long expected)
+{
+    const unsigned long replicates = 12;
+    std::vector<unsigned long> seeds;
+    for(unsigned long replicate = 0; replicate < replicates; replicate++)
+    {
+        seeds.push_back(replicate + 1);
+    }
+    EnsembleStatistics statistics(30, 4, {0.5}, 3);
+    EnsembleOutput output;
+    output.statistics = &statistics;
+    bool thrown = false;
+    try
+    {
+        FailingEnsemble(2).run(seeds, threads, output);
+    }
+    catch(std::runtime_error &)
+    {
+        thrown = true;
+    }
+    int failures = 0;
+    if(!thrown)
+    {
+        std::cerr << "The failed replicate's exception was not rethrown with " << threads << " threads" << std::endl;
+        failures++;
+    }
+    if(statistics.getNumPending() != 0)
+    {
+        std::cerr << statistics.getNumPending() << " replicates were left waiting for the failed one with " << threads
+                  << " threads" << std::endl;
+        failures++;
+    }
+    if(statistics.getStepRabbits().getCount(0) != expected || statistics.getCellFoxes().getCount(29) != expected)
+    {
+        std::cerr << "Expected " << expected << " replicates to be reduced with " << threads << " threads, got "
+                  << statistics.getStepRabbits().getCount(0) << std::endl;
+        failures++;
+    }
+    return failures;
+}
+
+int main()
+{
+    // A single thread stops at the failed replicate, having finished the two before it, whereas with several threads
+    // the others carry on until every replicate has been taken.
+    int failures = check(1, 2);
+    failures += check(4, 11);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,103 @@
+/**
+ * @brief Checks that matrices using the first-touch allocator only ever hold constructed elements.
+ */
+
+#include <iostream>
+#include <stdexcept>
+#include "../Matrix.h"
+#include "../FirstTouchAllocator.h"
+
+/**
+ * @brief An element which counts its constructions and destructions.
+ */
+struct Counted
+{
+    static long default_constructed;
+    static long constructed;
+    static long destroyed;
+    long value;
+
+    Counted() : value(7)
+    {
+        default_constructed++;
+        constructed++;
+    }
+
+    explicit Counted(long v) : value(v)
+    {
+        constructed++;
+    }
+
+    Counted(const Counted &other) : value(other.value)
+    {
+        constructed++;
+    }
+
+    ~Counted()
+    {
+        destroyed++;
+    }
+};
+
+long Counted::default_constructed = 0;
+long Counted::constructed = 0;
+long Counted::destroyed = 0;
+
+typedef Matrix<Counted, RowMajorLayout, FirstTouchAllocator<Counted>> CountedMatrix;
+
+int main()
+{
+    int failures = 0;
+    {
+        CountedMatrix matrix;
+        // An ordinary resize constructs every element.
+        long before = Counted::default_constructed;
+        matrix.setSize(3, 4);
+        if(Counted::default_constructed - before != 12 || matrix.get(2, 3).value != 7)
+        {
+            std::cerr << "setSize() did not default-construct every element" << std::endl;
+            failures++;
+        }
+        // Sizing with a constructor leaves the construction to it, and destroys the old elements first.
+        before = Counted::default_constructed;
+        long destroyed = Counted::destroyed;
+        matrix.setSizeConstructedBy(2, 3, [&matrix]
+        {
+            for(unsigned long i = 0; i < 2; i++)
+            {
+                for(unsigned long j = 0; j < 3; j++)
+                {
+                    new(&matrix.get(i, j)) Counted(static_cast<long>(i * 3 + j));
+                }
+            }
+        });
+        if(Counted::default_constructed != before || Counted::destroyed - destroyed != 12
+           || matrix.get(1, 2).value != 5 || matrix.getRows() != 2 || matrix.getCols() != 3)
+        {
+            std::cerr << "setSizeConstructedBy() did not hand construction to its constructor" << std::endl;
+            failures++;
+        }
+        // A failed construction leaves an empty matrix, without destroying elements which were never constructed.
+        destroyed = Counted::destroyed;
+        bool thrown = false;
+        try
+        {
+            matrix.setSizeConstructedBy(4, 4, [&matrix]
+            {
+                new(&matrix.get(0, 0)) Counted(1);
+                throw std::runtime_error("construction failed");
+            });
+        }
+        catch(std::runtime_error &)
+        {
+            thrown = true;
+        }
+        if(!thrown || matrix.getRows() != 0 || Counted::destroyed - destroyed != 6)
+        {
+            std::cerr << "A failed setSizeConstructedBy() destroyed unconstructed elements or kept its size"
+                      << std::endl;
+            failures++;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,52 @@
+/**
+ * @brief Checks that the per-cell random number streams of different seeds do not coincide.
+ */
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include "../RNGController.h"
+
+/**
+ * @brief Draws the first few numbers of a stream.
+ * @param seed the simulation seed
+ * @param stream the stream number
+ * @return the numbers drawn
+ */
+std::vector<uint64_t> drawStream(uint64_t seed, uint64_t stream)
+{
+    RNGController random;
+    random.setStream(seed, stream);
+    std::vector<uint64_t> drawn;
+    for(int i = 0; i < 4; i++)
+    {
+        drawn.push_back(random.next());
+    }
+    return drawn;
+}
+
+int main()
+{
+    int failures = 0;
+    // Swapping the seed and the stream must give a different stream, or replicates seeded 1..N share cells' numbers.
+    const uint64_t pairs[][2] = {{3, 7}, {1, 2}, {0, 1}, {12345, 678}};
+    for(const auto &pair : pairs)
+    {
+        if(drawStream(pair[0], pair[1]) == drawStream(pair[1], pair[0]))
+        {
+            std::cerr << "Seed " << pair[0] << " stream " << pair[1] << " equals seed " << pair[1] << " stream "
+                      << pair[0] << std::endl;
+            failures++;
+        }
+    }
+    // Streams equal to their seed must not all collapse onto one stream.
+    for(uint64_t seed = 1; seed < 8; seed++)
+    {
+        if(drawStream(seed, seed) == drawStream(seed + 1, seed + 1))
+        {
+            std::cerr << "Seed " << seed << " stream " << seed << " equals the next seed's matching stream" << std::endl;
+            failures++;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
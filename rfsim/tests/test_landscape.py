@@ -1,7 +1,14 @@
+import asyncio
+import os
+import tempfile
+import time
 import unittest
 
 import numpy as np
 
+from rfsim.background import iterate_async
+from rfsim.client import SimulationClient, SimulationError, SimulationServer, mod_directory
+from rfsim.history import HistoryReader
 from rfsim.librfsim import librfsim
 
 
@@ -52,3 +59,479 @@ def testFiveByTen(self):
     foxes = landscape.get_foxes()
     self.assertEqual((10, 5), rabbits.shape)
     self.assertEqual((10, 5), foxes.shape)
+
+
+class TestParallelLandscape(unittest.TestCase):
+    def _run(self, threads, grain_size):
+        landscape = librfsim.CLandscape()
+        landscape.setup(4, 20, 15)
+        landscape.set_threads(threads, grain_size)
+        landscape.iterate(20)
+        return landscape.get_rabbits(), landscape.get_foxes()
+
+    def testIndependentOfThreads(self):
+        rabbits, foxes = self._run(1, 4096)
+        for threads, grain_size in [(2, 1), (4, 100), (3, 100000)]:
+            other_rabbits, other_foxes = self._run(threads, grain_size)
+            self.assertTrue(np.array_equal(rabbits, other_rabbits))
+            self.assertTrue(np.array_equal(foxes, other_foxes))
+        self.assertGreater(rabbits.sum(), 0)
+
+    def testPartitionedMatchesWorkStealing(self):
+        rabbits, foxes = self._run(3, 4096)
+        landscape = librfsim.CLandscape()
+        landscape.setup(4, 20, 15)
+        landscape.set_threads(3)
+        landscape.set_partitioning(5)
+        landscape.iterate(20)
+        self.assertTrue(np.array_equal(rabbits, landscape.get_rabbits()))
+        self.assertTrue(np.array_equal(foxes, landscape.get_foxes()))
+        profile = landscape.profile()
+        self.assertEqual(4, profile["rebalances"])
+        self.assertGreaterEqual(profile["partition_imbalance"], 1.0)
+
+    def testDoubleBufferedMatchesInPlace(self):
+        rabbits, foxes = self._run(3, 4096)
+        for partitioning in [0, 5]:
+            landscape = librfsim.CLandscape()
+            landscape.setup(4, 20, 15)
+            landscape.set_threads(3)
+            landscape.set_partitioning(partitioning)
+            landscape.set_double_buffered(True)
+            landscape.iterate(20)
+            self.assertTrue(np.array_equal(rabbits, landscape.get_rabbits()))
+            self.assertTrue(np.array_equal(foxes, landscape.get_foxes()))
+
+    def testDoubleBufferedIndependentOfThreads(self):
+        for partitioning in [0, 5]:
+            results = []
+            for threads in [1, 2, 4]:
+                landscape = librfsim.CLandscape()
+                landscape.setup(4, 20, 15)
+                landscape.set_threads(threads, 100)
+                landscape.set_partitioning(partitioning)
+                landscape.set_double_buffered(True)
+                landscape.iterate(20)
+                results.append((landscape.get_rabbits(), landscape.get_foxes(), landscape.get_grass()))
+            for rabbits, foxes, grass in results[1:]:
+                self.assertTrue(np.array_equal(results[0][0], rabbits))
+                self.assertTrue(np.array_equal(results[0][1], foxes))
+                self.assertTrue(np.array_equal(results[0][2], grass))
+
+    def testNumaPlacementMatchesWorkStealing(self):
+        rabbits, foxes = self._run(3, 4096)
+        landscape = librfsim.CLandscape()
+        landscape.set_threads(3)
+        landscape.set_numa_placement(True)
+        landscape.setup(4, 20, 15)
+        landscape.iterate(20)
+        self.assertTrue(np.array_equal(rabbits, landscape.get_rabbits()))
+        self.assertTrue(np.array_equal(foxes, landscape.get_foxes()))
+
+    @unittest.skipUnless(hasattr(os, "sched_getaffinity"), "CPU affinity is only available on Linux")
+    def testNumaPlacementKeepsCallerAffinity(self):
+        allowed = os.sched_getaffinity(0)
+        landscape = librfsim.CLandscape()
+        landscape.set_threads(3)
+        landscape.set_numa_placement(True)
+        landscape.setup(4, 20, 15)
+        landscape.iterate(2)
+        self.assertEqual(allowed, os.sched_getaffinity(0))
+
+    def testInvalidThreads(self):
+        landscape = librfsim.CLandscape()
+        with self.assertRaises(librfsim.librfsimError):
+            landscape.set_threads(0)
+
+
+class TestEnsemble(unittest.TestCase):
+    def testMatchesIndividualRuns(self):
+        seeds = [1, 2, 3, 4, 5]
+        rabbits, foxes, step_rabbits, step_foxes = librfsim.run_ensemble(seeds, 6, 4, 3, 3, record_steps=True)
+        self.assertEqual((5, 4, 6), rabbits.shape)
+        self.assertEqual((5, 3), step_rabbits.shape)
+        for index, seed in enumerate(seeds):
+            landscape = librfsim.CLandscape()
+            landscape.setup(seed, 6, 4)
+            landscape.iterate(3)
+            self.assertTrue(np.array_equal(landscape.get_rabbits(), rabbits[index]))
+            self.assertTrue(np.array_equal(landscape.get_foxes(), foxes[index]))
+            self.assertEqual(rabbits[index].sum(), step_rabbits[index, -1])
+            self.assertEqual(foxes[index].sum(), step_foxes[index, -1])
+
+    def testInvalidThreads(self):
+        with self.assertRaises(librfsim.librfsimError):
+            librfsim.run_ensemble([1], 2, 2, 1, 0)
+
+    def testStatisticsMatchReplicates(self):
+        seeds = list(range(1, 6))
+        rabbits, foxes, step_rabbits, step_foxes = librfsim.run_ensemble(seeds, 5, 4, 3, 2, record_steps=True)
+        summary = librfsim.ensemble_statistics(seeds, 5, 4, 3, 2, quantiles=[0.0, 0.5, 1.0])
+        self.assertEqual(5, summary["replicates"])
+        self.assertTrue(np.allclose(rabbits.mean(axis=0), summary["rabbits"]["mean"]))
+        self.assertTrue(np.allclose(foxes.var(axis=0, ddof=1), summary["foxes"]["variance"]))
+        self.assertTrue(np.array_equal(np.median(rabbits, axis=0), summary["rabbits"]["quantiles"][1]))
+        self.assertTrue(np.array_equal(foxes.max(axis=0), summary["foxes"]["quantiles"][2]))
+        self.assertTrue(np.array_equal((foxes == 0).mean(axis=0), summary["foxes"]["extinction"]))
+        self.assertTrue(np.allclose(step_rabbits.mean(axis=0), summary["rabbit_totals"]["mean"]))
+        self.assertTrue(np.array_equal(step_foxes.min(axis=0), summary["fox_totals"]["quantiles"][0]))
+
+    def testQuantilesOfManyReplicates(self):
+        seeds = list(range(1, 401))
+        rabbits, foxes, step_rabbits, step_foxes = librfsim.run_ensemble(seeds, 3, 2, 4, 4, record_steps=True)
+        quantiles = [0.1, 0.5, 0.9]
+        summary = librfsim.ensemble_statistics(seeds, 3, 2, 4, 4, quantiles=quantiles)
+        for k, quantile in enumerate(quantiles):
+            # P² estimates are approximate, so each must lie between nearby quantiles of the replicates, to within
+            # one animal as the counts are whole numbers.
+            for results, estimates in [(rabbits, summary["rabbits"]), (step_foxes, summary["fox_totals"])]:
+                lower = np.quantile(results, max(quantile - 0.05, 0.0), axis=0) - 1
+                upper = np.quantile(results, min(quantile + 0.05, 1.0), axis=0) + 1
+                self.assertTrue(np.all(lower <= estimates["quantiles"][k]))
+                self.assertTrue(np.all(estimates["quantiles"][k] <= upper))
+        self.assertTrue(np.allclose(step_rabbits.mean(axis=0), summary["rabbit_totals"]["mean"]))
+
+    def testStatisticsIndependentOfThreads(self):
+        seeds = list(range(1, 41))
+        single = librfsim.ensemble_statistics(seeds, 4, 3, 3, 1)
+        for threads in [2, 5]:
+            summary = librfsim.ensemble_statistics(seeds, 4, 3, 3, threads)
+            for name in ["rabbits", "foxes", "rabbit_totals", "fox_totals"]:
+                for key in ["mean", "variance", "quantiles"]:
+                    self.assertTrue(np.array_equal(single[name][key], summary[name][key]))
+
+
+class TestSweep(unittest.TestCase):
+    def testCommonRandomNumbersMatchLandscape(self):
+        seeds = [3, 4]
+        grid = {"grass_growth": [500.0, 1000.0], "move_probability": [0.1, 0.5]}
+        result = librfsim.run_sweep(grid, seeds, 5, 4, 3, 3)
+        self.assertEqual((4, 2, 4, 5), result["rabbits"].shape)
+        self.assertEqual(0.5, result["points"][1]["move_probability"])
+        for point, parameters in enumerate(result["points"]):
+            for index, seed in enumerate(seeds):
+                landscape = librfsim.CLandscape()
+                landscape.set_parameters(**parameters)
+                landscape.set_threads(1)
+                landscape.setup(seed, 5, 4)
+                landscape.iterate(3)
+                self.assertTrue(np.array_equal(landscape.get_rabbits(), result["rabbits"][point, index]))
+                self.assertTrue(np.array_equal(landscape.get_foxes(), result["foxes"][point, index]))
+        # Without common random numbers, repeated points are independent
+        repeated = [{"grass_growth": 1000.0}] * 2
+        common = librfsim.run_sweep(repeated, seeds, 5, 4, 3, 2)
+        independent = librfsim.run_sweep(repeated, seeds, 5, 4, 3, 2, common_random_numbers=False)
+        self.assertTrue(np.array_equal(common["rabbits"][0], common["rabbits"][1]))
+        self.assertFalse(np.array_equal(independent["rabbits"][0], independent["rabbits"][1]))
+
+    def testInvalidParameter(self):
+        with self.assertRaises(librfsim.librfsimError):
+            librfsim.run_sweep({"move_probability": [2.0]}, [1], 2, 2, 1, 1)
+        with self.assertRaises(librfsim.librfsimError):
+            librfsim.run_sweep([{"no_such_parameter": 1.0}], [1], 2, 2, 1, 1)
+        for variation in [float("nan"), 1e30, 2.5, -1.0]:
+            with self.assertRaises(librfsim.librfsimError):
+                librfsim.run_sweep({"grass_variation": [variation]}, [1], 2, 2, 1, 1)
+
+
+@unittest.skipUnless(os.path.exists(os.path.join(mod_directory, "librfsim", "rfsim_server")), "rfsim_server not built")
+class TestServer(unittest.TestCase):
+    def testBatchMatchesLandscape(self):
+        socket_path = os.path.join(tempfile.mkdtemp(), "rfsim.sock")
+        with SimulationServer.start(socket_path, workers=2), SimulationClient(socket_path) as client:
+            jobs = [dict(seed=seed, x=6, y=4, steps=3) for seed in (1, 2, 3)]
+            jobs.append(dict(seed=4, x=6, y=4, steps=3, move_probability=0.5))
+            results = client.run_batch(jobs)
+            for job, result in zip(jobs, results):
+                landscape = librfsim.CLandscape()
+                landscape.set_parameters(move_probability=job.get("move_probability", 0.1))
+                landscape.setup(job["seed"], 6, 4)
+                landscape.iterate(3)
+                self.assertTrue(np.array_equal(landscape.get_rabbits(), result["rabbits"]))
+                self.assertTrue(np.array_equal(landscape.get_foxes(), result["foxes"]))
+                self.assertEqual(3, len(result["rabbit_totals"]))
+                self.assertEqual(landscape.get_rabbits().sum(), result["rabbit_totals"][-1])
+            with self.assertRaises(SimulationError):
+                client.run(1, 2, 2, 1, move_probability=2.0)
+
+    def testLargeBatchDoesNotDeadlock(self):
+        # Megabytes of replies, far more than the socket buffers hold, while every job is submitted before any result
+        # is read, so the server must keep reading requests while its replies back up.
+        socket_path = os.path.join(tempfile.mkdtemp(), "rfsim.sock")
+        with SimulationServer.start(socket_path, workers=2), SimulationClient(socket_path) as client:
+            jobs = [dict(seed=seed, x=20, y=20, steps=1) for seed in range(1, 1501)]
+            results = client.run_batch(jobs, max_pending=len(jobs))
+            self.assertEqual(len(jobs), len(results))
+            landscape = librfsim.CLandscape()
+            landscape.setup(1500, 20, 20)
+            landscape.iterate(1)
+            self.assertTrue(np.array_equal(landscape.get_foxes(), results[-1]["foxes"]))
+            # Collecting results while submitting gives the same results.
+            limited = client.run_batch(jobs[:600], max_pending=8)
+            for result, expected in zip(limited, results):
+                self.assertTrue(np.array_equal(expected["rabbits"], result["rabbits"]))
+
+
+class TestTotals(unittest.TestCase):
+    def testTotalsMatchGrids(self):
+        landscape = librfsim.CLandscape()
+        landscape.set_threads(2, 16)
+        landscape.setup(10, 12, 9)
+        landscape.iterate(10)
+        totals = landscape.totals()
+        self.assertEqual(landscape.get_rabbits().sum(), totals["rabbits"])
+        self.assertEqual(landscape.get_foxes().sum(), totals["foxes"])
+        history = {key: value.astype(np.float64) for key, value in landscape.history().items()}
+        self.assertEqual(11, len(history["rabbits"]))
+        self.assertEqual(totals["migrations"], history["migrations"][-1])
+        # Every change in population is a birth, a death or a rabbit eaten
+        animals = history["rabbits"] + history["foxes"]
+        events = history["births"] - history["deaths"] - history["predation"]
+        self.assertTrue(np.array_equal(np.diff(animals), events[1:]))
+
+
+class TestRegionSums(unittest.TestCase):
+    def testMatchesNumpy(self):
+        landscape = librfsim.CLandscape()
+        landscape.set_threads(3, 64)
+        landscape.set_summed_area_tables(True)
+        landscape.setup(3, 17, 11)
+        landscape.iterate(3)
+        rabbits = landscape.get_rabbits()
+        foxes = landscape.get_foxes()
+        rects = [(0, 0, 11, 17), (2, 3, 9, 4), (5, 5, 5, 9), (10, 0, 11, 17)]
+        sums = landscape.region_sums(rects)
+        for k, (row_start, col_start, row_end, col_end) in enumerate(rects):
+            self.assertEqual(rabbits[row_start:row_end, col_start:col_end].sum(), sums["rabbits"][k])
+            self.assertEqual(foxes[row_start:row_end, col_start:col_end].sum(), sums["foxes"][k])
+        self.assertAlmostEqual(landscape.totals()["grass"], sums["grass"][0], delta=1e-6)
+        with self.assertRaises(librfsim.librfsimError):
+            landscape.region_sums([(0, 0, 12, 1)])
+
+
+class TestPyramid(unittest.TestCase):
+    def testLevelsSumBlocks(self):
+        landscape = librfsim.CLandscape()
+        landscape.set_threads(2, 64)
+        landscape.setup(3, 13, 10)
+        landscape.iterate(2)
+        rabbits = landscape.get_rabbits().astype(np.int64)
+        level = landscape.get_rabbits(level=2)
+        self.assertEqual((3, 4), level.shape)
+        self.assertEqual(rabbits[4:8, 8:12].sum(), level[1, 2])
+        # Blocks along the edges cover fewer cells
+        self.assertEqual(rabbits[8:, 12:].sum(), level[2, 3])
+        self.assertAlmostEqual(rabbits[8:, 12:].mean(), landscape.get_rabbits(level=2, mean=True)[2, 3])
+        self.assertEqual(landscape.get_foxes().sum(), landscape.get_foxes(level=4)[0, 0])
+        self.assertAlmostEqual(landscape.totals()["grass"], landscape.get_grass(level=4)[0, 0], delta=1e-6)
+
+
+class TestSpatialStatistics(unittest.TestCase):
+    def testMatchesPairwise(self):
+        landscape = librfsim.CLandscape()
+        landscape.set_threads(2, 64)
+        landscape.setup(3, 9, 7)
+        landscape.iterate(3)
+        edges = [0.0, 1.0, 2.5, 5.0]
+        statistics = landscape.spatial_statistics("rabbits", edges)
+        values = landscape.get_rabbits().ravel().astype(np.float64)
+        rows, cols = np.indices((7, 9))
+        first, second = np.triu_indices(values.size, 1)
+        distances = np.hypot(rows.ravel()[first] - rows.ravel()[second], cols.ravel()[first] - cols.ravel()[second])
+        deviations = values - values.mean()
+        for k in range(len(edges) - 1):
+            pairs = (distances > edges[k]) & (distances <= edges[k + 1])
+            self.assertEqual(pairs.sum(), statistics["pairs"][k])
+            differences = values[first[pairs]] - values[second[pairs]]
+            self.assertAlmostEqual((differences ** 2).mean() / 2, statistics["semivariance"][k])
+            morans_i = (values.size * (deviations[first[pairs]] * deviations[second[pairs]]).sum() /
+                        (pairs.sum() * (deviations ** 2).sum()))
+            self.assertAlmostEqual(morans_i, statistics["morans_i"][k])
+        self.assertAlmostEqual(statistics["morans_i"][0], landscape.morans_i("rabbits", 1.0))
+
+
+class TestChanges(unittest.TestCase):
+    def testChangesReconstructGrids(self):
+        landscape = librfsim.CLandscape()
+        landscape.set_threads(2, 16)
+        landscape.setup(5, 12, 10)
+        changes, token = landscape.get_changes()
+        self.assertEqual(120, len(changes["index"]))
+        rabbits = np.zeros(120, dtype=np.int32)
+        foxes = np.zeros(120, dtype=np.int32)
+        for step in range(5):
+            rabbits[changes["index"]] = changes["rabbits"]
+            foxes[changes["index"]] = changes["foxes"]
+            self.assertTrue(np.array_equal(landscape.get_rabbits(), rabbits.reshape(10, 12)))
+            self.assertTrue(np.array_equal(landscape.get_foxes(), foxes.reshape(10, 12)))
+            landscape.iterate(1)
+            changes, token = landscape.get_changes(token)
+        self.assertEqual(0, len(landscape.get_changes(token)[0]["index"]))
+
+    def testGrassGrowthDoesNotMarkPopulations(self):
+        landscape = librfsim.CLandscape()
+        landscape.set_threads(2, 16)
+        # The grass grows as by default, while the animals stay put and stop breeding, so the populations soon settle.
+        landscape.set_parameters(move_probability=0, rabbit_reproduction_threshold=1e9, fox_reproduction_threshold=1e9)
+        landscape.setup(6, 30, 20)
+        changes, token = landscape.get_changes(grass=True)
+        rabbits = np.zeros(600, dtype=np.int32)
+        foxes = np.zeros(600, dtype=np.int32)
+        grass = np.zeros(600)
+        population_changes = []
+        for step in range(15):
+            rabbits[changes["index"]] = changes["rabbits"]
+            foxes[changes["index"]] = changes["foxes"]
+            grass[changes["index"]] = changes["grass"]
+            self.assertTrue(np.array_equal(landscape.get_rabbits(), rabbits.reshape(20, 30)))
+            self.assertTrue(np.array_equal(landscape.get_foxes(), foxes.reshape(20, 30)))
+            self.assertTrue(np.array_equal(landscape.get_grass(), grass.reshape(20, 30)))
+            before = landscape.get_rabbits(), landscape.get_foxes()
+            landscape.iterate(1)
+            population_changes.append(landscape.get_changes(token)[0]["index"])
+            changes, token = landscape.get_changes(token, grass=True)
+            self.assertEqual(600, len(changes["index"]))
+            changed = (landscape.get_rabbits() != before[0]) | (landscape.get_foxes() != before[1])
+            self.assertTrue(np.isin(np.flatnonzero(changed), population_changes[-1]).all())
+        self.assertEqual(0, len(population_changes[-1]))
+
+
+class TestNpyTimeSeries(unittest.TestCase):
+    def testReadableDuringAndAfterRun(self):
+        landscape = librfsim.CLandscape()
+        landscape.setup(4, 11, 7)
+        with tempfile.TemporaryDirectory() as directory:
+            path = os.path.join(directory, "series.npy")
+            landscape.start_npy_output(path)
+            expected = [np.stack([landscape.get_rabbits(), landscape.get_foxes()])]
+            for step in range(20):
+                landscape.iterate(1)
+                expected.append(np.stack([landscape.get_rabbits(), landscape.get_foxes()]))
+                if step == 9:
+                    series = np.load(path, mmap_mode="r")
+                    self.assertEqual((11, 2, 7, 11), series.shape)
+                    self.assertTrue(np.array_equal(np.stack(expected), series))
+                    del series
+            landscape.stop_npy_output()
+            series = np.load(path)
+            self.assertEqual(np.int32, series.dtype)
+            self.assertTrue(np.array_equal(np.stack(expected), series))
+            with open(path, "rb") as stream:
+                header_size = 10 + int.from_bytes(stream.read(10)[8:10], "little")
+            self.assertEqual(header_size + series.nbytes, os.path.getsize(path))
+
+
+class TestHistoryFile(unittest.TestCase):
+    def testFramesMatchEveryStep(self):
+        landscape = librfsim.CLandscape()
+        landscape.set_threads(2, 16)
+        landscape.setup(6, 13, 9)
+        with tempfile.TemporaryDirectory() as directory:
+            path = os.path.join(directory, "run.history")
+            landscape.start_history_file(path, keyframe_interval=5)
+            expected = [np.stack([landscape.get_rabbits(), landscape.get_foxes()])]
+            for step in range(17):
+                landscape.iterate(1)
+                expected.append(np.stack([landscape.get_rabbits(), landscape.get_foxes()]))
+            landscape.stop_history_file()
+            expected = np.stack(expected)
+            with HistoryReader(path) as history:
+                self.assertEqual(18, len(history))
+                self.assertTrue(np.array_equal(expected, history[:]))
+                self.assertTrue(np.array_equal(expected[2:16:3], history[2:16:3]))
+                for index in [12, 0, 4, 5, 6, 7, -1]:
+                    self.assertTrue(np.array_equal(expected[index], history[index]))
+
+    def testReadableBeforeStopped(self):
+        landscape = librfsim.CLandscape()
+        landscape.set_threads(2, 16)
+        landscape.setup(6, 13, 9)
+        with tempfile.TemporaryDirectory() as directory:
+            path = os.path.join(directory, "run.history")
+            landscape.start_history_file(path, keyframe_interval=5)
+            expected = [np.stack([landscape.get_rabbits(), landscape.get_foxes()])]
+            for step in range(17):
+                landscape.iterate(1)
+                expected.append(np.stack([landscape.get_rabbits(), landscape.get_foxes()]))
+            expected = np.stack(expected)
+            # Without an index, the reader walks the chunks written so far, which are the first three once the encoder
+            # has caught up.
+            deadline = time.time() + 10
+            while True:
+                with HistoryReader(path) as history:
+                    if len(history) == 15 or time.time() > deadline:
+                        break
+                time.sleep(0.01)
+            try:
+                with HistoryReader(path) as history:
+                    self.assertEqual(15, len(history))
+                    self.assertTrue(np.array_equal(expected[:15], history[:]))
+                    for index in range(15):
+                        frame = history[index]
+                        self.assertTrue(np.array_equal(expected[index], frame))
+                        # Changing a frame must not change the next one, which is decoded from the frame before.
+                        frame[:] = -1
+                    with self.assertRaises(IndexError):
+                        history[15]
+            finally:
+                landscape.stop_history_file()
+            with HistoryReader(path) as history:
+                self.assertEqual(18, len(history))
+
+
+class TestRunUntil(unittest.TestCase):
+    def testStopsWhenThresholdCrossed(self):
+        landscape = librfsim.CLandscape()
+        landscape.setup(10, 10, 10)
+        conditions = [{"kind": "extinct", "total": "foxes"},
+                      {"kind": "above", "total": "rabbits", "threshold": 2000}]
+        steps, met = landscape.run_until(50, conditions)
+        self.assertEqual(1, met)
+        self.assertGreater(landscape.get_rabbits().sum(), 2000)
+        expected = librfsim.CLandscape()
+        expected.setup(10, 10, 10)
+        expected.iterate(steps - 1)
+        self.assertLessEqual(expected.get_rabbits().sum(), 2000)
+        expected.iterate(1)
+        self.assertTrue(np.array_equal(expected.get_rabbits(), landscape.get_rabbits()))
+
+    def testMaxSteps(self):
+        landscape = librfsim.CLandscape()
+        landscape.setup(10, 10, 10)
+        self.assertEqual((3, None), landscape.run_until(3, [{"kind": "extinct", "total": "rabbits"}]))
+        with self.assertRaises(librfsim.librfsimError):
+            landscape.run_until(3, [{"kind": "stable", "total": "animals", "epsilon": 0.0}])
+
+
+class TestBackgroundIteration(unittest.TestCase):
+    def testMatchesIterate(self):
+        landscape = librfsim.CLandscape()
+        landscape.setup(10, 10, 10)
+        landscape.start(1)
+        self.assertTrue(landscape.wait())
+        self.assertEqual((1, 1), landscape.progress())
+        self.assertFalse(landscape.running())
+        expected = librfsim.CLandscape()
+        expected.setup(10, 10, 10)
+        expected.iterate(1)
+        self.assertTrue(np.array_equal(expected.get_rabbits(), landscape.get_rabbits()))
+
+    def testCancelStopsAtIterationBoundary(self):
+        landscape = librfsim.CLandscape()
+        landscape.setup(1, 5, 5)
+        landscape.start(10 ** 9)
+        with self.assertRaises(librfsim.librfsimError):
+            landscape.iterate(1)
+        landscape.cancel()
+        self.assertTrue(landscape.wait(10.0))
+        completed, total = landscape.progress()
+        self.assertLess(completed, total)
+        expected = librfsim.CLandscape()
+        expected.setup(1, 5, 5)
+        expected.iterate(completed)
+        self.assertTrue(np.array_equal(expected.get_foxes(), landscape.get_foxes()))
+
+    def testAsyncio(self):
+        landscape = librfsim.CLandscape()
+        landscape.setup(10, 10, 10)
+        self.assertEqual(1, asyncio.run(iterate_async(landscape, 1, poll_interval=0.001)))